@@ -20,6 +20,7 @@
 #include "Application.h"
 
 #include "Logger.h"
+#include "Utilities.h"
 #include "third_party/argparse.hpp"
 
 #include <cassert>
@@ -32,6 +33,11 @@ struct CommandLineArgumentsParser : public argparse::Args {
     uint32_t& tileWidth    = kwarg("tile-width", "Tile width").set_default(512);
     uint32_t& tileHeight   = kwarg("tile-height", "Tile height").set_default(512);
     uint32_t& cellSize     = kwarg("cell-size", "Fill pattern cell-size").set_default(32);
+    uint32_t& bufferCount  = kwarg("buffers", "Number of window buffers in the swapchain (2-8)").set_default(4);
+    uint32_t& videoWidth   = kwarg("video-width", "Width of the video frames composited above the tiles, 0 disables the video").set_default(0);
+    uint32_t& videoHeight  = kwarg("video-height", "Height of the video frames composited above the tiles").set_default(0);
+    uint32_t& videoFrameRate = kwarg("video-frame-rate", "Frame rate of the video, independent of the window frame rate").set_default(30);
+    uint32_t& deadlineMargin = kwarg("deadline-margin", "Safety margin in microseconds before the predicted presentation time, only relevant in --deadline-scheduling mode (must cover the compositor repaint window)").set_default(8000);
 
     bool& neon             = flag("neon", "Use ARM-NEON instructions when updating texture contents (only valid if --tile-update-method is NOT equal to 'gl')");
     bool& linearFilter     = flag("linear-filter", "Use GL_LINEAR instead of GL_NEAREST for texture min/mag filter");
@@ -46,13 +52,36 @@ struct CommandLineArgumentsParser : public argparse::Args {
     bool& opaque           = flag("o,opaque", "Use opaque window surface");
     bool& unbounded        = flag("u,unbounded", "Use unbounded rendering");
     bool& dmabufTiles      = flag("d,dmabuf-tiles", "Use tiles backed up by dmabuf");
+    bool& presentationFeedback = flag("presentation-feedback", "Request wp_presentation feedback for every commit and report display latency");
+    bool& deadlineScheduling = flag("deadline-scheduling", "Delay rendering after the frame callback, to finish just before the next predicted presentation time");
+    bool& multiProcess = flag("multi-process", "Paint the tiles in a separate painter process and pass them as dma-bufs to the compositor process (requires --dmabuf-tiles)");
+    bool& subsurfaces = flag("subsurfaces", "Attach every tile to its own wl_subsurface and let the compositor blend them, instead of compositing with GL (requires --dmabuf-tiles)");
+    bool& eventThread = flag("event-thread", "Read Wayland events on a dedicated thread and forward buffer releases / frame callbacks to the render thread");
+    bool& gles3 = flag("gles3", "Create an OpenGL ES 3 context instead of an OpenGL ES 2 one (required by --tile-update-method 'pbo')");
+    bool& noProgramCache = flag("no-program-cache", "Always compile the GLSL programs from source, instead of loading cached program binaries");
+    bool& perfCounters = flag("perf-counters", "Count CPU cycles, instructions, cache misses, page faults and context switches (perf_event_open) per pipeline stage");
+    bool& gpuTiming = flag("gpu-timing", "Measure the GPU time of the clear, tile update and composition stages (GL_EXT_disjoint_timer_query)");
+    bool& syncFileFencing = flag("sync-file-fencing", "Wait for the GPU fences of all tiles at once (DMA_BUF_IOCTL_EXPORT_SYNC_FILE) and update the tiles in the order they become writable (requires --tile-update-method 'mmap')");
+    bool& bandwidth = flag("bandwidth", "Count the bytes moved by every stage and compare the achieved bandwidth with a measured memcpy / memset ceiling");
+    bool& premultiply = flag("premultiply", "The --content-format bgra content has straight alpha, premultiply it during the conversion");
+    bool& software = flag("software", "Composite the tiles on the CPU into wl_shm buffers, without GPU / DRM / zwp_linux_dmabuf_v1");
 
     std::string& drmNodeGPU           = kwarg("drm-node-gpu", "DRM node (GPU)").set_default("/dev/dri/card0");
     std::string& drmNodeIPU           = kwarg("drm-node-ipu", "DRM node (IPU)").set_default("/dev/dri/card1");
+    std::string& programCacheDirectory = kwarg("program-cache-dir", "Directory of the program binary cache (GL_OES_get_program_binary), defaults to $XDG_CACHE_HOME/wpe-testbed").set_default("");
+    std::string& contentFile          = kwarg("content-file", "Stream the tile content out of a memory-mapped raw frame sequence instead of painting the checkerboard, see README.md").set_default("");
+    std::string& scenePath            = kwarg("scene", "Replay the layer tree of a JSON scene file instead of compositing the tile grid, see README.md").set_default("");
     std::string& tileUpdateType       = kwarg("tile-update-type", "Tile update type (full|half|third)").set_default("full");
-    std::string& tileUpdateMethod     = kwarg("tile-update-method", "Tile update method (gl|mmap|gbm)").set_default("gl");
+    std::string& tileUpdateMethod     = kwarg("tile-update-method", "Tile update method, 'gpu' paints the tiles with a fragment shader instead of uploading CPU-painted content (gl|mmap|gbm|gpu|pbo)").set_default("gl");
     std::string& tileBufferModifier   = kwarg("tile-buffer-modifier", "Tile buffer DRM modifier, only relevant in --dmabuf-tiles mode (linear|vivante-tiled|vivante-super-tiled)").set_default("linear");
-    std::string& windowBufferModifier = kwarg("window-buffer-modifier", "Window buffer DRM modifier (linear|vivante-tiled|vivante-super-tiled)").set_default("linear");
+    std::string& tileFormat           = kwarg("tile-format", "Tile pixel format, the formats without alpha composite every tile as opaque (abgr8888|xbgr8888|rgb565)").set_default("abgr8888");
+    std::string& contentFormat        = kwarg("content-format", "Byte order of the CPU-painted content, 'bgra' is what Cairo / Skia paint and is converted to the RGBA tiles (rgba|bgra)").set_default("rgba");
+    std::string& contentConversion    = kwarg("content-conversion", "Convert --content-format bgra within the store kernels, or in a pass of its own before them (fused|separate)").set_default("fused");
+    std::string& windowBufferModifier = kwarg("window-buffer-modifier", "Window buffer DRM modifier, 'auto' picks the best modifier supported by the compositor and EGL (linear|vivante-tiled|vivante-super-tiled|auto)").set_default("linear");
+    std::string& bufferPolicy         = kwarg("buffer-policy", "Window buffer selection policy (first-free|fifo|oldest-free|mailbox)").set_default("first-free");
+    std::string& videoFormat          = kwarg("video-format", "Format of the video frames, sampled as external EGLImages (nv12|yuv420)").set_default("nv12");
+    std::string& compositorAnimation  = kwarg("compositor-animation", "Paint the tiles once and only animate their transform / opacity in the composition (none|translate|rotate|scale|fade|all)").set_default("none");
+    std::string& storeKernel          = kwarg("store-kernel", "CPU store kernel, 'auto' uses non-temporal streaming stores for write-combined dma-buf / PBO mappings only (auto|cached|streaming)").set_default("auto");
 
     Application::CommandLineArguments finish() const
     {
@@ -81,6 +110,12 @@ struct CommandLineArgumentsParser : public argparse::Args {
             if (tileUpdateMethod == "gbm")
                 return TileUpdateMethod::MemoryMappingGBM;
 
+            if (tileUpdateMethod == "gpu")
+                return TileUpdateMethod::GPU;
+
+            if (tileUpdateMethod == "pbo")
+                return TileUpdateMethod::PixelBufferObject;
+
             Logger::error("Invalid --tile-update-method='%s'. Aborting!\n", tileUpdateMethod.c_str());
             abort();
             return TileUpdateMethod::GLTexSubImage2D;
@@ -101,6 +136,45 @@ struct CommandLineArgumentsParser : public argparse::Args {
             return BufferModifier::Linear;
         };
 
+        auto parseTileFormat = [&]() {
+            if (tileFormat == "abgr8888")
+                return TileFormat::ABGR8888;
+
+            if (tileFormat == "xbgr8888")
+                return TileFormat::XBGR8888;
+
+            if (tileFormat == "rgb565")
+                return TileFormat::RGB565;
+
+            Logger::error("Invalid --tile-format='%s'. Aborting!\n", tileFormat.c_str());
+            abort();
+            return TileFormat::ABGR8888;
+        };
+
+        auto parseContentFormat = [&]() {
+            if (contentFormat == "rgba")
+                return ContentFormat::RGBA;
+
+            if (contentFormat == "bgra")
+                return ContentFormat::BGRA;
+
+            Logger::error("Invalid --content-format='%s'. Aborting!\n", contentFormat.c_str());
+            abort();
+            return ContentFormat::RGBA;
+        };
+
+        auto parseContentConversion = [&]() {
+            if (contentConversion == "fused")
+                return ContentConversion::Fused;
+
+            if (contentConversion == "separate")
+                return ContentConversion::Separate;
+
+            Logger::error("Invalid --content-conversion='%s'. Aborting!\n", contentConversion.c_str());
+            abort();
+            return ContentConversion::Fused;
+        };
+
         auto parseWindowBufferModifier = [&]() {
             if (windowBufferModifier == "linear")
                 return BufferModifier::Linear;
@@ -111,17 +185,185 @@ struct CommandLineArgumentsParser : public argparse::Args {
             if (windowBufferModifier == "vivante-super-tiled")
                 return BufferModifier::VivanteSuperTiled;
 
+            if (windowBufferModifier == "auto")
+                return BufferModifier::Auto;
+
             Logger::error("Invalid --window-buffer-modifier='%s'. Aborting!\n", windowBufferModifier.c_str());
             abort();
             return BufferModifier::Linear;
         };
 
-        if (parseTileUpdateMethod() != TileUpdateMethod::GLTexSubImage2D && !dmabufTiles) {
-            Logger::error("You cannot use --tile-update-method other than 'gl' without specifying '--dmabuf-tiles'. Aborting!\n");
+        auto parseBufferSelectionPolicy = [&]() {
+            if (bufferPolicy == "first-free")
+                return BufferSelectionPolicy::FirstFree;
+
+            if (bufferPolicy == "fifo")
+                return BufferSelectionPolicy::FIFO;
+
+            if (bufferPolicy == "oldest-free")
+                return BufferSelectionPolicy::OldestFree;
+
+            if (bufferPolicy == "mailbox")
+                return BufferSelectionPolicy::Mailbox;
+
+            Logger::error("Invalid --buffer-policy='%s'. Aborting!\n", bufferPolicy.c_str());
+            abort();
+            return BufferSelectionPolicy::FirstFree;
+        };
+
+        auto parseStoreKernel = [&]() {
+            if (storeKernel == "auto")
+                return StoreKernel::Auto;
+
+            if (storeKernel == "cached")
+                return StoreKernel::Cached;
+
+            if (storeKernel == "streaming")
+                return StoreKernel::Streaming;
+
+            Logger::error("Invalid --store-kernel='%s'. Aborting!\n", storeKernel.c_str());
+            abort();
+            return StoreKernel::Auto;
+        };
+
+        auto parseCompositorAnimation = [&]() {
+            if (compositorAnimation == "none")
+                return CompositorAnimation::None;
+
+            if (compositorAnimation == "translate")
+                return CompositorAnimation::Translate;
+
+            if (compositorAnimation == "rotate")
+                return CompositorAnimation::Rotate;
+
+            if (compositorAnimation == "scale")
+                return CompositorAnimation::Scale;
+
+            if (compositorAnimation == "fade")
+                return CompositorAnimation::Fade;
+
+            if (compositorAnimation == "all")
+                return CompositorAnimation::All;
+
+            Logger::error("Invalid --compositor-animation='%s'. Aborting!\n", compositorAnimation.c_str());
+            abort();
+            return CompositorAnimation::None;
+        };
+
+        auto parseVideoFormat = [&]() {
+            if (videoFormat == "nv12")
+                return VideoFormat::NV12;
+
+            if (videoFormat == "yuv420")
+                return VideoFormat::YUV420;
+
+            Logger::error("Invalid --video-format='%s'. Aborting!\n", videoFormat.c_str());
+            abort();
+            return VideoFormat::NV12;
+        };
+
+        if (bufferCount < 2 || bufferCount > 8) {
+            Logger::error("Invalid --buffers=%u, the swapchain length has to be within [2, 8]. Aborting!\n", bufferCount);
+            abort();
+        }
+
+        if (parseBufferSelectionPolicy() == BufferSelectionPolicy::Mailbox && (unbounded || deadlineScheduling)) {
+            Logger::error("You cannot use --buffer-policy 'mailbox' in combination with --unbounded or --deadline-scheduling. Aborting!\n");
+            abort();
+        }
+
+        if (!isGLTileUpdateMethod(parseTileUpdateMethod()) && !dmabufTiles) {
+            Logger::error("You cannot use --tile-update-method other than 'gl' or 'gpu' without specifying '--dmabuf-tiles'. Aborting!\n");
+            abort();
+        }
+
+        if (software && parseTileUpdateMethod() != TileUpdateMethod::GLTexSubImage2D) {
+            Logger::error("You cannot use --tile-update-method other than 'gl' in combination with --software. Aborting!\n");
+            abort();
+        }
+
+        if (parseTileUpdateMethod() == TileUpdateMethod::PixelBufferObject && !gles3) {
+            Logger::error("You cannot use --tile-update-method 'pbo' without specifying '--gles3'. Aborting!\n");
+            abort();
+        }
+
+        if (syncFileFencing && parseTileUpdateMethod() != TileUpdateMethod::MemoryMappingMMAP) {
+            Logger::error("You cannot use --sync-file-fencing with --tile-update-method other than 'mmap'. Aborting!\n");
+            abort();
+        }
+
+        if (multiProcess && !dmabufTiles) {
+            Logger::error("You cannot use --multi-process without specifying '--dmabuf-tiles'. Aborting!\n");
+            abort();
+        }
+
+        if (subsurfaces && !dmabufTiles) {
+            Logger::error("You cannot use --subsurfaces without specifying '--dmabuf-tiles'. Aborting!\n");
+            abort();
+        }
+
+        // The painter process owns the single buffer of each tile, the subsurfaces need two to paint without racing the compositor.
+        if (subsurfaces && multiProcess) {
+            Logger::error("You cannot use --subsurfaces in combination with --multi-process. Aborting!\n");
+            abort();
+        }
+
+        if (subsurfaces && parseBufferSelectionPolicy() == BufferSelectionPolicy::Mailbox) {
+            Logger::error("You cannot use --subsurfaces in combination with --buffer-policy 'mailbox'. Aborting!\n");
+            abort();
+        }
+
+        if (software && (dmabufTiles || multiProcess || subsurfaces || explicitSync || fences || rbo || depth)) {
+            Logger::error("You cannot use --software in combination with --dmabuf-tiles, --multi-process, --subsurfaces, --explicit-sync, --fences, --rbo or --depth. Aborting!\n");
+            abort();
+        }
+
+        if (!scenePath.empty() && (software || multiProcess || subsurfaces)) {
+            Logger::error("You cannot use --scene in combination with --software, --multi-process or --subsurfaces. Aborting!\n");
+            abort();
+        }
+
+        if (parseCompositorAnimation() != CompositorAnimation::None && (software || subsurfaces || !scenePath.empty())) {
+            Logger::error("You cannot use --compositor-animation in combination with --software, --subsurfaces or --scene. Aborting!\n");
+            abort();
+        }
+
+        if (parseTileFormat() == TileFormat::RGB565 && software) {
+            Logger::error("You cannot use --tile-format rgb565 in combination with --software. Aborting!\n");
+            abort();
+        }
+
+        if (parseContentFormat() == ContentFormat::BGRA && (parseTileUpdateMethod() == TileUpdateMethod::GPU || parseTileFormat() == TileFormat::RGB565)) {
+            Logger::error("You cannot use --content-format bgra in combination with --tile-update-method 'gpu' or --tile-format rgb565. Aborting!\n");
             abort();
         }
 
-        return { frameCount, tileCount, tileWidth, tileHeight, cellSize, neon, linearFilter, depth, blend, explicitSync, noAnimate, clear, circle, rbo, fences, opaque, unbounded, dmabufTiles, drmNodeGPU, drmNodeIPU, parseTileUpdateMethod(), parseTileUpdateType(), parseTileBufferModifier(), parseWindowBufferModifier() };
+        if (!contentFile.empty() && parseTileUpdateMethod() == TileUpdateMethod::GPU) {
+            Logger::error("You cannot use --content-file in combination with --tile-update-method 'gpu'. Aborting!\n");
+            abort();
+        }
+
+        if (premultiply && parseContentFormat() != ContentFormat::BGRA) {
+            Logger::error("You cannot use --premultiply without --content-format bgra. Aborting!\n");
+            abort();
+        }
+
+        if ((videoWidth || videoHeight) && (!videoWidth || !videoHeight || videoWidth % 2 || videoHeight % 2 || !videoFrameRate)) {
+            Logger::error("Invalid --video-width=%u --video-height=%u --video-frame-rate=%u, the chroma planes need even, non-zero dimensions. Aborting!\n", videoWidth, videoHeight, videoFrameRate);
+            abort();
+        }
+
+        if (videoWidth && (software || subsurfaces || !scenePath.empty())) {
+            Logger::error("You cannot use --video-width in combination with --software, --subsurfaces or --scene. Aborting!\n");
+            abort();
+        }
+
+        if (deadlineScheduling && unbounded) {
+            Logger::error("You cannot use --deadline-scheduling in combination with --unbounded. Aborting!\n");
+            abort();
+        }
+
+        return { frameCount, tileCount, tileWidth, tileHeight, cellSize, deadlineMargin, bufferCount, videoWidth, videoHeight, videoFrameRate, neon, linearFilter, depth, blend, explicitSync, noAnimate, clear, circle, rbo, fences, opaque, unbounded, dmabufTiles, presentationFeedback, deadlineScheduling, eventThread, multiProcess, subsurfaces, software, gles3, noProgramCache, perfCounters, gpuTiming, bandwidth, syncFileFencing, premultiply, drmNodeGPU, drmNodeIPU, programCacheDirectory, scenePath, contentFile, parseTileUpdateMethod(), parseTileUpdateType(), parseTileBufferModifier(), parseWindowBufferModifier(), parseBufferSelectionPolicy(), parseStoreKernel(), parseCompositorAnimation(), parseVideoFormat(), parseTileFormat(), parseContentFormat(), parseContentConversion() };
     }
 };
 
@@ -133,6 +375,7 @@ struct Application::Private
     }
 
     bool isRunning { true };
+    int64_t startTime { getCurrentTimeInNanoSeconds() };
     Application::CommandLineArguments args;
     struct sigaction sigintAction;
 };
@@ -178,6 +421,13 @@ Application::CommandLineArguments& Application::commandLineArguments()
     return application->d->args;
 }
 
+int64_t Application::startTime()
+{
+    auto*& application = applicationInstance();
+    assert(application);
+    return application->d->startTime;
+}
+
 void Application::terminate()
 {
     d->isRunning = false;
@@ -25,19 +25,78 @@
 enum class TileUpdateMethod {
     GLTexSubImage2D,
     MemoryMappingMMAP,
-    MemoryMappingGBM
+    MemoryMappingGBM,
+    GPU, // rasterized with a fragment shader into the tile FBO
+    PixelBufferObject // glTexSubImage2D() streamed through a ring of pixel unpack buffers (GLES3)
 };
 
+// Tile updates submitted through GL, as opposed to CPU writes into mapped dma-bufs.
+inline bool isGLTileUpdateMethod(TileUpdateMethod method)
+{
+    return method == TileUpdateMethod::GLTexSubImage2D || method == TileUpdateMethod::GPU || method == TileUpdateMethod::PixelBufferObject;
+}
+
 enum class TileUpdateType {
     FullUpdate,
     HalfUpdate,
     ThirdUpdate
 };
 
+enum class BufferSelectionPolicy {
+    FirstFree,
+    FIFO,
+    OldestFree,
+    Mailbox
+};
+
 enum class BufferModifier {
     Linear,
     VivanteTiled,
-    VivanteSuperTiled
+    VivanteSuperTiled,
+    Auto // window buffers only: negotiated with the compositor and EGL
+};
+
+// --tile-format: RGB565 halves the tile memory traffic of opaque layers, XBGR8888 only drops the alpha channel.
+enum class TileFormat {
+    ABGR8888,
+    XBGR8888, // alpha ignored, every tile is opaque
+    RGB565    // packed from the RGBA content by the store kernels
+};
+
+// --content-format: byte order of the CPU-painted content. BGRA (Cairo / Skia ARGB32 on little endian) is swapped
+// to the RGBA of the tiles, within the store kernels or in a separate pass (--content-conversion).
+enum class ContentFormat {
+    RGBA,
+    BGRA
+};
+
+enum class ContentConversion {
+    Fused,
+    Separate
+};
+
+// CPU store kernels for the tile updates. Write-combined mappings (dma-bufs, PBOs) gain nothing from the
+// caches, the streaming kernels write full 64 byte bursts with non-temporal stores instead.
+enum class StoreKernel {
+    Auto, // streaming into dma-buf / PBO mappings, cached into memory tiles
+    Cached,
+    Streaming
+};
+
+// --compositor-animation: the tiles are painted once, every frame only animates their transform and opacity.
+enum class CompositorAnimation {
+    None,
+    Translate,
+    Rotate,
+    Scale,
+    Fade,
+    All
+};
+
+// --video-format: layout of the decoded video frames, imported as a single multi-planar EGLImage.
+enum class VideoFormat {
+    NV12,  // Y plane + interleaved UV plane
+    YUV420 // Y, U and V planes
 };
 
 class Application {
@@ -50,6 +109,11 @@ public:
         uint32_t tileWidth { 0 };
         uint32_t tileHeight { 0 };
         uint32_t cellSize { 0 };
+        uint32_t deadlineMargin { 0 };
+        uint32_t bufferCount { 0 };
+        uint32_t videoWidth { 0 };
+        uint32_t videoHeight { 0 };
+        uint32_t videoFrameRate { 0 };
 
         bool neon { false };
         bool linearFilter { false };
@@ -64,18 +128,44 @@ public:
         bool opaque { false };
         bool unbounded { false };
         bool dmabufTiles { false };
+        bool presentationFeedback { false };
+        bool deadlineScheduling { false };
+        bool eventThread { false };
+        bool multiProcess { false };
+        bool subsurfaces { false };
+        bool software { false };
+        bool gles3 { false };
+        bool noProgramCache { false };
+        bool perfCounters { false };
+        bool gpuTiming { false };
+        bool bandwidth { false };
+        bool syncFileFencing { false };
+        bool premultiply { false };
 
         std::string drmNodeGPU;
         std::string drmNodeIPU;
+        std::string programCacheDirectory;
+        std::string scenePath;
+        std::string contentFile;
 
         TileUpdateMethod tileUpdateMethod { TileUpdateMethod::GLTexSubImage2D };
         TileUpdateType tileUpdateType { TileUpdateType::FullUpdate };
         BufferModifier tileBufferModifier { BufferModifier::Linear };
         BufferModifier windowBufferModifier { BufferModifier::Linear };
+        BufferSelectionPolicy bufferSelectionPolicy { BufferSelectionPolicy::FirstFree };
+        StoreKernel storeKernel { StoreKernel::Auto };
+        CompositorAnimation compositorAnimation { CompositorAnimation::None };
+        VideoFormat videoFormat { VideoFormat::NV12 };
+        TileFormat tileFormat { TileFormat::ABGR8888 };
+        ContentFormat contentFormat { ContentFormat::RGBA };
+        ContentConversion contentConversion { ContentConversion::Fused };
     };
 
     static CommandLineArguments& commandLineArguments();
 
+    // CLOCK_MONOTONIC time at which the application was created.
+    static int64_t startTime();
+
     void terminate();
     bool isRunning() const;
 
@@ -0,0 +1,206 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "BandwidthCounters.h"
+
+#include "Application.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+BandwidthCounters* BandwidthCounters::s_bandwidthCounters = nullptr;
+
+static constexpr std::array<const char*, BandwidthCounters::stageCount> stageNames = {
+    "content generation",
+    "content conversion",
+    "texture upload",
+    "mapped store",
+    "video decode",
+    "pixel buffer upload",
+    "GPU paint",
+    "software composition",
+    "GPU composition",
+};
+
+static const char* tileUpdateMethodName(TileUpdateMethod method)
+{
+    switch (method) {
+    case TileUpdateMethod::GLTexSubImage2D:
+        return "gl";
+    case TileUpdateMethod::MemoryMappingMMAP:
+        return "mmap";
+    case TileUpdateMethod::MemoryMappingGBM:
+        return "gbm";
+    case TileUpdateMethod::GPU:
+        return "gpu";
+    case TileUpdateMethod::PixelBufferObject:
+        return "pbo";
+    }
+
+    return "unknown";
+}
+
+// STREAM-like probe: best of a few passes over buffers well beyond the last-level cache.
+static void measureBandwidthCeiling(double& copyBytesPerSecond, double& fillBytesPerSecond)
+{
+    static constexpr size_t bufferSize = 64 * 1024 * 1024;
+    static constexpr uint32_t passes = 5;
+
+    copyBytesPerSecond = fillBytesPerSecond = 0;
+
+    std::unique_ptr<uint8_t, decltype(&free)> source(static_cast<uint8_t*>(aligned_alloc(64, bufferSize)), &free);
+    std::unique_ptr<uint8_t, decltype(&free)> destination(static_cast<uint8_t*>(aligned_alloc(64, bufferSize)), &free);
+    if (!source || !destination)
+        return;
+
+    // Fault the pages in before timing.
+    memset(source.get(), 1, bufferSize);
+    memset(destination.get(), 0, bufferSize);
+
+    volatile uint8_t sink = 0;
+    int64_t bestCopyTime = INT64_MAX;
+    int64_t bestFillTime = INT64_MAX;
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        auto startTime = getCurrentTimeInNanoSeconds();
+        memcpy(destination.get(), source.get(), bufferSize);
+        auto copyTime = getCurrentTimeInNanoSeconds() - startTime;
+        sink = sink + destination.get()[pass];
+
+        startTime = getCurrentTimeInNanoSeconds();
+        memset(destination.get(), int(pass), bufferSize);
+        auto fillTime = getCurrentTimeInNanoSeconds() - startTime;
+        sink = sink + destination.get()[bufferSize - 1];
+
+        bestCopyTime = std::min(bestCopyTime, copyTime);
+        bestFillTime = std::min(bestFillTime, fillTime);
+    }
+
+    copyBytesPerSecond = double(2 * bufferSize) * double(nsPerSecond) / double(std::max<int64_t>(bestCopyTime, 1));
+    fillBytesPerSecond = double(bufferSize) * double(nsPerSecond) / double(std::max<int64_t>(bestFillTime, 1));
+}
+
+void BandwidthCounters::initialize()
+{
+    auto& args = Application::commandLineArguments();
+    if (!args.bandwidth)
+        return;
+
+    static std::unique_ptr<BandwidthCounters> s_owner = std::make_unique<BandwidthCounters>();
+    s_bandwidthCounters = s_owner.get();
+    s_bandwidthCounters->reset();
+}
+
+bool BandwidthCounters::isCPUStage(Stage stage)
+{
+    switch (stage) {
+    case Stage::ContentGeneration:
+    case Stage::ContentConversion:
+    case Stage::TextureUpload:
+    case Stage::MappedStore:
+    case Stage::VideoDecode:
+    case Stage::SoftwareComposition:
+        return true;
+    case Stage::PixelBufferUpload:
+    case Stage::GPUPaint:
+    case Stage::GPUComposition:
+        break;
+    }
+
+    return false;
+}
+
+void BandwidthCounters::add(Stage stage, uint64_t bytes, int64_t timeInNanoSeconds)
+{
+    auto& traffic = m_stages[static_cast<uint32_t>(stage)];
+    traffic.bytes += bytes;
+    traffic.timeInNanoSeconds += timeInNanoSeconds;
+}
+
+void BandwidthCounters::reset()
+{
+    m_stages = { };
+    m_startTimeInNanoSeconds = getCurrentTimeInNanoSeconds();
+}
+
+void BandwidthCounters::report(uint64_t frames) const
+{
+    if (!frames)
+        return;
+
+    auto& args = Application::commandLineArguments();
+    const double bytesPerGB = 1e9;
+    const double bytesPerMB = 1e6;
+    const double elapsedSeconds = double(getCurrentTimeInNanoSeconds() - m_startTimeInNanoSeconds) / double(nsPerSecond);
+
+    double copyBytesPerSecond = 0;
+    double fillBytesPerSecond = 0;
+    measureBandwidthCeiling(copyBytesPerSecond, fillBytesPerSecond);
+
+    Logger::info("Memory traffic (--tile-update-method %s), ceiling: copy %.2f GB/s, fill %.2f GB/s\n", tileUpdateMethodName(args.tileUpdateMethod),
+                 copyBytesPerSecond / bytesPerGB, fillBytesPerSecond / bytesPerGB);
+
+    auto percentOfCeiling = [&](double bytesPerSecond) {
+        return copyBytesPerSecond > 0 ? 100.0 * bytesPerSecond / copyBytesPerSecond : 0.0;
+    };
+
+    uint64_t totalBytes = 0;
+    for (uint32_t stage = 0; stage < stageCount; ++stage) {
+        auto& traffic = m_stages[stage];
+        if (!traffic.bytes)
+            continue;
+
+        totalBytes += traffic.bytes;
+        Logger::info("  %-22s %9.2f MB/frame", stageNames[stage], double(traffic.bytes) / double(frames) / bytesPerMB);
+
+        // CPU stages: bandwidth achieved while running. GPU stages: traffic demanded over the whole run.
+        if (isCPUStage(static_cast<Stage>(stage)) && traffic.timeInNanoSeconds > 0) {
+            double bytesPerSecond = double(traffic.bytes) * double(nsPerSecond) / double(traffic.timeInNanoSeconds);
+            Logger::info("  %7.2f GB/s achieved  (%5.1f%% of copy ceiling)\n", bytesPerSecond / bytesPerGB, percentOfCeiling(bytesPerSecond));
+        } else if (elapsedSeconds > 0) {
+            double bytesPerSecond = double(traffic.bytes) / elapsedSeconds;
+            Logger::info("  %7.2f GB/s sustained (%5.1f%% of copy ceiling)\n", bytesPerSecond / bytesPerGB, percentOfCeiling(bytesPerSecond));
+        } else
+            Logger::info("\n");
+    }
+
+    if (elapsedSeconds > 0) {
+        double bytesPerSecond = double(totalBytes) / elapsedSeconds;
+        Logger::info("  %-22s %9.2f MB/frame  %7.2f GB/s sustained (%5.1f%% of copy ceiling)\n", "total", double(totalBytes) / double(frames) / bytesPerMB,
+                     bytesPerSecond / bytesPerGB, percentOfCeiling(bytesPerSecond));
+    }
+}
+
+BandwidthScope::BandwidthScope(BandwidthCounters::Stage stage, uint64_t bytes)
+    : m_counters(BandwidthCounters::singleton())
+    , m_stage(stage)
+    , m_bytes(bytes)
+{
+    if (m_counters)
+        m_startTimeInNanoSeconds = getCurrentTimeInNanoSeconds();
+}
+
+BandwidthScope::~BandwidthScope()
+{
+    if (m_counters)
+        m_counters->add(m_stage, m_bytes, getCurrentTimeInNanoSeconds() - m_startTimeInNanoSeconds);
+}
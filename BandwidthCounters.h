@@ -0,0 +1,77 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Memory traffic per pipeline stage for --bandwidth, in bytes read + written (a copy counts twice, as in
+// STREAM). CPU stages also accumulate the time spent, so their achieved bandwidth can be compared with
+// the copy / fill ceiling measured at exit. GPU stages only report the traffic they demand per second.
+class BandwidthCounters {
+public:
+    enum class Stage : uint8_t {
+        ContentGeneration, // CPU: source pattern written by Tile::createRandomContent()
+        ContentConversion, // CPU: --content-conversion separate, BGRA content read + RGBA staging write
+        TextureUpload, // CPU: glTexSubImage2D() from client memory, source read + texture write
+        MappedStore, // CPU: store kernels through gbm / mmap / PBO mappings or into memory tiles
+        VideoDecode, // CPU: synthetic video frames written into the YUV dma-bufs
+        PixelBufferUpload, // GPU: pixel unpack buffer copied into the texture
+        GPUPaint, // GPU: --tile-update-method gpu pattern rendered into the tile
+        SoftwareComposition, // CPU: tile read (+ destination read with --blend) + destination write
+        GPUComposition // GPU: tile texels sampled (+ destination read with --blend) + window buffer write
+    };
+    static constexpr uint32_t stageCount = 9;
+
+    // Creates the counters for the calling process if --bandwidth is passed.
+    static void initialize();
+    static BandwidthCounters* singleton() { return s_bandwidthCounters; }
+
+    static bool isCPUStage(Stage);
+
+    void add(Stage, uint64_t bytes, int64_t timeInNanoSeconds = 0);
+
+    void reset();
+    void report(uint64_t frames) const;
+
+private:
+    static BandwidthCounters* s_bandwidthCounters;
+
+    struct StageTraffic {
+        uint64_t bytes { 0 };
+        int64_t timeInNanoSeconds { 0 };
+    };
+
+    std::array<StageTraffic, stageCount> m_stages;
+    int64_t m_startTimeInNanoSeconds { 0 };
+};
+
+// Adds the bytes moved by a CPU stage together with the time spent in its lifetime, no-op without --bandwidth.
+class BandwidthScope {
+public:
+    BandwidthScope(BandwidthCounters::Stage, uint64_t bytes);
+    ~BandwidthScope();
+
+private:
+    BandwidthCounters* m_counters { nullptr };
+    BandwidthCounters::Stage m_stage;
+    uint64_t m_bytes { 0 };
+    int64_t m_startTimeInNanoSeconds { 0 };
+};
@@ -0,0 +1,177 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ContentSource.h"
+
+#include "Application.h"
+#include "BandwidthCounters.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "Tile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ContentSource* ContentSource::s_contentSource = nullptr;
+
+ContentSource::ContentSource(void* mappedAddress, size_t mappedSize, uint32_t width, uint32_t height, uint32_t frameCount, uint32_t stride)
+    : m_mappedAddress(mappedAddress)
+    , m_mappedSize(mappedSize)
+    , m_width(width)
+    , m_height(height)
+    , m_frameCount(frameCount)
+    , m_stride(stride)
+{
+}
+
+ContentSource::~ContentSource()
+{
+    if (m_mappedAddress)
+        munmap(m_mappedAddress, m_mappedSize);
+}
+
+std::unique_ptr<ContentSource> ContentSource::create(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Logger::error("Failed to open the content file '%s'\n", path.c_str());
+        return nullptr;
+    }
+
+    struct stat fileStatus;
+    if (fstat(fd, &fileStatus) < 0 || size_t(fileStatus.st_size) < headerSize) {
+        Logger::error("The content file '%s' is too short for its header\n", path.c_str());
+        close(fd);
+        return nullptr;
+    }
+
+    // The mapping keeps the file referenced, the FD is not needed afterwards.
+    const size_t mappedSize = fileStatus.st_size;
+    void* mappedAddress = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappedAddress == MAP_FAILED) {
+        Logger::error("Failed to mmap() the content file '%s'\n", path.c_str());
+        return nullptr;
+    }
+
+    uint32_t header[4];
+    memcpy(header, mappedAddress, sizeof(header));
+    auto contentSource = std::make_unique<ContentSource>(mappedAddress, mappedSize, header[0], header[1], header[2], header[3]);
+
+    auto& source = *contentSource;
+    const uint64_t frameSize = uint64_t(source.m_stride) * source.m_height;
+    if (!source.m_width || !source.m_height || !source.m_frameCount || source.m_stride < uint64_t(source.m_width) * sizeof(uint32_t) || source.m_stride % sizeof(uint32_t)
+        || !frameSize || source.m_frameCount > (mappedSize - headerSize) / frameSize) {
+        Logger::error("Invalid content file '%s': %ux%u, %u frames, stride %u in %zu bytes\n", path.c_str(), source.m_width, source.m_height,
+                      source.m_frameCount, source.m_stride, mappedSize);
+        return nullptr;
+    }
+
+    // advance() runs ahead of each update, so the first update shows frame 0.
+    source.m_currentFrame = source.m_frameCount - 1;
+
+    // Played front to back: the kernel reads ahead aggressively and may drop the pages behind.
+    if (madvise(mappedAddress, mappedSize, MADV_SEQUENTIAL) < 0)
+        Logger::info("madvise(MADV_SEQUENTIAL) failed for the content file\n");
+    source.prefetchFrame(0);
+
+    Logger::info("Content file: %ux%u, %u frames (%.1f MB)\n", source.m_width, source.m_height, source.m_frameCount, double(mappedSize) / (1024.0 * 1024.0));
+    return contentSource;
+}
+
+bool ContentSource::initialize()
+{
+    auto& args = Application::commandLineArguments();
+    if (args.contentFile.empty())
+        return true;
+
+    static std::unique_ptr<ContentSource> s_owner = create(args.contentFile);
+    s_contentSource = s_owner.get();
+    return !!s_contentSource;
+}
+
+const uint8_t* ContentSource::frame(uint32_t index) const
+{
+    return static_cast<const uint8_t*>(m_mappedAddress) + headerSize + size_t(index) * m_stride * m_height;
+}
+
+void ContentSource::prefetchFrame(uint32_t index) const
+{
+    // madvise() needs a page aligned start address.
+    static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(frame(index)) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(frame(index)) + size_t(m_stride) * m_height;
+    madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+}
+
+void ContentSource::advance()
+{
+    m_currentFrame = (m_currentFrame + 1) % m_frameCount;
+    ++m_playedFrames;
+
+    // Read in the background, while the current frame is streamed into the tiles.
+    if (m_frameCount > 1)
+        prefetchFrame((m_currentFrame + 1) % m_frameCount);
+}
+
+uint8_t* ContentSource::tileContent(uint32_t tileIndex, uint32_t tileWidth, uint32_t tileHeight, const TileDamage& damage)
+{
+    PerfCounterScope scope(PerfCounters::Scope::ContentGeneration);
+    BandwidthScope bandwidthScope(BandwidthCounters::Stage::ContentGeneration, uint64_t(damage.width) * damage.height * sizeof(uint32_t) * 2);
+
+    if (m_content.size() < size_t(damage.width) * damage.height)
+        m_content.resize(size_t(damage.width) * damage.height);
+
+    const uint32_t columns = std::max(1u, m_width / tileWidth);
+    const uint32_t x = ((tileIndex % columns) * tileWidth + damage.x) % m_width;
+    const uint32_t y = ((tileIndex / columns) * tileHeight + damage.y) % m_height;
+
+    const uint8_t* source = frame(m_currentFrame);
+    for (uint32_t row = 0; row < damage.height; ++row) {
+        auto* sourceRow = reinterpret_cast<const uint32_t*>(source + size_t((y + row) % m_height) * m_stride);
+        uint32_t* destinationRow = m_content.data() + size_t(row) * damage.width;
+
+        // Copied in pieces up to the right frame edge, wrapping around to its left edge.
+        for (uint32_t column = 0; column < damage.width;) {
+            const uint32_t sourceColumn = (x + column) % m_width;
+            const uint32_t count = std::min(damage.width - column, m_width - sourceColumn);
+            memcpy(destinationRow + column, sourceRow + sourceColumn, count * sizeof(uint32_t));
+            column += count;
+        }
+    }
+
+    m_streamedBytes += uint64_t(damage.width) * damage.height * sizeof(uint32_t);
+    return reinterpret_cast<uint8_t*>(m_content.data());
+}
+
+void ContentSource::report() const
+{
+    if (!m_streamedBytes)
+        return;
+
+    Logger::info("Content file: %llu frames played (%llu loops of %u frames), %.2f MB streamed into the tiles\n",
+                 static_cast<unsigned long long>(m_playedFrames), static_cast<unsigned long long>(m_playedFrames / m_frameCount), m_frameCount,
+                 double(m_streamedBytes) / (1024.0 * 1024.0));
+}
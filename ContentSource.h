@@ -0,0 +1,76 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct TileDamage;
+
+// --content-file: a pre-rendered raw frame sequence, memory-mapped and streamed into the tiles instead of the
+// checkerboard. The file starts with a 16 byte header of little endian uint32_t values: width, height, frame
+// count and stride (bytes per row, at least width * 4). The frames follow back to back, 4 bytes per pixel in
+// the --content-format byte order. See scripts/create-content-file.sh.
+class ContentSource {
+public:
+    ContentSource(void* mappedAddress, size_t mappedSize, uint32_t width, uint32_t height, uint32_t frameCount, uint32_t stride);
+    ~ContentSource();
+
+    static std::unique_ptr<ContentSource> create(const std::string& path);
+
+    // Maps the --content-file for the calling process, if any. Returns false if it cannot be used.
+    static bool initialize();
+    static ContentSource* singleton() { return s_contentSource; }
+
+    static constexpr size_t headerSize = 4 * sizeof(uint32_t);
+
+    // Moves on to the next frame of the sequence, looping at its end.
+    void advance();
+
+    // Copies the damaged area of a tile out of the current frame. The tiles cover the frame in rows, like the tile
+    // grid covers a window of the frame width, and wrap around at the frame edges.
+    uint8_t* tileContent(uint32_t tileIndex, uint32_t tileWidth, uint32_t tileHeight, const TileDamage&);
+
+    void report() const;
+
+private:
+    const uint8_t* frame(uint32_t index) const;
+    // Starts reading the frame from the file ahead of time.
+    void prefetchFrame(uint32_t index) const;
+
+    static ContentSource* s_contentSource;
+
+    void* m_mappedAddress { nullptr };
+    size_t m_mappedSize { 0 };
+
+    uint32_t m_width { 0 };
+    uint32_t m_height { 0 };
+    uint32_t m_frameCount { 0 };
+    uint32_t m_stride { 0 };
+
+    uint32_t m_currentFrame { 0 };
+    uint64_t m_playedFrames { 0 };
+    uint64_t m_streamedBytes { 0 };
+
+    std::vector<uint32_t> m_content; // the damaged area of the tile being updated
+};
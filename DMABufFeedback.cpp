@@ -0,0 +1,201 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "DMABufFeedback.h"
+
+#include "Logger.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+static void feedback_done(void* data, struct zwp_linux_dmabuf_feedback_v1*)
+{
+    static_cast<DMABufFeedback*>(data)->done();
+}
+
+static void feedback_format_table(void* data, struct zwp_linux_dmabuf_feedback_v1*, int32_t fd, uint32_t size)
+{
+    static_cast<DMABufFeedback*>(data)->setFormatTable(fd, size);
+}
+
+static void feedback_main_device(void* data, struct zwp_linux_dmabuf_feedback_v1*, struct wl_array* device)
+{
+    static_cast<DMABufFeedback*>(data)->setMainDevice(device);
+}
+
+static void feedback_tranche_done(void* data, struct zwp_linux_dmabuf_feedback_v1*)
+{
+    static_cast<DMABufFeedback*>(data)->trancheDone();
+}
+
+static void feedback_tranche_target_device(void* data, struct zwp_linux_dmabuf_feedback_v1*, struct wl_array* device)
+{
+    static_cast<DMABufFeedback*>(data)->setTrancheTargetDevice(device);
+}
+
+static void feedback_tranche_formats(void* data, struct zwp_linux_dmabuf_feedback_v1*, struct wl_array* indices)
+{
+    static_cast<DMABufFeedback*>(data)->addTrancheFormats(indices);
+}
+
+static void feedback_tranche_flags(void* data, struct zwp_linux_dmabuf_feedback_v1*, uint32_t flags)
+{
+    static_cast<DMABufFeedback*>(data)->setTrancheFlags(flags);
+}
+
+static const struct zwp_linux_dmabuf_feedback_v1_listener feedback_listener = {
+    .done = feedback_done,
+    .format_table = feedback_format_table,
+    .main_device = feedback_main_device,
+    .tranche_done = feedback_tranche_done,
+    .tranche_target_device = feedback_tranche_target_device,
+    .tranche_formats = feedback_tranche_formats,
+    .tranche_flags = feedback_tranche_flags
+};
+
+static dev_t deviceFromArray(struct wl_array* array)
+{
+    dev_t device = 0;
+    assert(array->size == sizeof(device));
+    memcpy(&device, array->data, sizeof(device));
+    return device;
+}
+
+DMABufFeedback::DMABufFeedback(struct zwp_linux_dmabuf_feedback_v1* feedback)
+    : m_feedback(feedback)
+{
+    zwp_linux_dmabuf_feedback_v1_add_listener(m_feedback, &feedback_listener, this);
+}
+
+DMABufFeedback::~DMABufFeedback()
+{
+    if (m_formatTable)
+        munmap(const_cast<FormatTableEntry*>(m_formatTable), m_formatTableSize);
+
+    zwp_linux_dmabuf_feedback_v1_destroy(m_feedback);
+}
+
+std::unique_ptr<DMABufFeedback> DMABufFeedback::create(struct zwp_linux_dmabuf_feedback_v1* feedback)
+{
+    if (!feedback)
+        return nullptr;
+    return std::make_unique<DMABufFeedback>(feedback);
+}
+
+void DMABufFeedback::setFormatTable(int32_t fd, uint32_t size)
+{
+    if (m_formatTable)
+        munmap(const_cast<FormatTableEntry*>(m_formatTable), m_formatTableSize);
+
+    // The table has to be mapped MAP_PRIVATE, the compositor shares it with other clients.
+    auto* table = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (table == MAP_FAILED) {
+        Logger::error("Failed to map the dma-buf feedback format table.\n");
+        m_formatTable = nullptr;
+        m_formatTableSize = 0;
+        return;
+    }
+
+    m_formatTable = static_cast<const FormatTableEntry*>(table);
+    m_formatTableSize = size;
+}
+
+void DMABufFeedback::setMainDevice(struct wl_array* device)
+{
+    m_mainDevice = deviceFromArray(device);
+}
+
+void DMABufFeedback::setTrancheTargetDevice(struct wl_array* device)
+{
+    m_pendingTranche.targetDevice = deviceFromArray(device);
+}
+
+void DMABufFeedback::setTrancheFlags(uint32_t flags)
+{
+    m_pendingTranche.scanout = flags & ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT;
+}
+
+void DMABufFeedback::addTrancheFormats(struct wl_array* indices)
+{
+    if (!m_formatTable)
+        return;
+
+    const uint32_t entries = m_formatTableSize / sizeof(FormatTableEntry);
+    auto* index = static_cast<const uint16_t*>(indices->data);
+    for (size_t i = 0; i < indices->size / sizeof(uint16_t); ++i) {
+        if (index[i] < entries)
+            m_pendingTranche.formats.emplace_back(m_formatTable[index[i]].format, m_formatTable[index[i]].modifier);
+    }
+}
+
+void DMABufFeedback::trancheDone()
+{
+    m_pendingTranches.push_back(std::move(m_pendingTranche));
+    m_pendingTranche = Tranche { };
+}
+
+void DMABufFeedback::done()
+{
+    // The compositor resends the whole feedback on every change.
+    m_tranches = std::move(m_pendingTranches);
+    m_pendingTranches.clear();
+    m_done = true;
+    ++m_generation;
+}
+
+std::vector<uint64_t> DMABufFeedback::modifiersForFormat(uint32_t trancheIndex, uint32_t format) const
+{
+    std::vector<uint64_t> modifiers;
+    for (auto& [trancheFormat, modifier] : m_tranches[trancheIndex].formats) {
+        if (trancheFormat == format)
+            modifiers.push_back(modifier);
+    }
+
+    return modifiers;
+}
+
+std::optional<uint32_t> DMABufFeedback::trancheForBuffer(uint32_t format, uint64_t modifier) const
+{
+    for (uint32_t i = 0; i < m_tranches.size(); ++i) {
+        for (auto& [trancheFormat, trancheModifier] : m_tranches[i].formats) {
+            if (trancheFormat == format && trancheModifier == modifier)
+                return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void DMABufFeedback::report(const char* name) const
+{
+    Logger::info("%s dma-buf feedback: main device %u:%u, %zu tranches\n", name, major(m_mainDevice), minor(m_mainDevice), m_tranches.size());
+    for (uint32_t i = 0; i < m_tranches.size(); ++i) {
+        auto& tranche = m_tranches[i];
+        Logger::info("  tranche %u: target device %u:%u%s, %zu format/modifier pairs\n", i, major(tranche.targetDevice), minor(tranche.targetDevice),
+                     tranche.scanout ? ", scanout" : "", tranche.formats.size());
+    }
+}
@@ -0,0 +1,86 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+struct wl_array;
+struct zwp_linux_dmabuf_feedback_v1;
+
+// Parses zwp_linux_dmabuf_feedback_v1 (linux-dmabuf v4): the format table and
+// the tranches, ordered by compositor preference. A scanout tranche lists the
+// format/modifier pairs that qualify for direct scanout on its target device.
+class DMABufFeedback {
+public:
+    explicit DMABufFeedback(struct zwp_linux_dmabuf_feedback_v1*);
+    ~DMABufFeedback();
+
+    static std::unique_ptr<DMABufFeedback> create(struct zwp_linux_dmabuf_feedback_v1*);
+
+    struct Tranche {
+        dev_t targetDevice { 0 };
+        bool scanout { false };
+        std::vector<std::pair<uint32_t, uint64_t>> formats; // format, modifier
+    };
+
+    bool isDone() const { return m_done; }
+    uint32_t generation() const { return m_generation; }
+    dev_t mainDevice() const { return m_mainDevice; }
+    const std::vector<Tranche>& tranches() const { return m_tranches; }
+
+    std::vector<uint64_t> modifiersForFormat(uint32_t trancheIndex, uint32_t format) const;
+    std::optional<uint32_t> trancheForBuffer(uint32_t format, uint64_t modifier) const;
+    void report(const char* name) const;
+
+    // zwp_linux_dmabuf_feedback_v1 events
+    void setFormatTable(int32_t fd, uint32_t size);
+    void setMainDevice(struct wl_array*);
+    void setTrancheTargetDevice(struct wl_array*);
+    void setTrancheFlags(uint32_t);
+    void addTrancheFormats(struct wl_array*);
+    void trancheDone();
+    void done();
+
+private:
+    struct zwp_linux_dmabuf_feedback_v1* m_feedback { nullptr };
+
+    // Each format table entry: format, padding, modifier.
+    struct FormatTableEntry {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    };
+
+    const FormatTableEntry* m_formatTable { nullptr };
+    uint32_t m_formatTableSize { 0 };
+
+    dev_t m_mainDevice { 0 };
+    std::vector<Tranche> m_tranches;
+    std::vector<Tranche> m_pendingTranches;
+    Tranche m_pendingTranche;
+    bool m_done { false };
+    uint32_t m_generation { 0 };
+};
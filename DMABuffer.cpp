@@ -50,11 +50,10 @@ static inline int gbm_bo_get_fd_for_plane(struct gbm_bo* bo, int plane)
 #endif
 
 DMABuffer::DMABuffer(Role role, const EGL& egl, uint32_t format, uint32_t width, uint32_t height)
-    : m_role(role)
+    : WaylandBuffer(width, height)
+    , m_role(role)
     , m_egl(egl)
     , m_format(format)
-    , m_width(width)
-    , m_height(height)
 {
 }
 
@@ -81,13 +80,6 @@ DMABuffer::~DMABuffer()
         m_eglImage = 0;
     }
 
-    /* FIXME
-    if (buf->buffer) {
-        wl_buffer_destroy(buf->buffer);
-        buf->buffer = nullptr;
-    }
-    */
-
     if (m_gbmBufferObject) {
         gbm_bo_destroy(m_gbmBufferObject);
         m_gbmBufferObject = nullptr;
@@ -101,11 +93,65 @@ DMABuffer::~DMABuffer()
     }
 }
 
-std::unique_ptr<DMABuffer> DMABuffer::create(Role role, const DRM& drm, const GBM& gbm, const EGL& egl, uint32_t format, uint32_t width, uint32_t height)
+uint64_t DMABuffer::colorBufferSize() const
+{
+    // The chroma planes of the 4:2:0 formats have half the height.
+    uint64_t size = 0;
+    for (uint32_t plane = 0; plane < m_planeCount; ++plane)
+        size += uint64_t(m_strides[plane]) * (plane && isYUVFormat(m_format) ? m_height / 2 : m_height);
+    return size;
+}
+
+bool DMABuffer::isYUVFormat(uint32_t format)
+{
+    return format == DRM_FORMAT_NV12 || format == DRM_FORMAT_YUV420;
+}
+
+std::unique_ptr<DMABuffer> DMABuffer::create(Role role, const DRM& drm, const GBM& gbm, const EGL& egl, uint32_t format, uint32_t width, uint32_t height, const std::vector<uint64_t>& modifiers)
 {
     auto dmaBuffer = std::make_unique<DMABuffer>(role, egl, format, width, height);
-    if (!dmaBuffer->allocateBufferObject(drm, gbm))
+    if (!dmaBuffer->allocateBufferObject(drm, gbm, modifiers))
+        return nullptr;
+    if (!dmaBuffer->createGLFrameBuffer())
         return nullptr;
+    return dmaBuffer;
+}
+
+std::vector<std::unique_ptr<DMABuffer>> DMABuffer::createBatch(Role role, const DRM& drm, const GBM& gbm, const EGL& egl, uint32_t format, uint32_t width, uint32_t height, uint32_t count)
+{
+    // Keep the GBM allocations and the EGL imports together, instead of alternating between the kernel
+    // allocator and the GL driver for every buffer.
+    std::vector<std::unique_ptr<DMABuffer>> buffers;
+    buffers.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto dmaBuffer = std::make_unique<DMABuffer>(role, egl, format, width, height);
+        if (!dmaBuffer->allocateBufferObject(drm, gbm, { }))
+            return { };
+        buffers.push_back(std::move(dmaBuffer));
+    }
+
+    for (auto& dmaBuffer : buffers) {
+        if (!dmaBuffer->createGLFrameBuffer())
+            return { };
+    }
+
+    return buffers;
+}
+
+std::unique_ptr<DMABuffer> DMABuffer::createFromFDs(Role role, const EGL& egl, uint32_t format, uint32_t width, uint32_t height, uint64_t modifier,
+                                                    uint32_t planeCount, const int32_t* fds, const uint32_t* strides, const uint32_t* offsets)
+{
+    assert(planeCount <= maxBufferPlanes);
+
+    auto dmaBuffer = std::make_unique<DMABuffer>(role, egl, format, width, height);
+    dmaBuffer->m_modifier = modifier;
+    dmaBuffer->m_planeCount = planeCount;
+    for (uint32_t i = 0; i < planeCount; ++i) {
+        dmaBuffer->m_dmabufFD[i] = fds[i];
+        dmaBuffer->m_strides[i] = strides[i];
+        dmaBuffer->m_offsets[i] = offsets[i];
+    }
+
     if (!dmaBuffer->createGLFrameBuffer())
         return nullptr;
     return dmaBuffer;
@@ -120,36 +166,38 @@ inline uint64_t bufferModifierToDRMModifier(const BufferModifier& bufferModifier
         return DRM_FORMAT_MOD_VIVANTE_TILED;
     case BufferModifier::VivanteSuperTiled:
         return DRM_FORMAT_MOD_VIVANTE_SUPER_TILED;
+    case BufferModifier::Auto:
+        // Resolved by the caller, see WaylandWindow::createWindowBuffer().
+        break;
     }
 
     abort();
     return DRM_FORMAT_MOD_LINEAR;
 }
 
-bool DMABuffer::allocateBufferObject(const DRM& drm, const GBM& gbm)
+bool DMABuffer::allocateBufferObject(const DRM& drm, const GBM& gbm, const std::vector<uint64_t>& requestedModifiers)
 {
     auto& args = Application::commandLineArguments();
 
     uint32_t flags = GBM_BO_USE_RENDERING;
-
-    uint32_t modifiersCount = 1;
-    uint64_t* modifiers = static_cast<uint64_t*>(malloc(sizeof(uint64_t)));
-    if (m_role == Role::WindowBuffer) {
-        *modifiers = bufferModifierToDRMModifier(args.windowBufferModifier);
+    if (m_role == Role::WindowBuffer)
         flags |= GBM_BO_USE_SCANOUT;
-    } else
-        *modifiers = bufferModifierToDRMModifier(args.tileBufferModifier);
+    else if (m_role == Role::VideoBuffer)
+        flags = GBM_BO_USE_LINEAR; // written by the CPU, only sampled by the GPU
+
+    std::vector<uint64_t> modifiers = requestedModifiers;
+    if (modifiers.empty())
+        modifiers.push_back(bufferModifierToDRMModifier(m_role == Role::WindowBuffer ? args.windowBufferModifier : args.tileBufferModifier));
 
-    if (modifiersCount > 0) {
+    if (!modifiers.empty()) {
 #ifdef HAVE_GBM_BO_CREATE_WITH_MODIFIERS2
-        m_gbmBufferObject = gbm_bo_create_with_modifiers2(gbm.device(), m_width, m_height, m_format, modifiers, modifiersCount, flags);
+        m_gbmBufferObject = gbm_bo_create_with_modifiers2(gbm.device(), m_width, m_height, m_format, modifiers.data(), modifiers.size(), flags);
 #else
         (void)flags;
-        m_gbmBufferObject = gbm_bo_create_with_modifiers(gbm.device(), m_width, m_height, m_format, modifiers, modifiersCount);
+        m_gbmBufferObject = gbm_bo_create_with_modifiers(gbm.device(), m_width, m_height, m_format, modifiers.data(), modifiers.size());
 #endif
         if (m_gbmBufferObject)
             m_modifier = gbm_bo_get_modifier(m_gbmBufferObject);
-        free(modifiers);
     }
 
     // Fallback.
@@ -158,18 +206,15 @@ bool DMABuffer::allocateBufferObject(const DRM& drm, const GBM& gbm)
         m_modifier = DRM_FORMAT_MOD_INVALID;
     }
 
+    if (!m_gbmBufferObject && m_role == Role::VideoBuffer)
+        return allocateYUVBufferObjectAsR8(drm, gbm);
+
     if (!m_gbmBufferObject)
         return false;
 
     m_planeCount = gbm_bo_get_plane_count(m_gbmBufferObject);
     for (uint32_t i = 0; i < m_planeCount; ++i) {
-        if (args.tileUpdateMethod == TileUpdateMethod::GLTexSubImage2D)
-            m_dmabufFD[i] = gbm_bo_get_fd_for_plane(m_gbmBufferObject, i);
-        else {
-            const uint32_t handle = gbm_bo_get_handle(m_gbmBufferObject).u32;
-            drmPrimeHandleToFD(drm.fd(), handle, DRM_RDWR | DRM_CLOEXEC, &m_dmabufFD[i]);
-        }
-
+        m_dmabufFD[i] = exportPlaneFD(drm, i, i);
         m_strides[i] = gbm_bo_get_stride_for_plane(m_gbmBufferObject, i);
         m_offsets[i] = gbm_bo_get_offset(m_gbmBufferObject, i);
     }
@@ -177,9 +222,53 @@ bool DMABuffer::allocateBufferObject(const DRM& drm, const GBM& gbm)
     return true;
 }
 
+bool DMABuffer::allocateYUVBufferObjectAsR8(const DRM& drm, const GBM& gbm)
+{
+    // Not every GBM backend allocates YUV formats: lay the planes out one after the other in a linear R8
+    // buffer of 1.5 times the height instead, all planes share its handle.
+    assert(isYUVFormat(m_format) && !(m_width % 2) && !(m_height % 2));
+    m_gbmBufferObject = gbm_bo_create(gbm.device(), m_width, m_height * 3 / 2, DRM_FORMAT_R8, GBM_BO_USE_LINEAR);
+    if (!m_gbmBufferObject)
+        return false;
+
+    const uint32_t stride = gbm_bo_get_stride(m_gbmBufferObject);
+    m_modifier = DRM_FORMAT_MOD_LINEAR;
+    if (m_format == DRM_FORMAT_NV12) {
+        m_planeCount = 2;
+        m_strides[0] = m_strides[1] = stride;
+        m_offsets[0] = 0;
+        m_offsets[1] = stride * m_height;
+    } else {
+        m_planeCount = 3;
+        m_strides[0] = stride;
+        m_strides[1] = m_strides[2] = stride / 2;
+        m_offsets[0] = 0;
+        m_offsets[1] = stride * m_height;
+        m_offsets[2] = m_offsets[1] + stride / 2 * m_height / 2;
+    }
+
+    for (uint32_t i = 0; i < m_planeCount; ++i)
+        m_dmabufFD[i] = exportPlaneFD(drm, i, 0);
+    return true;
+}
+
+int DMABuffer::exportPlaneFD(const DRM& drm, uint32_t plane, uint32_t handlePlane) const
+{
+    // The GL update methods only need a read-only FD, the CPU writes (mmap, gbm, video decoding) need DRM_RDWR.
+    auto& args = Application::commandLineArguments();
+    if (isGLTileUpdateMethod(args.tileUpdateMethod) && m_role != Role::VideoBuffer && plane == handlePlane)
+        return gbm_bo_get_fd_for_plane(m_gbmBufferObject, plane);
+
+    // Every plane has its own handle, even if they usually all point to the same buffer object.
+    int fd = -1;
+    const uint32_t handle = gbm_bo_get_handle_for_plane(m_gbmBufferObject, handlePlane).u32;
+    drmPrimeHandleToFD(drm.fd(), handle, DRM_RDWR | DRM_CLOEXEC, &fd);
+    return fd;
+}
+
 bool DMABuffer::createGLFrameBuffer()
 {
-    static constexpr uint32_t generalAttributes = 3;
+    static constexpr uint32_t generalAttributes = 5;
     static constexpr uint32_t planeAttributes = 5;
     static constexpr uint32_t entriesPerAttribute = 2;
 
@@ -193,6 +282,14 @@ bool DMABuffer::createGLFrameBuffer()
     eglAttributes[attributeIndex++] = EGL_LINUX_DRM_FOURCC_EXT;
     eglAttributes[attributeIndex++] = m_format;
 
+    // Synthetic video is BT.709 with limited range, as most decoded video.
+    if (isYUVFormat(m_format)) {
+        eglAttributes[attributeIndex++] = EGL_YUV_COLOR_SPACE_HINT_EXT;
+        eglAttributes[attributeIndex++] = EGL_ITU_REC709_EXT;
+        eglAttributes[attributeIndex++] = EGL_SAMPLE_RANGE_HINT_EXT;
+        eglAttributes[attributeIndex++] = EGL_YUV_NARROW_RANGE_EXT;
+    }
+
 #define ADD_PLANE_ATTRIBS(planeIndex)                                                          \
     {                                                                                          \
         eglAttributes[attributeIndex++] = EGL_DMA_BUF_PLANE##planeIndex##_FD_EXT;              \
@@ -231,20 +328,24 @@ bool DMABuffer::createGLFrameBuffer()
         return false;
     }
 
-    eglMakeCurrent(m_egl.display(), EGL_NO_SURFACE, EGL_NO_SURFACE, m_egl.context());
+    // EGL::initialize() made the context current, it stays current.
+    assert(eglGetCurrentContext() == m_egl.context());
+
+    const bool isTile = m_role != Role::WindowBuffer;
 
-    const bool isTile = m_format == DRM_FORMAT_ABGR8888;
+    // YUV images can only be sampled through external textures, the driver converts to RGB.
+    const GLenum target = m_role == Role::VideoBuffer ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D;
 
     // skip FBO creation for tiles or in rbo mode
     auto& args = Application::commandLineArguments();
     if (!args.rbo || isTile) {
         glGenTextures(1, &m_glTexture);
-        glBindTexture(GL_TEXTURE_2D, m_glTexture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, args.linearFilter ? GL_LINEAR : GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, args.linearFilter ? GL_LINEAR : GL_NEAREST);
-        m_egl.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, m_eglImage);
+        glBindTexture(target, m_glTexture);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, args.linearFilter ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, args.linearFilter ? GL_LINEAR : GL_NEAREST);
+        m_egl.glEGLImageTargetTexture2DOES(target, m_eglImage);
     }
 
     if (isTile)
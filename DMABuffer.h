@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include "WaylandBuffer.h"
+
 #include <memory>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
@@ -30,17 +33,26 @@ class DRM;
 class EGL;
 class GBM;
 
-class DMABuffer {
+class DMABuffer final : public WaylandBuffer {
 public:
     enum class Role {
         TileBuffer,
-        WindowBuffer
+        WindowBuffer,
+        VideoBuffer // linear YUV, sampled through GL_TEXTURE_EXTERNAL_OES
     };
 
     DMABuffer(Role, const EGL&, uint32_t format, uint32_t width, uint32_t height);
-    ~DMABuffer();
+    ~DMABuffer() override;
+
+    // A non-empty modifier list (in order of preference) overrides the command line modifier.
+    static std::unique_ptr<DMABuffer> create(Role, const DRM&, const GBM&, const EGL&, uint32_t format, uint32_t width, uint32_t height, const std::vector<uint64_t>& modifiers = { });
+
+    // Allocates all buffer objects first, then imports them into EGL. Returns an empty vector on failure.
+    static std::vector<std::unique_ptr<DMABuffer>> createBatch(Role, const DRM&, const GBM&, const EGL&, uint32_t format, uint32_t width, uint32_t height, uint32_t count);
 
-    static std::unique_ptr<DMABuffer> create(Role, const DRM&, const GBM&, const EGL&, uint32_t format, uint32_t width, uint32_t height);
+    // Imports a buffer allocated by another process, takes ownership of the plane FDs.
+    static std::unique_ptr<DMABuffer> createFromFDs(Role, const EGL&, uint32_t format, uint32_t width, uint32_t height, uint64_t modifier,
+                                                    uint32_t planeCount, const int32_t* fds, const uint32_t* strides, const uint32_t* offsets);
 
     static constexpr uint32_t maxBufferPlanes = 4;
 
@@ -48,8 +60,6 @@ public:
     GLuint glFrameBuffer() const { return m_glFrameBuffer; }
     GLuint glTexture() const { return m_glTexture; }
 
-    uint32_t width() const { return m_width; }
-    uint32_t height() const { return m_height; }
     uint32_t format() const { return m_format; }
     uint64_t modifier() const { return m_modifier; }
 
@@ -58,34 +68,21 @@ public:
     uint32_t offsetForPlane(uint32_t plane) const { return m_offsets[plane]; }
     int32_t dmabufFDForPlane(uint32_t plane) const { return m_dmabufFD[plane]; }
 
-    // Wayland support
-    struct wl_buffer* wlBuffer() const { return m_wlBuffer; }
-    void setWaylandBuffer(struct wl_buffer* buffer) { m_wlBuffer = buffer; }
-
-    struct zwp_linux_buffer_release_v1* zwpLinuxBufferReleaseV1() const { return m_zwpLinuxBufferReleaseV1; }
-    void setBufferRelease(struct zwp_linux_buffer_release_v1* release) { m_zwpLinuxBufferReleaseV1 = release; }
-
-    int32_t releaseFenceFD() const { return m_releaseFenceFD; }
-    void setReleaseFenceFD(int32_t fd) { m_releaseFenceFD = fd; }
+    uint64_t colorBufferSize() const override;
 
-    bool isInUse() const { return m_isInUse; }
-    void setIsInUse(bool isInUse) { m_isInUse = isInUse; }
+    static bool isYUVFormat(uint32_t format);
 
 private:
-    bool allocateBufferObject(const DRM&, const GBM&);
+    bool allocateBufferObject(const DRM&, const GBM&, const std::vector<uint64_t>& modifiers);
+    bool allocateYUVBufferObjectAsR8(const DRM&, const GBM&);
+    int exportPlaneFD(const DRM&, uint32_t plane, uint32_t handlePlane) const;
     bool createGLFrameBuffer();
 
     Role m_role { Role::TileBuffer };
 
     const EGL& m_egl;
     struct gbm_bo* m_gbmBufferObject { nullptr };
-    struct wl_buffer* m_wlBuffer { nullptr };
-    struct zwp_linux_buffer_release_v1* m_zwpLinuxBufferReleaseV1 { nullptr };
 
-    bool m_isInUse { false };
-    int32_t m_releaseFenceFD { -1 };
-    uint32_t m_width { 0 };
-    uint32_t m_height { 0 };
     uint32_t m_format { 0 };
     uint64_t m_modifier { 0 };
     uint32_t m_planeCount { 0 };
@@ -22,7 +22,9 @@
 #include "Application.h"
 #include "DRM.h"
 #include "GBM.h"
+#include "GPUTimer.h"
 #include "Logger.h"
+#include "ProgramCache.h"
 
 #include <cassert>
 #include <cstdio>
@@ -46,6 +48,8 @@ EGL::EGL(EGLDisplay&& display)
 EGL::~EGL()
 {
     assert(m_display != EGL_NO_DISPLAY);
+    m_programCache.reset();
+    m_gpuTimer.reset();
     eglTerminate(m_display);
     eglReleaseThread();
 }
@@ -64,7 +68,7 @@ void EGL::dumpEGLInformation()
 void EGL::dumpGLInformation()
 {
     Logger::info("\n===================================\n");
-    Logger::info("OpenGL ES 2.x information:\n");
+    Logger::info("OpenGL ES %s information:\n", m_isGLES3 ? "3.x" : "2.x");
     Logger::info("  version: \"%s\"\n", glGetString(GL_VERSION));
     Logger::info("  shading language version: \"%s\"\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
     Logger::info("  vendor: \"%s\"\n", glGetString(GL_VENDOR));
@@ -136,11 +140,31 @@ void EGL::initializeExtensions()
     if (hasEGLExtension(displayExtensionString, "EGL_ANDROID_native_fence_sync"))
         eglDupNativeFenceFDANDROID = reinterpret_cast<decltype(eglDupNativeFenceFDANDROID)>(eglGetProcAddress("eglDupNativeFenceFDANDROID"));
 
+    if (hasEGLExtension(displayExtensionString, "EGL_EXT_image_dma_buf_import_modifiers"))
+        eglQueryDmaBufModifiersEXT = reinterpret_cast<decltype(eglQueryDmaBufModifiersEXT)>(eglGetProcAddress("eglQueryDmaBufModifiersEXT"));
+
     const char* glExtensionString = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
     if (hasEGLExtension(glExtensionString, "GL_OES_EGL_image_external")) {
         glEGLImageTargetTexture2DOES = reinterpret_cast<decltype(glEGLImageTargetTexture2DOES)>(eglGetProcAddress("glEGLImageTargetTexture2DOES"));
         glEGLImageTargetRenderbufferStorageOES = reinterpret_cast<decltype(glEGLImageTargetRenderbufferStorageOES)>(eglGetProcAddress("glEGLImageTargetRenderbufferStorageOES"));
     }
+
+    if (m_isGLES3 && hasEGLExtension(glExtensionString, "GL_EXT_buffer_storage"))
+        glBufferStorageEXT = reinterpret_cast<decltype(glBufferStorageEXT)>(eglGetProcAddress("glBufferStorageEXT"));
+
+    if (hasEGLExtension(glExtensionString, "GL_OES_get_program_binary")) {
+        glGetProgramBinaryOES = reinterpret_cast<decltype(glGetProgramBinaryOES)>(eglGetProcAddress("glGetProgramBinaryOES"));
+        glProgramBinaryOES = reinterpret_cast<decltype(glProgramBinaryOES)>(eglGetProcAddress("glProgramBinaryOES"));
+    }
+
+    if (hasEGLExtension(glExtensionString, "GL_EXT_disjoint_timer_query")) {
+        glGenQueriesEXT = reinterpret_cast<decltype(glGenQueriesEXT)>(eglGetProcAddress("glGenQueriesEXT"));
+        glDeleteQueriesEXT = reinterpret_cast<decltype(glDeleteQueriesEXT)>(eglGetProcAddress("glDeleteQueriesEXT"));
+        glBeginQueryEXT = reinterpret_cast<decltype(glBeginQueryEXT)>(eglGetProcAddress("glBeginQueryEXT"));
+        glEndQueryEXT = reinterpret_cast<decltype(glEndQueryEXT)>(eglGetProcAddress("glEndQueryEXT"));
+        glGetQueryObjectuivEXT = reinterpret_cast<decltype(glGetQueryObjectuivEXT)>(eglGetProcAddress("glGetQueryObjectuivEXT"));
+        glGetQueryObjectui64vEXT = reinterpret_cast<decltype(glGetQueryObjectui64vEXT)>(eglGetProcAddress("glGetQueryObjectui64vEXT"));
+    }
 }
 
 void EGL::initialize()
@@ -150,7 +174,7 @@ void EGL::initialize()
     EGLint numberOfConfig;
     EGLint configAttributes[] = {
         EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RENDERABLE_TYPE, args.gles3 ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT,
         EGL_RED_SIZE, 8,
         EGL_GREEN_SIZE, 8,
         EGL_BLUE_SIZE, 8,
@@ -158,8 +182,8 @@ void EGL::initialize()
         EGL_NONE
     };
 
-    static const EGLint contextAttributes[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_CLIENT_VERSION, args.gles3 ? 3 : 2,
         EGL_NONE
     };
 
@@ -168,12 +192,25 @@ void EGL::initialize()
     assert(numberOfConfig);
 
     m_context = eglCreateContext(m_display, configs[0], EGL_NO_CONTEXT, contextAttributes);
+    if (m_context == EGL_NO_CONTEXT) {
+        Logger::error("Failed to create an OpenGL ES %d context. Aborting!\n", args.gles3 ? 3 : 2);
+        abort();
+    }
+    m_isGLES3 = args.gles3;
 
     // connect the context to the surface
     EGLBoolean makeCurrent = eglMakeCurrent(m_display, EGL_NO_CONTEXT, EGL_NO_CONTEXT, m_context);
     assert(makeCurrent == EGL_TRUE);
 
     initializeExtensions();
+
+    m_programCache = ProgramCache::create(*this);
+
+    if (args.gpuTiming) {
+        m_gpuTimer = GPUTimer::create(*this);
+        if (!m_gpuTimer)
+            Logger::info("GL_EXT_disjoint_timer_query is not supported, --gpu-timing is ignored.\n");
+    }
 }
 
 int EGL::createFenceFD() const
@@ -208,3 +245,35 @@ void EGL::clientWaitFence(EGLSyncKHR sync) const
 {
     eglClientWaitSyncKHR(m_display, sync, 0, EGL_FOREVER_KHR);
 }
+
+std::vector<uint64_t> EGL::renderableModifiers(uint32_t format) const
+{
+    if (!eglQueryDmaBufModifiersEXT)
+        return { };
+
+    EGLint count = 0;
+    if (!eglQueryDmaBufModifiersEXT(m_display, format, 0, nullptr, nullptr, &count) || !count)
+        return { };
+
+    std::vector<EGLuint64KHR> modifiers(count);
+    std::vector<EGLBoolean> externalOnly(count);
+    eglQueryDmaBufModifiersEXT(m_display, format, count, modifiers.data(), externalOnly.data(), &count);
+
+    std::vector<uint64_t> renderable;
+    for (EGLint i = 0; i < count; ++i) {
+        if (!externalOnly[i])
+            renderable.push_back(modifiers[i]);
+    }
+
+    return renderable;
+}
+
+void EGL::waitFenceFD(int fd) const
+{
+    EGLint attributeList[] = { EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fd, EGL_NONE };
+    auto fence = eglCreateSyncKHR(m_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attributeList);
+    assert(fence != EGL_NO_SYNC_KHR);
+
+    eglWaitSyncKHR(m_display, fence, 0);
+    eglDestroySyncKHR(m_display, fence);
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
@@ -28,6 +29,8 @@
 #include <GLES2/gl2ext.h>
 
 class GBM;
+class GPUTimer;
+class ProgramCache;
 
 struct wl_display;
 
@@ -43,6 +46,10 @@ public:
     EGLDisplay display() const { return m_display; }
     EGLContext context() const { return m_context; }
     bool supportsExplicitSync() const { return eglDupNativeFenceFDANDROID != nullptr; }
+    bool isGLES3() const { return m_isGLES3; }
+    ProgramCache& programCache() const { return *m_programCache; }
+    // --gpu-timing, nullptr without GL_EXT_disjoint_timer_query.
+    GPUTimer* gpuTimer() const { return m_gpuTimer.get(); }
 
     int createFenceFD() const;
     EGLSyncKHR createFence() const;
@@ -50,6 +57,13 @@ public:
 
     void clientWaitFence(EGLSyncKHR) const;
 
+    // Server-side wait on a native fence FD, takes ownership of the FD.
+    void waitFenceFD(int) const;
+
+    // Modifiers EGL can import the format with and render to (excludes external-only modifiers).
+    // Empty if EGL_EXT_image_dma_buf_import_modifiers is not supported.
+    std::vector<uint64_t> renderableModifiers(uint32_t format) const;
+
     // Exposed EGL functions
     PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR { nullptr };
     PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR { nullptr };
@@ -58,10 +72,20 @@ public:
     PFNEGLWAITSYNCKHRPROC eglWaitSyncKHR { nullptr };
     PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR { nullptr };
     PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID { nullptr };
+    PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT { nullptr };
 
     // Exposed GL functions
     PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES { nullptr };
     PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glEGLImageTargetRenderbufferStorageOES { nullptr };
+    PFNGLBUFFERSTORAGEEXTPROC glBufferStorageEXT { nullptr };
+    PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES { nullptr };
+    PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES { nullptr };
+    PFNGLGENQUERIESEXTPROC glGenQueriesEXT { nullptr };
+    PFNGLDELETEQUERIESEXTPROC glDeleteQueriesEXT { nullptr };
+    PFNGLBEGINQUERYEXTPROC glBeginQueryEXT { nullptr };
+    PFNGLENDQUERYEXTPROC glEndQueryEXT { nullptr };
+    PFNGLGETQUERYOBJECTUIVEXTPROC glGetQueryObjectuivEXT { nullptr };
+    PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64vEXT { nullptr };
 
 private:
     void initializeExtensions();
@@ -70,4 +94,7 @@ private:
 
     EGLDisplay m_display { EGL_NO_DISPLAY };
     EGLContext m_context { EGL_NO_CONTEXT };
+    bool m_isGLES3 { false };
+    std::unique_ptr<ProgramCache> m_programCache;
+    std::unique_ptr<GPUTimer> m_gpuTimer;
 };
@@ -0,0 +1,142 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "FrameScheduler.h"
+
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+FrameScheduler::FrameScheduler(clockid_t clock, int64_t marginInNanoSeconds)
+    : m_clock(clock)
+    , m_margin(marginInNanoSeconds)
+{
+}
+
+void FrameScheduler::didReceiveFrameCallback()
+{
+    auto now = getCurrentTimeInNanoSeconds(m_clock);
+
+    if (!m_hasPresentationTimes) {
+        // Measure the vsync period from the frame callback intervals (exponential moving average).
+        // Intervals spanning more than one refresh (missed frames) are ignored.
+        if (m_lastFrameCallbackTime) {
+            auto interval = now - m_lastFrameCallbackTime;
+            if (!m_vsyncPeriod)
+                m_vsyncPeriod = interval;
+            else if (interval < m_vsyncPeriod * 3 / 2)
+                m_vsyncPeriod = (7 * m_vsyncPeriod + interval) / 8;
+        }
+
+        m_vsyncTime = now;
+    }
+
+    m_lastFrameCallbackTime = now;
+}
+
+void FrameScheduler::didPresentFrame(int64_t presentationTime, uint32_t refresh)
+{
+    if (!refresh)
+        return;
+
+    m_hasPresentationTimes = true;
+    m_vsyncTime = std::max(m_vsyncTime, presentationTime);
+    m_vsyncPeriod = refresh;
+}
+
+int64_t FrameScheduler::predictedRenderCost() const
+{
+    if (!m_renderCostHistoryCount)
+        return 0;
+
+    // Use the 90th percentile of the recent history, to be robust against outliers.
+    std::array<int64_t, renderCostHistorySize> costs;
+    auto end = std::copy_n(m_renderCostHistory.begin(), m_renderCostHistoryCount, costs.begin());
+    auto nth = costs.begin() + (m_renderCostHistoryCount * 9) / 10;
+    std::nth_element(costs.begin(), nth, end);
+    return *nth;
+}
+
+int64_t FrameScheduler::predictedPresentationTime(int64_t earliestPresentationTime) const
+{
+    if (earliestPresentationTime <= m_vsyncTime)
+        return m_vsyncTime + m_vsyncPeriod;
+
+    auto vsyncs = (earliestPresentationTime - m_vsyncTime + m_vsyncPeriod - 1) / m_vsyncPeriod;
+    return m_vsyncTime + vsyncs * m_vsyncPeriod;
+}
+
+int64_t FrameScheduler::waitForRenderStart()
+{
+    if (!m_vsyncPeriod || !m_vsyncTime)
+        return 0;
+
+    auto now = getCurrentTimeInNanoSeconds(m_clock);
+    auto cost = predictedRenderCost();
+    auto targetPresentationTime = predictedPresentationTime(now + cost + m_margin);
+
+    auto renderStartTime = targetPresentationTime - cost - m_margin;
+    if (renderStartTime > now)
+        sleepUntil(renderStartTime);
+
+    return targetPresentationTime;
+}
+
+void FrameScheduler::sleepUntil(int64_t time)
+{
+    auto sleep = [](clockid_t clock, int64_t time) {
+        struct timespec wakeup = { static_cast<time_t>(time / nsPerSecond), static_cast<long>(time % nsPerSecond) };
+        int result;
+        while ((result = clock_nanosleep(clock, TIMER_ABSTIME, &wakeup, nullptr)) == EINTR) { }
+        return result;
+    };
+
+    if (!m_sleepOnMonotonicClock) {
+        int result = sleep(m_clock, time);
+        if (!result)
+            return;
+
+        // CLOCK_MONOTONIC_RAW (preferred by some compositors for wp_presentation) cannot be slept on.
+        if (result != ENOTSUP && result != EINVAL) {
+            Logger::error("clock_nanosleep() failed on the presentation clock (%d): %s\n", m_clock, strerror(result));
+            abort();
+        }
+
+        Logger::info("clock_nanosleep() is not supported on the presentation clock (%d), sleeping on CLOCK_MONOTONIC instead\n", m_clock);
+        m_sleepOnMonotonicClock = true;
+    }
+
+    // The offset between the clocks drifts (CLOCK_MONOTONIC is slewed by NTP), sample it for every sleep.
+    auto monotonicTime = time - getCurrentTimeInNanoSeconds(m_clock) + getCurrentTimeInNanoSeconds(CLOCK_MONOTONIC);
+    if (int result = sleep(CLOCK_MONOTONIC, monotonicTime)) {
+        Logger::error("clock_nanosleep() failed on CLOCK_MONOTONIC: %s\n", strerror(result));
+        abort();
+    }
+}
+
+void FrameScheduler::didFinishRendering(int64_t renderStartTime, int64_t renderEndTime)
+{
+    m_renderCostHistory[m_renderCostHistoryIndex] = renderEndTime - renderStartTime;
+    m_renderCostHistoryIndex = (m_renderCostHistoryIndex + 1) % renderCostHistorySize;
+    m_renderCostHistoryCount = std::min(m_renderCostHistoryCount + 1, renderCostHistorySize);
+}
@@ -0,0 +1,66 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+
+// Delays the start of a frame, so that painting + composition finishes just
+// before the next predicted presentation time, instead of right after the
+// frame callback arrived. All timestamps are in the presentation clock domain.
+class FrameScheduler {
+public:
+    FrameScheduler(clockid_t, int64_t marginInNanoSeconds);
+
+    static constexpr uint32_t renderCostHistorySize = 32;
+
+    clockid_t clock() const { return m_clock; }
+    int64_t margin() const { return m_margin; }
+
+    void didReceiveFrameCallback();
+    void didPresentFrame(int64_t presentationTime, uint32_t refresh);
+
+    // Sleeps until the predicted render start time. Returns the presentation
+    // time the frame is targeting, or 0 if no prediction is possible yet.
+    int64_t waitForRenderStart();
+    void didFinishRendering(int64_t renderStartTime, int64_t renderEndTime);
+
+private:
+    int64_t predictedRenderCost() const;
+    int64_t predictedPresentationTime(int64_t earliestPresentationTime) const;
+    // Sleeps until the given time of the presentation clock.
+    void sleepUntil(int64_t time);
+
+    clockid_t m_clock { CLOCK_MONOTONIC };
+    int64_t m_margin { 0 };
+    bool m_sleepOnMonotonicClock { false }; // the presentation clock does not support clock_nanosleep()
+
+    std::array<int64_t, renderCostHistorySize> m_renderCostHistory { };
+    uint32_t m_renderCostHistoryIndex { 0 };
+    uint32_t m_renderCostHistoryCount { 0 };
+
+    // Either the last presentation timestamp (wp_presentation), or the
+    // arrival time of the last frame callback (measured vsync).
+    int64_t m_vsyncTime { 0 };
+    int64_t m_vsyncPeriod { 0 };
+    bool m_hasPresentationTimes { false };
+    int64_t m_lastFrameCallbackTime { 0 };
+};
@@ -0,0 +1,143 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "GPUTimer.h"
+
+#include "EGL.h"
+
+#include <cassert>
+
+GPUTimer::GPUTimer(const EGL& egl)
+    : m_egl(egl)
+{
+    for (auto& frame : m_frames)
+        m_egl.glGenQueriesEXT(stageCount, frame.queries.data());
+
+    // Clear any disjoint event that happened before the first frame.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+}
+
+GPUTimer::~GPUTimer()
+{
+    for (auto& frame : m_frames)
+        m_egl.glDeleteQueriesEXT(stageCount, frame.queries.data());
+}
+
+std::unique_ptr<GPUTimer> GPUTimer::create(const EGL& egl)
+{
+    if (!egl.glGenQueriesEXT)
+        return nullptr;
+
+    return std::make_unique<GPUTimer>(egl);
+}
+
+const char* GPUTimer::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::DepthClear:
+        return "depth/stencil clear";
+    case Stage::TileUpdate:
+        return "tile update";
+    case Stage::ColorClear:
+        return "color clear";
+    case Stage::Composition:
+        return "composition";
+    }
+
+    return "unknown";
+}
+
+void GPUTimer::beginFrame()
+{
+    assert(!m_isRecording);
+
+    // The slot to record into still holds the oldest unfinished frame: drop it instead of waiting.
+    if (m_pendingFrames == frameLatency) {
+        --m_pendingFrames;
+        ++m_droppedFrames;
+    }
+
+    m_frames[m_currentFrame].used.fill(false);
+    m_isRecording = true;
+}
+
+void GPUTimer::endFrame()
+{
+    assert(m_isRecording && !m_isTimingStage);
+
+    m_isRecording = false;
+    m_currentFrame = (m_currentFrame + 1) % frameLatency;
+    ++m_pendingFrames;
+}
+
+void GPUTimer::beginStage(Stage stage)
+{
+    auto index = static_cast<uint32_t>(stage);
+    auto& frame = m_frames[m_currentFrame];
+    assert(m_isRecording && !m_isTimingStage && !frame.used[index]);
+
+    m_egl.glBeginQueryEXT(GL_TIME_ELAPSED_EXT, frame.queries[index]);
+    frame.used[index] = true;
+    m_isTimingStage = true;
+}
+
+void GPUTimer::endStage()
+{
+    assert(m_isTimingStage);
+
+    m_egl.glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+    m_isTimingStage = false;
+}
+
+bool GPUTimer::takeResult(StageTimes& times)
+{
+    while (m_pendingFrames) {
+        auto& frame = m_frames[(m_currentFrame + frameLatency - m_pendingFrames) % frameLatency];
+        for (uint32_t stage = 0; stage < stageCount; ++stage) {
+            if (!frame.used[stage])
+                continue;
+
+            GLuint available = GL_FALSE;
+            m_egl.glGetQueryObjectuivEXT(frame.queries[stage], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+            if (!available)
+                return false;
+        }
+
+        --m_pendingFrames;
+
+        // A disjoint event (frequency change, context loss, ...) invalidates the results in flight.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            ++m_disjointFrames;
+            continue;
+        }
+
+        for (uint32_t stage = 0; stage < stageCount; ++stage) {
+            GLuint64 elapsed = 0;
+            if (frame.used[stage])
+                m_egl.glGetQueryObjectui64vEXT(frame.queries[stage], GL_QUERY_RESULT_EXT, &elapsed);
+            times[stage] = static_cast<int64_t>(elapsed);
+        }
+        return true;
+    }
+
+    return false;
+}
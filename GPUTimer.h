@@ -0,0 +1,104 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+class EGL;
+
+// GPU time per frame stage for --gpu-timing, through GL_EXT_disjoint_timer_query. The queries of a
+// frame are read back a few frames later without waiting; frames whose results are not available
+// by the time their slot of the ring is reused, or that overlap a disjoint event, are dropped.
+class GPUTimer {
+public:
+    enum class Stage : uint8_t {
+        DepthClear, // --depth: depth / stencil clear of the window buffer
+        TileUpdate, // GL tile uploads or --tile-update-method gpu painting
+        ColorClear, // --clear
+        Composition // tile draws
+    };
+    static constexpr uint32_t stageCount = 4;
+
+    using StageTimes = std::array<int64_t, stageCount>; // nanoseconds, 0 if the stage was not executed
+
+    GPUTimer(const EGL&);
+    ~GPUTimer();
+
+    // Returns nullptr if GL_EXT_disjoint_timer_query is not supported.
+    static std::unique_ptr<GPUTimer> create(const EGL&);
+
+    static const char* stageName(Stage);
+
+    void beginFrame();
+    void endFrame();
+
+    // Only one stage can be timed at once, stages do not nest.
+    void beginStage(Stage);
+    void endStage();
+
+    // Returns the stage times of the oldest frame with available results, never blocks.
+    bool takeResult(StageTimes&);
+
+    uint64_t droppedFrames() const { return m_droppedFrames; }
+    uint64_t disjointFrames() const { return m_disjointFrames; }
+
+private:
+    static constexpr uint32_t frameLatency = 4;
+
+    struct FrameQueries {
+        std::array<GLuint, stageCount> queries { };
+        std::array<bool, stageCount> used { };
+    };
+
+    const EGL& m_egl;
+    std::array<FrameQueries, frameLatency> m_frames;
+    uint32_t m_currentFrame { 0 }; // slot being recorded
+    uint32_t m_pendingFrames { 0 }; // recorded slots preceding m_currentFrame, waiting for their results
+    bool m_isRecording { false };
+    bool m_isTimingStage { false };
+
+    uint64_t m_droppedFrames { 0 };
+    uint64_t m_disjointFrames { 0 };
+};
+
+// Times a stage of the current frame, no-op without a timer.
+class GPUTimerScope {
+public:
+    GPUTimerScope(GPUTimer* timer, GPUTimer::Stage stage)
+        : m_timer(timer)
+    {
+        if (m_timer)
+            m_timer->beginStage(stage);
+    }
+
+    ~GPUTimerScope()
+    {
+        if (m_timer)
+            m_timer->endStage();
+    }
+
+private:
+    GPUTimer* m_timer { nullptr };
+};
@@ -0,0 +1,137 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "IPC.h"
+
+#include "Logger.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace IPC {
+
+Channel::Channel(int fd)
+    : m_fd(fd)
+{
+}
+
+Channel::~Channel()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>> Channel::createPair()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+        Logger::error("Failed to create IPC socket pair: %s\n", strerror(errno));
+        return { };
+    }
+
+    return { std::make_unique<Channel>(fds[0]), std::make_unique<Channel>(fds[1]) };
+}
+
+bool Channel::send(const void* header, size_t headerSize, const void* payload, size_t payloadSize, const int* fds, uint32_t fdCount)
+{
+    assert(fdCount <= maxFDsPerMessage);
+    assert(headerSize + payloadSize <= maxMessageSize);
+
+    struct iovec iov[2] = {
+        { const_cast<void*>(header), headerSize },
+        { const_cast<void*>(payload), payloadSize }
+    };
+
+    struct msghdr message = { };
+    message.msg_iov = iov;
+    message.msg_iovlen = payloadSize ? 2 : 1;
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxFDsPerMessage)];
+    if (fdCount) {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fdCount);
+
+        auto* controlMessage = CMSG_FIRSTHDR(&message);
+        controlMessage->cmsg_level = SOL_SOCKET;
+        controlMessage->cmsg_type = SCM_RIGHTS;
+        controlMessage->cmsg_len = CMSG_LEN(sizeof(int) * fdCount);
+        memcpy(CMSG_DATA(controlMessage), fds, sizeof(int) * fdCount);
+    }
+
+    ssize_t result;
+    do {
+        result = sendmsg(m_fd, &message, MSG_NOSIGNAL);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+        Logger::error("Failed to send IPC message: %s\n", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+ssize_t Channel::receive(void* buffer, size_t bufferSize, int* fds, uint32_t* fdCount)
+{
+    struct iovec iov = { buffer, bufferSize };
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxFDsPerMessage)];
+    struct msghdr message = { };
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t result;
+    do {
+        result = recvmsg(m_fd, &message, MSG_CMSG_CLOEXEC);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+        Logger::error("Failed to receive IPC message: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        Logger::error("Truncated IPC message.\n");
+        return -1;
+    }
+
+    uint32_t receivedFDs = 0;
+    for (auto* controlMessage = CMSG_FIRSTHDR(&message); controlMessage; controlMessage = CMSG_NXTHDR(&message, controlMessage)) {
+        if (controlMessage->cmsg_level != SOL_SOCKET || controlMessage->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        auto count = (controlMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        assert(fds && receivedFDs + count <= maxFDsPerMessage);
+        memcpy(fds + receivedFDs, CMSG_DATA(controlMessage), sizeof(int) * count);
+        receivedFDs += count;
+    }
+
+    if (fdCount)
+        *fdCount = receivedFDs;
+
+    return result;
+}
+
+}
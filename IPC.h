@@ -0,0 +1,98 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include "DMABuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <sys/types.h>
+
+// Messages exchanged between the painter process (WebProcess) and the
+// compositor process (UIProcess). Timestamps are CLOCK_MONOTONIC, which
+// is shared by both processes.
+namespace IPC {
+
+enum class MessageType : uint32_t {
+    TileAnnouncement, // painter -> compositor, carries the plane FDs
+    FrameRequest,     // compositor -> painter
+    FrameUpdate,      // painter -> compositor, followed by one TileDamage per tile, optionally carries a fence FD
+    Quit              // compositor -> painter
+};
+
+struct TileAnnouncement {
+    MessageType type { MessageType::TileAnnouncement };
+    uint32_t tileIndex { 0 };
+    uint32_t width { 0 };
+    uint32_t height { 0 };
+    uint32_t format { 0 };
+    uint32_t planeCount { 0 };
+    uint64_t modifier { 0 };
+    uint32_t strides[DMABuffer::maxBufferPlanes] { 0 };
+    uint32_t offsets[DMABuffer::maxBufferPlanes] { 0 };
+};
+
+struct FrameRequest {
+    MessageType type { MessageType::FrameRequest };
+    uint32_t padding { 0 };
+    uint64_t frame { 0 };
+    int64_t sendTime { 0 };
+};
+
+struct FrameUpdate {
+    MessageType type { MessageType::FrameUpdate };
+    uint32_t tileCount { 0 };
+    uint64_t frame { 0 };
+    int64_t paintStartTime { 0 };
+    int64_t sendTime { 0 };
+};
+
+struct Quit {
+    MessageType type { MessageType::Quit };
+};
+
+// One end of a SOCK_SEQPACKET socket pair: message boundaries are preserved,
+// so every send() is matched by exactly one receive().
+class Channel {
+public:
+    explicit Channel(int fd);
+    ~Channel();
+
+    static std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>> createPair();
+
+    static constexpr uint32_t maxFDsPerMessage = DMABuffer::maxBufferPlanes;
+    static constexpr uint32_t maxMessageSize = 64 * 1024;
+
+    int fd() const { return m_fd; }
+
+    // The FDs are duplicated by the kernel, the caller keeps ownership of its FDs.
+    bool send(const void* header, size_t headerSize, const void* payload = nullptr, size_t payloadSize = 0, const int* fds = nullptr, uint32_t fdCount = 0);
+
+    // Returns the size of the received message, 0 if the peer closed the socket, -1 on error.
+    // The received FDs are owned by the caller.
+    ssize_t receive(void* buffer, size_t bufferSize, int* fds = nullptr, uint32_t* fdCount = nullptr);
+
+private:
+    int m_fd { -1 };
+};
+
+}
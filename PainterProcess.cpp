@@ -0,0 +1,171 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "PainterProcess.h"
+
+#include "Application.h"
+#include "BandwidthCounters.h"
+#include "ContentSource.h"
+#include "DRM.h"
+#include "EGL.h"
+#include "GBM.h"
+#include "IPC.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "ProgramCache.h"
+#include "TileRenderer.h"
+#include "Utilities.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+PainterProcess::PainterProcess(std::unique_ptr<IPC::Channel>&& channel)
+    : m_channel(std::move(channel))
+{
+}
+
+PainterProcess::~PainterProcess()
+{
+    m_tileRenderer.reset();
+    m_egl.reset();
+    m_gbm.reset();
+    m_drm.reset();
+}
+
+std::unique_ptr<PainterProcess> PainterProcess::create(std::unique_ptr<IPC::Channel>&& channel)
+{
+    auto painterProcess = std::make_unique<PainterProcess>(std::move(channel));
+    if (!painterProcess->initialize())
+        return nullptr;
+    return painterProcess;
+}
+
+bool PainterProcess::initialize()
+{
+    auto& args = Application::commandLineArguments();
+
+    // The compositor process handles SIGINT and asks the painter to quit.
+    signal(SIGINT, SIG_IGN);
+
+    m_drm = DRM::createForNode(args.drmNodeGPU);
+    if (!m_drm) {
+        Logger::error("Failed to initialize DRM (painter)\n");
+        return false;
+    }
+
+    m_gbm = GBM::create(m_drm->fd());
+    if (!m_gbm) {
+        Logger::error("Failed to initialize GBM (painter)\n");
+        return false;
+    }
+
+    m_egl = EGL::create(*m_gbm);
+    if (!m_egl) {
+        Logger::error("Failed to initialize EGL (painter)\n");
+        return false;
+    }
+
+    m_tileRenderer = TileRenderer::create(args.tileCount, args.tileWidth, args.tileHeight, m_egl.get());
+    if (!m_tileRenderer) {
+        Logger::error("Failed to initialize tile rendering (painter)\n");
+        return false;
+    }
+
+    m_tileRenderer->allocateDMABufTiles(*m_drm, *m_gbm);
+    m_egl->programCache().report();
+
+    // Counts the painting of this process only, the compositor process has its own counters.
+    PerfCounters::initialize();
+    BandwidthCounters::initialize();
+    if (!ContentSource::initialize())
+        return false;
+    return m_tileRenderer->exportTiles(*m_channel);
+}
+
+bool PainterProcess::paintFrame(uint64_t frame)
+{
+    auto& args = Application::commandLineArguments();
+
+    IPC::FrameUpdate update;
+    update.frame = frame;
+    update.paintStartTime = getCurrentTimeInNanoSeconds();
+
+    {
+        PerfCounterScope scope(PerfCounters::Scope::RenderTiles);
+        auto* contentSource = ContentSource::singleton();
+        if (contentSource && !args.noAnimate)
+            contentSource->advance();
+        m_tileRenderer->updateTiles();
+    }
+
+    // GL uploads and rendering are asynchronous, hand a fence to the compositor process. The CPU
+    // update methods bracket their writes with DMA_BUF_IOCTL_SYNC and need none.
+    int fenceFD = -1;
+    if (isGLTileUpdateMethod(args.tileUpdateMethod)) {
+        if (m_egl->supportsExplicitSync())
+            fenceFD = m_egl->createFenceFD();
+        else
+            glFinish();
+    }
+
+    auto& damage = m_tileRenderer->damage();
+    update.tileCount = damage.size();
+    update.sendTime = getCurrentTimeInNanoSeconds();
+
+    bool result = m_channel->send(&update, sizeof(update), damage.data(), damage.size() * sizeof(TileDamage), &fenceFD, fenceFD >= 0 ? 1 : 0);
+    if (fenceFD >= 0)
+        close(fenceFD);
+
+    return result;
+}
+
+int PainterProcess::run()
+{
+    Logger::info("Painter process %d: waiting for frame requests...\n", getpid());
+
+    uint64_t frames = 0;
+    while (true) {
+        // Every message starts with its type, IPC::Quit is the shortest one.
+        IPC::FrameRequest request;
+        auto size = m_channel->receive(&request, sizeof(request));
+        if (size <= 0 || request.type == IPC::MessageType::Quit)
+            break;
+
+        if (request.type != IPC::MessageType::FrameRequest || size != sizeof(request)) {
+            Logger::error("Unexpected message from the compositor process.\n");
+            return -1;
+        }
+
+        if (!paintFrame(request.frame))
+            return -1;
+        ++frames;
+    }
+
+    if (PerfCounters::singleton() || BandwidthCounters::singleton())
+        Logger::info("Painter process %d:\n", getpid());
+    if (auto* counters = PerfCounters::singleton())
+        counters->report(frames);
+    if (auto* counters = BandwidthCounters::singleton())
+        counters->report(frames);
+    if (auto* contentSource = ContentSource::singleton())
+        contentSource->report();
+
+    Logger::info("Painter process %d: exiting.\n", getpid());
+    return 0;
+}
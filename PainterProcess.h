@@ -0,0 +1,53 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <memory>
+
+class DRM;
+class EGL;
+class GBM;
+class TileRenderer;
+
+namespace IPC {
+class Channel;
+}
+
+// The painter side of --multi-process mode (WebProcess): owns the tiles, paints them
+// on request of the compositor process and reports the damaged areas.
+class PainterProcess {
+public:
+    explicit PainterProcess(std::unique_ptr<IPC::Channel>&&);
+    ~PainterProcess();
+
+    static std::unique_ptr<PainterProcess> create(std::unique_ptr<IPC::Channel>&&);
+
+    int run();
+
+private:
+    bool initialize();
+    bool paintFrame(uint64_t frame);
+
+    std::unique_ptr<IPC::Channel> m_channel;
+    std::unique_ptr<DRM> m_drm;
+    std::unique_ptr<GBM> m_gbm;
+    std::unique_ptr<EGL> m_egl;
+    std::unique_ptr<TileRenderer> m_tileRenderer;
+};
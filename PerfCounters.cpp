@@ -0,0 +1,219 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "PerfCounters.h"
+
+#include "Application.h"
+#include "Logger.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+PerfCounters* PerfCounters::s_perfCounters = nullptr;
+
+struct CounterDescription {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+static constexpr std::array<CounterDescription, PerfCounters::counterCount> counterDescriptions = { {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "LLC-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+} };
+
+static constexpr std::array<const char*, PerfCounters::scopeCount> scopeNames = {
+    "render tiles",
+    "content generation",
+    "content conversion",
+    "store kernel (tiled)",
+    "store kernel (linear)",
+    "composition kernel",
+};
+
+static int perfEventOpen(uint32_t type, uint64_t config, bool excludeKernel, int groupFD)
+{
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = groupFD == -1; // the group leader enables the whole group
+    attributes.exclude_kernel = excludeKernel;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Counts the calling thread on any CPU.
+    return syscall(SYS_perf_event_open, &attributes, 0, -1, groupFD, PERF_FLAG_FD_CLOEXEC);
+}
+
+PerfCounters::PerfCounters()
+{
+    m_fds.fill(-1);
+    m_groupIndex.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+    // Close the group leader last.
+    for (auto fd : m_fds) {
+        if (fd >= 0 && fd != m_groupFD)
+            close(fd);
+    }
+
+    if (m_groupFD >= 0)
+        close(m_groupFD);
+}
+
+void PerfCounters::initialize()
+{
+    auto& args = Application::commandLineArguments();
+    if (!args.perfCounters)
+        return;
+
+    assert(!s_perfCounters);
+    static std::unique_ptr<PerfCounters> s_owner = std::make_unique<PerfCounters>();
+    if (!s_owner->open()) {
+        Logger::error("Failed to open any performance counter (perf_event_open: %s), check /proc/sys/kernel/perf_event_paranoid\n", strerror(errno));
+        return;
+    }
+
+    s_perfCounters = s_owner.get();
+}
+
+bool PerfCounters::open()
+{
+    // Unprivileged processes may only count user space (perf_event_paranoid >= 2).
+    int probeFD = perfEventOpen(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, false, -1);
+    if (probeFD == -1 && errno == EACCES) {
+        m_excludeKernel = true;
+        probeFD = perfEventOpen(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, true, -1);
+    }
+
+    if (probeFD == -1)
+        return false;
+    close(probeFD);
+
+    for (uint32_t counter = 0; counter < counterCount; ++counter) {
+        auto& description = counterDescriptions[counter];
+        int fd = perfEventOpen(description.type, description.config, m_excludeKernel, m_groupFD);
+        if (fd == -1 && counter == Cycles) {
+            fd = perfEventOpen(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, m_excludeKernel, m_groupFD);
+            m_cyclesAreTaskClock = fd != -1;
+        }
+
+        if (fd == -1) {
+            Logger::info("Performance counter '%s' is unavailable: %s\n", description.name, strerror(errno));
+            continue;
+        }
+
+        if (m_groupFD == -1)
+            m_groupFD = fd;
+        m_fds[counter] = fd;
+        m_groupIndex[counter] = m_groupSize++;
+    }
+
+    if (m_groupFD == -1)
+        return false;
+
+    ioctl(m_groupFD, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_groupFD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::read(Snapshot& snapshot) const
+{
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr].
+    uint64_t buffer[3 + counterCount];
+    if (::read(m_groupFD, buffer, sizeof(buffer)) < ssize_t((3 + m_groupSize) * sizeof(uint64_t)))
+        return;
+
+    snapshot.timeEnabled = buffer[1];
+    snapshot.timeRunning = buffer[2];
+    for (uint32_t counter = 0; counter < counterCount; ++counter) {
+        if (m_groupIndex[counter] >= 0)
+            snapshot.values[counter] = buffer[3 + m_groupIndex[counter]];
+    }
+}
+
+void PerfCounters::accumulate(Scope scope, const Snapshot& start)
+{
+    Snapshot end;
+    read(end);
+
+    auto& counts = m_scopes[static_cast<uint32_t>(scope)];
+    for (uint32_t counter = 0; counter < counterCount; ++counter)
+        counts.total.values[counter] += end.values[counter] - start.values[counter];
+    counts.total.timeEnabled += end.timeEnabled - start.timeEnabled;
+    counts.total.timeRunning += end.timeRunning - start.timeRunning;
+    ++counts.calls;
+}
+
+void PerfCounters::reset()
+{
+    m_scopes = { };
+    m_uploadedBytes = 0;
+}
+
+void PerfCounters::report(uint64_t frames) const
+{
+    if (!frames)
+        return;
+
+    const double uploadedMegaBytes = double(m_uploadedBytes) / (1024.0 * 1024.0);
+    Logger::info("Performance counters (%s%s), %.1f MB uploaded, per frame / per uploaded MB:\n",
+                 m_excludeKernel ? "user space only" : "user + kernel space",
+                 m_cyclesAreTaskClock ? ", no hardware PMU: 'cycles' is task-clock in ns" : "", uploadedMegaBytes);
+
+    for (uint32_t scope = 0; scope < scopeCount; ++scope) {
+        auto& counts = m_scopes[scope];
+        if (!counts.calls)
+            continue;
+
+        // The group is scaled as a whole, if the PMU had to multiplex it with other events.
+        double scale = 1.0;
+        if (counts.total.timeRunning && counts.total.timeRunning < counts.total.timeEnabled)
+            scale = double(counts.total.timeEnabled) / double(counts.total.timeRunning);
+
+        Logger::info("  %s (%llu calls%s):\n", scopeNames[scope], static_cast<unsigned long long>(counts.calls), scale > 1.0 ? ", scaled" : "");
+        for (uint32_t counter = 0; counter < counterCount; ++counter) {
+            if (m_groupIndex[counter] < 0)
+                continue;
+
+            const double value = double(counts.total.values[counter]) * scale;
+            Logger::info("    %-18s %14.0f / frame", counterDescriptions[counter].name, value / double(frames));
+            if (uploadedMegaBytes > 0)
+                Logger::info("  %14.0f / MB", value / uploadedMegaBytes);
+            Logger::info("\n");
+        }
+
+        if (!m_cyclesAreTaskClock && m_groupIndex[Cycles] >= 0 && m_groupIndex[Instructions] >= 0 && counts.total.values[Cycles])
+            Logger::info("    %-18s %14.2f\n", "IPC", double(counts.total.values[Instructions]) / double(counts.total.values[Cycles]));
+    }
+}
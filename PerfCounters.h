@@ -0,0 +1,113 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// Per-thread performance counters (perf_event_open) for --perf-counters. Hardware events that cannot be
+// opened (no PMU, virtualized, restricted by perf_event_paranoid) are skipped, cycles fall back to the
+// task-clock software event. The counts are accumulated per scope, see PerfCounterScope.
+class PerfCounters {
+public:
+    enum class Scope : uint8_t {
+        RenderTiles, // tile update + composition of a frame
+        ContentGeneration, // Tile::createRandomContent()
+        ContentConversion, // --content-conversion separate: BGRA to RGBA pass
+        StoreTiled, // store kernel into the --tile-buffer-modifier layout (mmap)
+        StoreLinear, // linear store kernel (gbm, pbo, software)
+        Composition // software composition kernel
+    };
+    static constexpr uint32_t scopeCount = 6;
+
+    enum Counter : uint8_t {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        LLCMisses,
+        PageFaults,
+        ContextSwitches
+    };
+    static constexpr uint32_t counterCount = 6;
+
+    struct Snapshot {
+        std::array<uint64_t, counterCount> values { };
+        uint64_t timeEnabled { 0 };
+        uint64_t timeRunning { 0 };
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    // Creates the collector for the calling thread if --perf-counters is passed.
+    static void initialize();
+    static PerfCounters* singleton() { return s_perfCounters; }
+
+    void read(Snapshot&) const;
+    void accumulate(Scope, const Snapshot& start);
+    void addUploadedBytes(uint64_t bytes) { m_uploadedBytes += bytes; }
+
+    void reset();
+    void report(uint64_t frames) const;
+
+private:
+    bool open();
+
+    static PerfCounters* s_perfCounters;
+
+    int m_groupFD { -1 };
+    std::array<int, counterCount> m_fds;
+    std::array<int32_t, counterCount> m_groupIndex; // position in the group read, -1 if unavailable
+    uint32_t m_groupSize { 0 };
+    bool m_cyclesAreTaskClock { false };
+    bool m_excludeKernel { false };
+
+    struct ScopeCounts {
+        Snapshot total;
+        uint64_t calls { 0 };
+    };
+
+    std::array<ScopeCounts, scopeCount> m_scopes;
+    uint64_t m_uploadedBytes { 0 };
+};
+
+// Accumulates the counter deltas of its lifetime into a scope, no-op without --perf-counters.
+class PerfCounterScope {
+public:
+    explicit PerfCounterScope(PerfCounters::Scope scope)
+        : m_counters(PerfCounters::singleton())
+        , m_scope(scope)
+    {
+        if (m_counters)
+            m_counters->read(m_start);
+    }
+
+    ~PerfCounterScope()
+    {
+        if (m_counters)
+            m_counters->accumulate(m_scope, m_start);
+    }
+
+private:
+    PerfCounters* m_counters { nullptr };
+    PerfCounters::Scope m_scope;
+    PerfCounters::Snapshot m_start;
+};
@@ -0,0 +1,145 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "PixelUnpackBufferRing.h"
+
+#include "EGL.h"
+#include "Logger.h"
+
+#include <cassert>
+
+#include <GLES3/gl3.h>
+
+PixelUnpackBufferRing::PixelUnpackBufferRing(const EGL& egl, uint32_t slotCount, uint32_t slotSize)
+    : m_egl(egl)
+    , m_slotSize(slotSize)
+    , m_slots(slotCount)
+{
+}
+
+PixelUnpackBufferRing::~PixelUnpackBufferRing()
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence)
+            m_egl.destroyFence(slot.fence);
+
+        if (slot.persistentMapping) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        if (slot.buffer)
+            glDeleteBuffers(1, &slot.buffer);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (m_uploadCount) {
+        Logger::info("Pixel unpack buffer ring (%zu slots, %s): %llu uploads, waited for a slot fence %llu times\n", m_slots.size(),
+                     m_persistent ? "persistently mapped" : "mapped per upload",
+                     static_cast<unsigned long long>(m_uploadCount), static_cast<unsigned long long>(m_fenceWaitCount));
+    }
+}
+
+std::unique_ptr<PixelUnpackBufferRing> PixelUnpackBufferRing::create(const EGL& egl, uint32_t slotCount, uint32_t slotSize)
+{
+    auto ring = std::make_unique<PixelUnpackBufferRing>(egl, slotCount, slotSize);
+    if (!ring->allocate())
+        return nullptr;
+    return ring;
+}
+
+bool PixelUnpackBufferRing::allocate()
+{
+    if (!m_egl.isGLES3()) {
+        Logger::error("Pixel unpack buffers require an OpenGL ES 3 context (--gles3)\n");
+        return false;
+    }
+
+    m_persistent = !!m_egl.glBufferStorageEXT;
+
+    for (auto& slot : m_slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+
+        if (!m_persistent) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_slotSize, nullptr, GL_STREAM_DRAW);
+            continue;
+        }
+
+        // Coherent: no explicit flush needed, the slot fences order the CPU writes against the GPU reads.
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+        m_egl.glBufferStorageEXT(GL_PIXEL_UNPACK_BUFFER, m_slotSize, nullptr, flags);
+        slot.persistentMapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_slotSize, flags);
+        if (!slot.persistentMapping) {
+            Logger::error("Failed to map pixel unpack buffer persistently\n");
+            return false;
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+}
+
+void* PixelUnpackBufferRing::begin(uint32_t size)
+{
+    assert(size <= m_slotSize);
+    auto& slot = m_slots[m_currentSlot];
+
+    // The GPU may still read the previous upload from this slot.
+    if (slot.fence) {
+        if (m_egl.eglClientWaitSyncKHR(m_egl.display(), slot.fence, 0, 0) != EGL_CONDITION_SATISFIED_KHR) {
+            ++m_fenceWaitCount;
+            m_egl.clientWaitFence(slot.fence);
+        }
+
+        m_egl.destroyFence(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    if (slot.persistentMapping)
+        return slot.persistentMapping;
+
+    // Synchronization is handled by the slot fence, the driver must neither wait nor copy.
+    auto* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data) {
+        Logger::error("Failed to map pixel unpack buffer\n");
+        abort();
+    }
+
+    return data;
+}
+
+void PixelUnpackBufferRing::end(GLuint texture, uint32_t x, uint32_t y, uint32_t width, uint32_t height, GLenum format, GLenum type)
+{
+    auto& slot = m_slots[m_currentSlot];
+    if (!slot.persistentMapping)
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With a bound pixel unpack buffer, the data pointer is an offset into the buffer.
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, nullptr);
+
+    slot.fence = m_egl.createFence();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    ++m_uploadCount;
+    m_currentSlot = (m_currentSlot + 1) % m_slots.size();
+}
@@ -0,0 +1,64 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+class EGL;
+
+// Ring of pixel unpack buffers to stream texture uploads (--tile-update-method pbo, requires --gles3).
+// The slots are persistently mapped with GL_EXT_buffer_storage, otherwise they are mapped unsynchronized
+// for every upload. Either way, a slot is only rewritten after the fence of its previous upload signaled.
+class PixelUnpackBufferRing {
+public:
+    PixelUnpackBufferRing(const EGL&, uint32_t slotCount, uint32_t slotSize);
+    ~PixelUnpackBufferRing();
+
+    static std::unique_ptr<PixelUnpackBufferRing> create(const EGL&, uint32_t slotCount, uint32_t slotSize);
+
+    // Returns the CPU mapping of the next slot, to write the pixels of the upload to.
+    void* begin(uint32_t size);
+    // Uploads the slot contents (tightly packed pixels of the given format / type) into the texture and fences the slot.
+    void end(GLuint texture, uint32_t x, uint32_t y, uint32_t width, uint32_t height, GLenum format, GLenum type);
+
+private:
+    bool allocate();
+
+    struct Slot {
+        GLuint buffer { 0 };
+        void* persistentMapping { nullptr };
+        EGLSyncKHR fence { nullptr };
+    };
+
+    const EGL& m_egl;
+    uint32_t m_slotSize { 0 };
+    uint32_t m_currentSlot { 0 };
+    bool m_persistent { false };
+    std::vector<Slot> m_slots;
+
+    uint64_t m_uploadCount { 0 };
+    uint64_t m_fenceWaitCount { 0 };
+};
@@ -0,0 +1,268 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ProgramCache.h"
+
+#include "Application.h"
+#include "EGL.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct ProgramBinaryHeader {
+    static constexpr uint32_t magicValue = 0x57504250; // 'WPBP'
+
+    uint32_t magic { magicValue };
+    uint32_t format { 0 };
+    uint32_t length { 0 };
+    uint32_t reserved { 0 };
+    uint64_t key { 0 };
+};
+
+static GLuint loadShader(GLenum type, const char* shaderSource)
+{
+    GLuint shader = glCreateShader(type);
+    assert(shader);
+
+    glShaderSource(shader, 1, &shaderSource, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    assert(compiled);
+
+    return shader;
+}
+
+static bool createDirectories(const std::string& path)
+{
+    for (size_t position = 1; position <= path.size(); ++position) {
+        if (position != path.size() && path[position] != '/')
+            continue;
+
+        auto directory = path.substr(0, position);
+        if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST)
+            return false;
+    }
+
+    return true;
+}
+
+static std::string defaultDirectory()
+{
+    if (const char* cacheHome = getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+        return std::string(cacheHome) + "/wpe-testbed";
+    if (const char* home = getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/wpe-testbed";
+    return { };
+}
+
+ProgramCache::ProgramCache(const EGL& egl, std::string&& directory)
+    : m_egl(egl)
+    , m_directory(std::move(directory))
+{
+}
+
+std::unique_ptr<ProgramCache> ProgramCache::create(const EGL& egl)
+{
+    auto& args = Application::commandLineArguments();
+
+    std::string directory;
+    if (!args.noProgramCache && egl.glGetProgramBinaryOES) {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatCount);
+        if (formatCount > 0) {
+            directory = args.programCacheDirectory.empty() ? defaultDirectory() : args.programCacheDirectory;
+            if (!directory.empty() && !createDirectories(directory)) {
+                Logger::error("Failed to create the program cache directory '%s': %s\n", directory.c_str(), strerror(errno));
+                directory.clear();
+            }
+        } else
+            Logger::info("Program cache: GL_OES_get_program_binary supports no binary formats, compiling from source\n");
+    }
+
+    return std::make_unique<ProgramCache>(egl, std::move(directory));
+}
+
+uint64_t ProgramCache::programKey(const char* vertexShaderSource, const char* fragmentShaderSource) const
+{
+    // 64-bit FNV-1a over the driver identification and both shader sources, NUL-separated.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto append = [&](const char* string) {
+        for (auto* ptr = string ? string : ""; ; ++ptr) {
+            hash ^= static_cast<uint8_t>(*ptr);
+            hash *= 0x100000001b3ull;
+            if (!*ptr)
+                break;
+        }
+    };
+
+    append(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    append(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    append(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    append(vertexShaderSource);
+    append(fragmentShaderSource);
+    return hash;
+}
+
+std::string ProgramCache::programPath(uint64_t key) const
+{
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "/%016llx.bin", static_cast<unsigned long long>(key));
+    return m_directory + fileName;
+}
+
+GLuint ProgramCache::loadProgram(const std::string& path, uint64_t key)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    ProgramBinaryHeader header;
+    std::vector<uint8_t> binary;
+    bool valid = read(fd, &header, sizeof(header)) == sizeof(header) && header.magic == ProgramBinaryHeader::magicValue && header.key == key && header.length;
+    if (valid) {
+        binary.resize(header.length);
+        valid = read(fd, binary.data(), binary.size()) == ssize_t(binary.size());
+    }
+    close(fd);
+
+    if (valid) {
+        GLuint program = glCreateProgram();
+        assert(program);
+
+        m_egl.glProgramBinaryOES(program, header.format, binary.data(), header.length);
+
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked)
+            return program;
+
+        glDeleteProgram(program);
+    }
+
+    // Truncated, stale or rejected by the driver (e.g. after a driver update that kept the version string).
+    ++m_rejectedPrograms;
+    unlink(path.c_str());
+    return 0;
+}
+
+void ProgramCache::storeProgram(const std::string& path, uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    header.key = key;
+
+    std::vector<uint8_t> binary(length);
+    GLsizei writtenLength = 0;
+    m_egl.glGetProgramBinaryOES(program, length, &writtenLength, &header.format, binary.data());
+    if (writtenLength <= 0)
+        return;
+    header.length = writtenLength;
+
+    // Write to a temporary file and rename it, so that a concurrent reader (the painter process) never
+    // sees a partially written binary.
+    auto temporaryPath = path + "." + std::to_string(getpid());
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return;
+
+    bool written = write(fd, &header, sizeof(header)) == sizeof(header) && write(fd, binary.data(), header.length) == ssize_t(header.length);
+    close(fd);
+
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        Logger::error("Failed to store the program binary '%s'\n", path.c_str());
+        unlink(temporaryPath.c_str());
+    }
+}
+
+GLuint ProgramCache::createProgram(const char* name, const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+    auto startTime = getCurrentTimeInNanoSeconds();
+
+    uint64_t key = 0;
+    std::string path;
+    if (!m_directory.empty()) {
+        key = programKey(vertexShaderSource, fragmentShaderSource);
+        path = programPath(key);
+
+        if (auto program = loadProgram(path, key)) {
+            auto time = getCurrentTimeInNanoSeconds() - startTime;
+            m_totalTimeInNanoSeconds += time;
+            ++m_loadedPrograms;
+            Logger::info("Program cache: loaded '%s' in %.3f ms\n", name, double(time) / double(nsPerSecond / msPerSecond));
+            return program;
+        }
+    }
+
+    auto vertexShader = loadShader(GL_VERTEX_SHADER, vertexShaderSource);
+    auto fragmentShader = loadShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+
+    GLuint program = glCreateProgram();
+    assert(program);
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+
+    glLinkProgram(program);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    if (!path.empty())
+        storeProgram(path, key, program);
+
+    auto time = getCurrentTimeInNanoSeconds() - startTime;
+    m_totalTimeInNanoSeconds += time;
+    ++m_compiledPrograms;
+    Logger::info("Program cache: compiled '%s' in %.3f ms\n", name, double(time) / double(nsPerSecond / msPerSecond));
+    return program;
+}
+
+void ProgramCache::report() const
+{
+    if (m_directory.empty()) {
+        Logger::info("Program cache: disabled, %u programs compiled in %.3f ms\n", m_compiledPrograms, double(m_totalTimeInNanoSeconds) / double(nsPerSecond / msPerSecond));
+        return;
+    }
+
+    Logger::info("Program cache (%s, %s): %u programs loaded, %u compiled, %u rejected binaries, %.3f ms\n", m_directory.c_str(),
+                 m_compiledPrograms ? "cold" : "warm", m_loadedPrograms, m_compiledPrograms, m_rejectedPrograms,
+                 double(m_totalTimeInNanoSeconds) / double(nsPerSecond / msPerSecond));
+}
@@ -0,0 +1,57 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <GLES2/gl2.h>
+
+class EGL;
+
+// Caches linked programs on disk through GL_OES_get_program_binary, keyed by the GL vendor / renderer /
+// version strings and the shader sources. A binary the driver rejects is removed and the program is
+// rebuilt from source. Without the extension, or with --no-program-cache, programs are always compiled.
+class ProgramCache {
+public:
+    ProgramCache(const EGL&, std::string&& directory);
+
+    static std::unique_ptr<ProgramCache> create(const EGL&);
+
+    // Returns 0 if the program fails to link.
+    GLuint createProgram(const char* name, const char* vertexShaderSource, const char* fragmentShaderSource);
+
+    void report() const;
+
+private:
+    uint64_t programKey(const char* vertexShaderSource, const char* fragmentShaderSource) const;
+    std::string programPath(uint64_t key) const;
+    GLuint loadProgram(const std::string& path, uint64_t key);
+    void storeProgram(const std::string& path, uint64_t key, GLuint program);
+
+    const EGL& m_egl;
+    std::string m_directory; // empty: disabled
+
+    uint32_t m_loadedPrograms { 0 };
+    uint32_t m_compiledPrograms { 0 };
+    uint32_t m_rejectedPrograms { 0 };
+    int64_t m_totalTimeInNanoSeconds { 0 };
+};
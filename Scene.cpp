@@ -0,0 +1,505 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "Scene.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct JSONValue {
+    enum class Type { Null, Boolean, Number, String, Array, Object };
+
+    Type type { Type::Null };
+    bool boolean { false };
+    double number { 0.0 };
+    std::string string;
+    std::vector<JSONValue> elements;
+    std::vector<std::pair<std::string, JSONValue>> members;
+
+    const JSONValue* member(const char* name) const
+    {
+        for (auto& [key, value] : members) {
+            if (key == name)
+                return &value;
+        }
+        return nullptr;
+    }
+};
+
+// Just enough JSON for the scene files: \u escapes outside of ASCII are replaced by '?'.
+class JSONParser {
+public:
+    explicit JSONParser(const std::string& text)
+        : m_begin(text.c_str())
+        , m_position(m_begin)
+        , m_end(m_begin + text.size())
+    {
+    }
+
+    bool parse(JSONValue& value)
+    {
+        if (!parseValue(value, 0))
+            return false;
+
+        skipWhitespace();
+        return m_position == m_end || fail("unexpected trailing characters");
+    }
+
+    const char* error() const { return m_error; }
+    uint32_t line() const { return 1 + std::count(m_begin, m_position, '\n'); }
+
+private:
+    static constexpr uint32_t maxDepth = 64;
+
+    bool fail(const char* error)
+    {
+        m_error = error;
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (m_position != m_end && (*m_position == ' ' || *m_position == '\t' || *m_position == '\n' || *m_position == '\r'))
+            ++m_position;
+    }
+
+    bool consume(char character)
+    {
+        if (m_position == m_end || *m_position != character)
+            return false;
+
+        ++m_position;
+        return true;
+    }
+
+    bool consumeLiteral(const char* literal)
+    {
+        size_t length = strlen(literal);
+        if (size_t(m_end - m_position) < length || strncmp(m_position, literal, length))
+            return fail("invalid literal");
+
+        m_position += length;
+        return true;
+    }
+
+    bool parseString(std::string& string)
+    {
+        if (!consume('"'))
+            return fail("expected a string");
+
+        while (m_position != m_end && *m_position != '"') {
+            char character = *m_position++;
+            if (character != '\\') {
+                string.push_back(character);
+                continue;
+            }
+
+            if (m_position == m_end)
+                break;
+
+            switch (character = *m_position++) {
+            case 'b': string.push_back('\b'); break;
+            case 'f': string.push_back('\f'); break;
+            case 'n': string.push_back('\n'); break;
+            case 'r': string.push_back('\r'); break;
+            case 't': string.push_back('\t'); break;
+            case 'u': {
+                if (m_end - m_position < 4)
+                    return fail("invalid \\u escape");
+
+                char digits[5] = { m_position[0], m_position[1], m_position[2], m_position[3], '\0' };
+                char* digitsEnd = nullptr;
+                long codePoint = strtol(digits, &digitsEnd, 16);
+                if (digitsEnd != digits + 4)
+                    return fail("invalid \\u escape");
+
+                string.push_back(codePoint < 0x80 ? char(codePoint) : '?');
+                m_position += 4;
+                break;
+            }
+            default:
+                string.push_back(character); // '"', '\\' and '/'
+                break;
+            }
+        }
+
+        return consume('"') || fail("unterminated string");
+    }
+
+    bool parseNumber(double& number)
+    {
+        if (m_position == m_end || (*m_position != '-' && (*m_position < '0' || *m_position > '9')))
+            return fail("unexpected character");
+
+        // The text is null-terminated, strtod() cannot read past it.
+        char* numberEnd = nullptr;
+        number = strtod(m_position, &numberEnd);
+        if (numberEnd == m_position || !std::isfinite(number))
+            return fail("invalid number");
+
+        m_position = numberEnd;
+        return true;
+    }
+
+    bool parseValue(JSONValue& value, uint32_t depth)
+    {
+        skipWhitespace();
+        if (depth > maxDepth)
+            return fail("nested too deeply");
+        if (m_position == m_end)
+            return fail("unexpected end of file");
+
+        switch (*m_position) {
+        case '{':
+            ++m_position;
+            value.type = JSONValue::Type::Object;
+            skipWhitespace();
+            if (consume('}'))
+                return true;
+
+            do {
+                skipWhitespace();
+                std::string key;
+                if (!parseString(key))
+                    return false;
+
+                skipWhitespace();
+                if (!consume(':'))
+                    return fail("expected ':'");
+
+                JSONValue member;
+                if (!parseValue(member, depth + 1))
+                    return false;
+
+                value.members.emplace_back(std::move(key), std::move(member));
+                skipWhitespace();
+            } while (consume(','));
+            return consume('}') || fail("expected ',' or '}'");
+        case '[':
+            ++m_position;
+            value.type = JSONValue::Type::Array;
+            skipWhitespace();
+            if (consume(']'))
+                return true;
+
+            do {
+                value.elements.emplace_back();
+                if (!parseValue(value.elements.back(), depth + 1))
+                    return false;
+
+                skipWhitespace();
+            } while (consume(','));
+            return consume(']') || fail("expected ',' or ']'");
+        case '"':
+            value.type = JSONValue::Type::String;
+            return parseString(value.string);
+        case 't':
+            value.type = JSONValue::Type::Boolean;
+            value.boolean = true;
+            return consumeLiteral("true");
+        case 'f':
+            value.type = JSONValue::Type::Boolean;
+            return consumeLiteral("false");
+        case 'n':
+            return consumeLiteral("null");
+        default:
+            value.type = JSONValue::Type::Number;
+            return parseNumber(value.number);
+        }
+    }
+
+    const char* m_begin { nullptr };
+    const char* m_position { nullptr };
+    const char* m_end { nullptr };
+    const char* m_error { nullptr };
+};
+
+struct LayerContext {
+    const char* path { nullptr };
+    uint32_t defaultTileWidth { 0 };
+    uint32_t defaultTileHeight { 0 };
+
+    // Inherited from the ancestors.
+    TransformationMatrix transform;
+    float opacity { 1.0f };
+    SceneRect clip { -1e9f, -1e9f, 2e9f, 2e9f };
+};
+
+}
+
+SceneRect SceneRect::intersection(const SceneRect& other) const
+{
+    float left = std::max(x, other.x);
+    float top = std::max(y, other.y);
+    float right = std::min(x + width, other.x + other.width);
+    float bottom = std::min(y + height, other.y + other.height);
+    return { left, top, std::max(right - left, 0.0f), std::max(bottom - top, 0.0f) };
+}
+
+// Reads an optional array of numbers. Returns false if present with any other length than the given ones.
+static bool readNumbers(const JSONValue& object, const char* key, std::vector<float>& numbers, size_t length, size_t alternativeLength = 0)
+{
+    auto* value = object.member(key);
+    if (!value)
+        return true;
+
+    if (value->type != JSONValue::Type::Array || (value->elements.size() != length && value->elements.size() != alternativeLength))
+        return false;
+
+    numbers.clear();
+    for (auto& element : value->elements) {
+        if (element.type != JSONValue::Type::Number)
+            return false;
+        numbers.push_back(float(element.number));
+    }
+
+    return true;
+}
+
+static bool parseUpdatePattern(const std::string& name, SceneUpdatePattern& pattern)
+{
+    static const std::pair<const char*, SceneUpdatePattern> patterns[] = {
+        { "static", SceneUpdatePattern::Static },
+        { "full", SceneUpdatePattern::Full },
+        { "partial", SceneUpdatePattern::Partial },
+        { "scroll", SceneUpdatePattern::Scroll },
+    };
+
+    for (auto& [patternName, value] : patterns) {
+        if (name == patternName) {
+            pattern = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool loadUpdate(const JSONValue& object, SceneLayer& layer)
+{
+    auto* update = object.member("update");
+    if (!update)
+        return true;
+    if (update->type != JSONValue::Type::Object)
+        return false;
+
+    if (auto* pattern = update->member("pattern")) {
+        if (pattern->type != JSONValue::Type::String || !parseUpdatePattern(pattern->string, layer.updatePattern))
+            return false;
+    }
+
+    if (auto* interval = update->member("interval")) {
+        if (interval->type != JSONValue::Type::Number || interval->number < 1)
+            return false;
+        layer.updateInterval = uint32_t(interval->number);
+    }
+
+    if (auto* tiles = update->member("tiles")) {
+        if (tiles->type != JSONValue::Type::Number || tiles->number < 1)
+            return false;
+        layer.updateTileCount = uint32_t(tiles->number);
+    }
+
+    std::vector<float> scroll { 0.0f, 0.0f };
+    if (!readNumbers(*update, "scroll", scroll, 2))
+        return false;
+
+    layer.scrollX = scroll[0];
+    layer.scrollY = scroll[1];
+    return layer.updatePattern != SceneUpdatePattern::Scroll || layer.scrollX || layer.scrollY;
+}
+
+static bool loadLayer(const JSONValue& object, const LayerContext& parent, std::vector<SceneLayer>& layers)
+{
+    if (object.type != JSONValue::Type::Object) {
+        Logger::error("Scene '%s': layers must be objects\n", parent.path);
+        return false;
+    }
+
+    SceneLayer layer;
+    if (auto* name = object.member("name"); name && name->type == JSONValue::Type::String)
+        layer.name = name->string;
+    else
+        layer.name = "layer " + std::to_string(layers.size());
+
+    auto invalid = [&](const char* key) {
+        Logger::error("Scene '%s': invalid '%s' in layer '%s'\n", parent.path, key, layer.name.c_str());
+        return false;
+    };
+
+    std::vector<float> position { 0.0f, 0.0f };
+    if (!readNumbers(object, "position", position, 2))
+        return invalid("position");
+
+    std::vector<float> size { 0.0f, 0.0f };
+    if (!readNumbers(object, "size", size, 2) || size[0] < 0 || size[1] < 0)
+        return invalid("size");
+    layer.width = uint32_t(ceilf(size[0]));
+    layer.height = uint32_t(ceilf(size[1]));
+
+    // Transform origin, as a fraction of the size.
+    std::vector<float> anchor { 0.5f, 0.5f };
+    if (!readNumbers(object, "anchor", anchor, 2))
+        return invalid("anchor");
+
+    std::vector<float> transform;
+    if (!readNumbers(object, "transform", transform, 6, 16))
+        return invalid("transform");
+
+    if (auto* opacity = object.member("opacity")) {
+        if (opacity->type != JSONValue::Type::Number || opacity->number < 0 || opacity->number > 1)
+            return invalid("opacity");
+        layer.opacity = float(opacity->number);
+    }
+
+    bool masksToBounds = false;
+    if (auto* value = object.member("masksToBounds")) {
+        if (value->type != JSONValue::Type::Boolean)
+            return invalid("masksToBounds");
+        masksToBounds = value->boolean;
+    }
+
+    bool drawsContent = layer.width && layer.height;
+    if (auto* value = object.member("drawsContent")) {
+        if (value->type != JSONValue::Type::Boolean)
+            return invalid("drawsContent");
+        drawsContent = drawsContent && value->boolean;
+    }
+
+    std::vector<float> tileSize { float(parent.defaultTileWidth), float(parent.defaultTileHeight) };
+    if (!readNumbers(object, "tileSize", tileSize, 2) || tileSize[0] < 1 || tileSize[1] < 1)
+        return invalid("tileSize");
+    layer.tileWidth = uint32_t(tileSize[0]);
+    layer.tileHeight = uint32_t(tileSize[1]);
+
+    if (!loadUpdate(object, layer))
+        return invalid("update");
+
+    // Layer to window: the parent transform, the position, then the transform around the anchor point.
+    float originX = anchor[0] * size[0];
+    float originY = anchor[1] * size[1];
+    layer.transform = parent.transform;
+    layer.transform.translate(position[0] + originX, position[1] + originY);
+    if (transform.size() == 6)
+        layer.transform.multiply(TransformationMatrix::affine(transform[0], transform[1], transform[2], transform[3], transform[4], transform[5]));
+    else if (transform.size() == 16) {
+        std::array<float, 16> matrix;
+        std::copy(transform.begin(), transform.end(), matrix.begin());
+        layer.transform.multiply(TransformationMatrix(matrix));
+    }
+    layer.transform.translate(-originX, -originY);
+
+    // Bounding box of the transformed bounds, in window coordinates.
+    float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+    for (auto [x, y] : { std::pair { 0.0f, 0.0f }, { size[0], 0.0f }, { 0.0f, size[1] }, { size[0], size[1] } }) {
+        layer.transform.map(x, y);
+        left = std::min(left, x);
+        top = std::min(top, y);
+        right = std::max(right, x);
+        bottom = std::max(bottom, y);
+    }
+
+    SceneRect bounds { left, top, right - left, bottom - top };
+    layer.clip = parent.clip.intersection(bounds);
+
+    // Opacity is multiplied into the descendants instead of rendering the group into an intermediate surface.
+    layer.opacity *= parent.opacity;
+
+    LayerContext context = parent;
+    context.transform = layer.transform;
+    context.opacity = layer.opacity;
+    if (masksToBounds)
+        context.clip = layer.clip;
+
+    if (drawsContent)
+        layers.push_back(layer);
+
+    if (auto* children = object.member("children")) {
+        if (children->type != JSONValue::Type::Array)
+            return invalid("children");
+
+        for (auto& child : children->elements) {
+            if (!loadLayer(child, context, layers))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<Scene> Scene::load(const std::string& path, uint32_t defaultTileWidth, uint32_t defaultTileHeight)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        Logger::error("Failed to open the scene '%s': %s\n", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    std::string text;
+    struct stat status;
+    if (!fstat(fd, &status) && status.st_size > 0) {
+        text.resize(status.st_size);
+        if (read(fd, text.data(), text.size()) != ssize_t(text.size()))
+            text.clear();
+    }
+    close(fd);
+
+    JSONValue root;
+    JSONParser parser(text);
+    if (!parser.parse(root)) {
+        Logger::error("Scene '%s', line %u: %s\n", path.c_str(), parser.line(), parser.error());
+        return nullptr;
+    }
+
+    auto* layers = root.type == JSONValue::Type::Object ? root.member("layers") : nullptr;
+    if (!layers || layers->type != JSONValue::Type::Array) {
+        Logger::error("Scene '%s': expected an object with a 'layers' array\n", path.c_str());
+        return nullptr;
+    }
+
+    LayerContext context;
+    context.path = path.c_str();
+    context.defaultTileWidth = defaultTileWidth;
+    context.defaultTileHeight = defaultTileHeight;
+
+    auto scene = std::make_unique<Scene>();
+    for (auto& layer : layers->elements) {
+        if (!loadLayer(layer, context, scene->m_layers))
+            return nullptr;
+    }
+
+    if (scene->m_layers.empty()) {
+        Logger::error("Scene '%s': no layer draws content\n", path.c_str());
+        return nullptr;
+    }
+
+    return scene;
+}
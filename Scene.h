@@ -0,0 +1,78 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TransformationMatrix.h"
+
+// How a layer backing store is repainted while the scene is replayed.
+enum class SceneUpdatePattern {
+    Static, // painted once
+    Full, // all tiles, every 'interval' frames
+    Partial, // 'tiles' tiles round-robin, every 'interval' frames
+    Scroll // scrolls by 'scroll' pixels per frame, the tile rows / columns scrolled into view are repainted
+};
+
+// Window coordinates.
+struct SceneRect {
+    float x { 0.0f };
+    float y { 0.0f };
+    float width { 0.0f };
+    float height { 0.0f };
+
+    SceneRect intersection(const SceneRect&) const;
+    bool isEmpty() const { return width <= 0.0f || height <= 0.0f; }
+};
+
+// A layer that draws content, with the properties inherited from its ancestors already applied.
+struct SceneLayer {
+    std::string name;
+    uint32_t width { 0 };
+    uint32_t height { 0 };
+    uint32_t tileWidth { 0 };
+    uint32_t tileHeight { 0 };
+
+    TransformationMatrix transform; // layer to window coordinates
+    float opacity { 1.0f };
+    SceneRect clip; // own bounds and ancestor masks, axis-aligned
+
+    SceneUpdatePattern updatePattern { SceneUpdatePattern::Static };
+    uint32_t updateInterval { 1 };
+    uint32_t updateTileCount { 1 };
+    float scrollX { 0.0f };
+    float scrollY { 0.0f };
+};
+
+// Layer tree description replayed by SceneRenderer (--scene), flattened into the drawing layers
+// in paint order. See README.md for the JSON format.
+class Scene {
+public:
+    // Layers without 'tileSize' use the given tile size. Returns nullptr if the file is invalid.
+    static std::unique_ptr<Scene> load(const std::string& path, uint32_t defaultTileWidth, uint32_t defaultTileHeight);
+
+    const std::vector<SceneLayer>& layers() const { return m_layers; }
+
+private:
+    std::vector<SceneLayer> m_layers;
+};
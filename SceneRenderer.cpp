@@ -0,0 +1,242 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "SceneRenderer.h"
+
+#include "Application.h"
+#include "BandwidthCounters.h"
+#include "ContentSource.h"
+#include "EGL.h"
+#include "GPUTimer.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "TileRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <GLES2/gl2.h>
+
+SceneRenderer::SceneRenderer(std::unique_ptr<Scene>&& scene, const EGL& egl)
+    : m_scene(std::move(scene))
+    , m_egl(egl)
+{
+    for (auto& description : m_scene->layers()) {
+        // Scrolling layers keep one more row / column of tiles, partially visible at both edges.
+        bool scrolls = description.updatePattern == SceneUpdatePattern::Scroll;
+        uint32_t columns = (description.width + description.tileWidth - 1) / description.tileWidth + (scrolls && description.scrollX ? 1 : 0);
+        uint32_t rows = (description.height + description.tileHeight - 1) / description.tileHeight + (scrolls && description.scrollY ? 1 : 0);
+
+        Layer layer { description, TileRenderer::create(columns * rows, description.tileWidth, description.tileHeight, &m_egl), columns, rows };
+        layer.tileRenderer->initialize(columns * description.tileWidth, rows * description.tileHeight);
+        m_layers.push_back(std::move(layer));
+    }
+}
+
+SceneRenderer::~SceneRenderer()
+{
+    m_layers.clear();
+}
+
+std::unique_ptr<SceneRenderer> SceneRenderer::create(std::unique_ptr<Scene>&& scene, const EGL& egl)
+{
+    return std::make_unique<SceneRenderer>(std::move(scene), egl);
+}
+
+void SceneRenderer::allocateGLTiles()
+{
+    for (auto& layer : m_layers)
+        layer.tileRenderer->allocateGLTiles();
+}
+
+void SceneRenderer::allocateDMABufTiles(const DRM& drm, const GBM& gbm)
+{
+    for (auto& layer : m_layers)
+        layer.tileRenderer->allocateDMABufTiles(drm, gbm);
+}
+
+void SceneRenderer::initialize(uint32_t screenWidth, uint32_t screenHeight)
+{
+    m_screenWidth = screenWidth;
+    m_screenHeight = screenHeight;
+    m_projection = TransformationMatrix::orthographicProjection(0, m_screenWidth, m_screenHeight, 0, -1000, 1000);
+}
+
+void SceneRenderer::updateLayer(Layer& layer)
+{
+    auto& description = layer.description;
+    auto& tileRenderer = *layer.tileRenderer;
+    const uint32_t tileCount = tileRenderer.tileCount();
+
+    // The whole backing store is painted in the first frame, which is not part of the statistics.
+    if (!m_frame) {
+        tileRenderer.updateTiles();
+        return;
+    }
+
+    switch (description.updatePattern) {
+    case SceneUpdatePattern::Static:
+        break;
+    case SceneUpdatePattern::Full:
+        if (!(m_frame % description.updateInterval)) {
+            tileRenderer.updateTiles();
+            layer.updatedTiles += tileCount;
+        }
+        break;
+    case SceneUpdatePattern::Partial:
+        if (!(m_frame % description.updateInterval)) {
+            uint32_t count = std::min(description.updateTileCount, tileCount);
+            tileRenderer.updateTiles(layer.nextTile, count);
+            layer.nextTile = (layer.nextTile + count) % tileCount;
+            layer.updatedTiles += count;
+        }
+        break;
+    case SceneUpdatePattern::Scroll: {
+        // The tiles keep their position in the grid, the layer is offset by the scroll position modulo the tile
+        // size. Every tile boundary crossed repaints the next row / column of the ring, as if it scrolled into view.
+        auto crossedTiles = [](float& position, float delta, uint32_t tileSize) {
+            float previousPosition = position;
+            position += delta;
+            return uint32_t(fabsf(floorf(position / tileSize) - floorf(previousPosition / tileSize)));
+        };
+
+        uint32_t rows = std::min(crossedTiles(layer.scrollPositionY, description.scrollY, description.tileHeight), layer.rows);
+        for (uint32_t i = 0; i < rows; ++i) {
+            tileRenderer.updateTiles(layer.nextRow * layer.columns, layer.columns);
+            layer.nextRow = (layer.nextRow + 1) % layer.rows;
+        }
+
+        uint32_t columns = std::min(crossedTiles(layer.scrollPositionX, description.scrollX, description.tileWidth), layer.columns);
+        for (uint32_t i = 0; i < columns; ++i) {
+            tileRenderer.updateTiles(layer.nextColumn, layer.rows, layer.columns);
+            layer.nextColumn = (layer.nextColumn + 1) % layer.columns;
+        }
+
+        layer.updatedTiles += rows * layer.columns + columns * layer.rows;
+        break;
+    }
+    }
+}
+
+void SceneRenderer::compositeLayer(Layer& layer)
+{
+    auto& args = Application::commandLineArguments();
+    auto& description = layer.description;
+
+    SceneRect clip = description.clip.intersection({ 0.0f, 0.0f, float(m_screenWidth), float(m_screenHeight) });
+    if (clip.isEmpty() || !description.opacity)
+        return;
+
+    // The projection maps the layer coordinates 1:1 to window coordinates, as for the tile grid.
+    int32_t left = int32_t(floorf(clip.x));
+    int32_t top = int32_t(floorf(clip.y));
+    int32_t right = int32_t(ceilf(clip.x + clip.width));
+    int32_t bottom = int32_t(ceilf(clip.y + clip.height));
+    glScissor(left, top, right - left, bottom - top);
+
+    // The scissor only clips to the bounding box of the transformed layer, the tiles are clipped to the layer bounds.
+    auto mvp = m_projection;
+    mvp.multiply(description.transform);
+    TileRenderer::LayerBounds bounds { 0.0f, 0.0f, float(description.width), float(description.height) };
+    if (description.updatePattern == SceneUpdatePattern::Scroll) {
+        auto tileOffset = [](float position, uint32_t tileSize) { return position - floorf(position / tileSize) * tileSize; };
+        bounds.x = tileOffset(layer.scrollPositionX, description.tileWidth);
+        bounds.y = tileOffset(layer.scrollPositionY, description.tileHeight);
+        mvp.translate(-bounds.x, -bounds.y);
+    }
+
+    layer.tileRenderer->compositeLayer(mvp, description.opacity, bounds);
+
+    uint64_t pixels = uint64_t(right - left) * (bottom - top);
+    layer.compositedPixels += pixels;
+
+    // Like the tile grid: texels sampled and written, plus the read back for blending. Opaque tiles are not
+    // told apart, this is an upper bound.
+    if (auto* counters = BandwidthCounters::singleton()) {
+        bool blend = args.blend || description.opacity < 1.0f;
+        counters->add(BandwidthCounters::Stage::GPUComposition, pixels * (Tile::pixelFormat().bytesPerPixel + sizeof(uint32_t) * (blend ? 2 : 1)));
+    }
+}
+
+void SceneRenderer::renderFrame()
+{
+    auto& args = Application::commandLineArguments();
+    auto* gpuTimer = m_egl.gpuTimer();
+
+    PerfCounterScope scope(PerfCounters::Scope::RenderTiles);
+    {
+        GPUTimerScope updateScope(gpuTimer, GPUTimer::Stage::TileUpdate);
+        // All layers take their content out of the same frame of a --content-file.
+        auto* contentSource = ContentSource::singleton();
+        if (contentSource && !args.noAnimate)
+            contentSource->advance();
+        for (auto& layer : m_layers)
+            updateLayer(layer);
+    }
+
+    glViewport(0, 0, m_screenWidth, m_screenHeight);
+    if (args.clear) {
+        GPUTimerScope clearScope(gpuTimer, GPUTimer::Stage::ColorClear);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        if (auto* counters = BandwidthCounters::singleton())
+            counters->add(BandwidthCounters::Stage::GPUComposition, uint64_t(m_screenWidth) * m_screenHeight * sizeof(uint32_t));
+    }
+
+    {
+        GPUTimerScope compositionScope(gpuTimer, GPUTimer::Stage::Composition);
+        glEnable(GL_SCISSOR_TEST);
+        for (auto& layer : m_layers)
+            compositeLayer(layer);
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    ++m_frame;
+}
+
+void SceneRenderer::report() const
+{
+    if (m_frame < 2)
+        return;
+
+    // The first frame paints all tiles and is excluded from the update rate.
+    const double frames = double(m_frame);
+    const double updateFrames = double(m_frame - 1);
+
+    uint32_t tileCount = 0;
+    uint64_t updatedTiles = 0;
+    uint64_t compositedPixels = 0;
+    for (auto& layer : m_layers) {
+        tileCount += layer.tileRenderer->tileCount();
+        updatedTiles += layer.updatedTiles;
+        compositedPixels += layer.compositedPixels;
+    }
+
+    Logger::info("Scene: %zu layers, %u tiles, %.2f tiles repainted / frame, %.2f MPixel composited / frame (%.2fx the window)\n",
+                 m_layers.size(), tileCount, double(updatedTiles) / updateFrames, double(compositedPixels) / frames / 1e6,
+                 double(compositedPixels) / frames / (double(m_screenWidth) * m_screenHeight));
+
+    for (auto& layer : m_layers) {
+        auto& description = layer.description;
+        Logger::info("  %-24s %4ux%-4u %3u tiles of %ux%u, opacity %.2f, %6.2f tiles repainted / frame, %6.3f MPixel composited / frame\n",
+                     description.name.c_str(), description.width, description.height, layer.tileRenderer->tileCount(), description.tileWidth, description.tileHeight,
+                     description.opacity, double(layer.updatedTiles) / updateFrames, double(layer.compositedPixels) / frames / 1e6);
+    }
+}
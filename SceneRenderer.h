@@ -0,0 +1,81 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Scene.h"
+#include "TransformationMatrix.h"
+
+class DRM;
+class EGL;
+class GBM;
+class TileRenderer;
+
+// --scene: replays a layer tree. Every layer owns a TileRenderer for its backing store, the tiles due in a
+// frame are updated first, then the layers are composited back to front with their transform, opacity and clip.
+class SceneRenderer {
+public:
+    SceneRenderer(std::unique_ptr<Scene>&&, const EGL&);
+    ~SceneRenderer();
+
+    static std::unique_ptr<SceneRenderer> create(std::unique_ptr<Scene>&&, const EGL&);
+
+    void allocateGLTiles();
+    void allocateDMABufTiles(const DRM&, const GBM&);
+
+    void initialize(uint32_t screenWidth, uint32_t screenHeight);
+
+    void renderFrame();
+
+    // Tiles repainted and pixels composited per frame, per layer.
+    void report() const;
+
+private:
+    struct Layer {
+        const SceneLayer& description;
+        std::unique_ptr<TileRenderer> tileRenderer;
+        uint32_t columns { 0 };
+        uint32_t rows { 0 };
+
+        float scrollPositionX { 0.0f };
+        float scrollPositionY { 0.0f };
+        uint32_t nextTile { 0 }; // 'partial': next tile to repaint
+        uint32_t nextRow { 0 }; // 'scroll': next row / column of the tile ring to repaint
+        uint32_t nextColumn { 0 };
+
+        uint64_t updatedTiles { 0 };
+        uint64_t compositedPixels { 0 };
+    };
+
+    void updateLayer(Layer&);
+    void compositeLayer(Layer&);
+
+    std::unique_ptr<Scene> m_scene;
+    const EGL& m_egl;
+    std::vector<Layer> m_layers;
+
+    uint32_t m_screenWidth { 0 };
+    uint32_t m_screenHeight { 0 };
+    TransformationMatrix m_projection;
+    uint64_t m_frame { 0 };
+};
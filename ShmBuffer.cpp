@@ -0,0 +1,86 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ShmBuffer.h"
+
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+ShmBuffer::ShmBuffer(uint32_t width, uint32_t height, uint32_t stride)
+    : WaylandBuffer(width, height)
+    , m_stride(stride)
+{
+}
+
+ShmBuffer::~ShmBuffer()
+{
+    if (m_data)
+        munmap(m_data, colorBufferSize());
+}
+
+std::unique_ptr<ShmBuffer> ShmBuffer::create(struct wl_shm* shm, uint32_t format, uint32_t width, uint32_t height)
+{
+    // 64 byte aligned rows, to keep the SIMD stores aligned.
+    const uint32_t stride = (width * sizeof(uint32_t) + 63) & ~63u;
+
+    auto shmBuffer = std::make_unique<ShmBuffer>(width, height, stride);
+    if (!shmBuffer->allocate(shm, format))
+        return nullptr;
+    return shmBuffer;
+}
+
+bool ShmBuffer::allocate(struct wl_shm* shm, uint32_t format)
+{
+    const auto size = colorBufferSize();
+
+    int fd = memfd_create("wpe-testbed-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        Logger::error("memfd_create() failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        Logger::error("ftruncate() failed: %s\n", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    auto* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        Logger::error("mmap() failed: %s\n", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    m_data = static_cast<uint32_t*>(data);
+
+    // The buffer keeps the pool alive, the pool itself is not needed anymore.
+    auto* pool = wl_shm_create_pool(shm, fd, size);
+    m_wlBuffer = wl_shm_pool_create_buffer(pool, 0, m_width, m_height, m_stride, format);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    return !!m_wlBuffer;
+}
@@ -0,0 +1,46 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include "WaylandBuffer.h"
+
+#include <memory>
+
+struct wl_shm;
+
+// CPU-accessible window buffer in a wl_shm pool (--software).
+class ShmBuffer final : public WaylandBuffer {
+public:
+    ShmBuffer(uint32_t width, uint32_t height, uint32_t stride);
+    ~ShmBuffer() override;
+
+    static std::unique_ptr<ShmBuffer> create(struct wl_shm*, uint32_t format, uint32_t width, uint32_t height);
+
+    uint32_t* data() const { return m_data; }
+    uint32_t stride() const { return m_stride; }
+
+    uint64_t colorBufferSize() const override { return uint64_t(m_stride) * m_height; }
+
+private:
+    bool allocate(struct wl_shm*, uint32_t format);
+
+    uint32_t m_stride { 0 };
+    uint32_t* m_data { nullptr };
+};
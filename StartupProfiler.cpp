@@ -0,0 +1,60 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "StartupProfiler.h"
+
+#include "Application.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <vector>
+
+struct StartupPhase {
+    const char* name { nullptr };
+    int64_t endTime { 0 };
+};
+
+static std::vector<StartupPhase>& startupPhases()
+{
+    static std::vector<StartupPhase> s_phases;
+    return s_phases;
+}
+
+void StartupProfiler::markPhase(const char* name)
+{
+    startupPhases().push_back({ name, getCurrentTimeInNanoSeconds() });
+}
+
+void StartupProfiler::report()
+{
+    auto toMilliSeconds = [](int64_t time) { return double(time) / double(nsPerSecond / msPerSecond); };
+
+    auto startTime = Application::startTime();
+    auto& phases = startupPhases();
+    if (phases.empty())
+        return;
+
+    Logger::info("Startup: first frame committed %.3f ms after launch\n", toMilliSeconds(phases.back().endTime - startTime));
+
+    auto phaseStartTime = startTime;
+    for (auto& phase : phases) {
+        Logger::info("  %-24s %8.3f ms (at %8.3f ms)\n", phase.name, toMilliSeconds(phase.endTime - phaseStartTime), toMilliSeconds(phase.endTime - startTime));
+        phaseStartTime = phase.endTime;
+    }
+}
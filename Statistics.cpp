@@ -19,8 +19,22 @@
 
 #include "Statistics.h"
 
+#include "BandwidthCounters.h"
 #include "Logger.h"
+#include "PerfCounters.h"
 #include "Utilities.h"
+#include "presentation-time-client-protocol.h"
+
+#include <algorithm>
+
+static double percentileInMilliSeconds(const std::vector<int64_t>& sortedSamples, double percentile)
+{
+    if (sortedSamples.empty())
+        return 0;
+
+    auto index = static_cast<size_t>(percentile / 100.0 * double(sortedSamples.size() - 1) + 0.5);
+    return double(sortedSamples[std::min(index, sortedSamples.size() - 1)]) / double(nsPerSecond / msPerSecond);
+}
 
 Statistics::Statistics()
 {
@@ -29,6 +43,191 @@ Statistics::Statistics()
 void Statistics::initialize()
 {
     m_startTimeInNanoSeconds = m_lastReportTimeInNanoSeconds = getCurrentTimeInNanoSeconds();
+
+    m_presentationLatencies.clear();
+    m_refreshIntervals.clear();
+    m_missedVBlanks = 0;
+    m_discardedPresentations = 0;
+    m_zeroCopyPresentations = 0;
+    m_hardwareClockPresentations = 0;
+    m_hardwareCompletionPresentations = 0;
+    m_vsyncPresentations = 0;
+
+    m_scheduledFrameLatencies.clear();
+    m_missedDeadlines = 0;
+
+    m_remoteRoundTripTimes.clear();
+    m_remoteTransferTimes.clear();
+    m_remotePaintTimes.clear();
+
+    for (auto& stageTimes : m_gpuStageTimes)
+        stageTimes.clear();
+    m_gpuFrameTimes.clear();
+    m_gpuFrameTimesAtLastReport = 0;
+
+    if (auto* counters = PerfCounters::singleton())
+        counters->reset();
+    if (auto* counters = BandwidthCounters::singleton())
+        counters->reset();
+}
+
+void Statistics::recordPresentation(int64_t commitTimeInNanoSeconds, int64_t presentationTimeInNanoSeconds, uint32_t refreshInNanoSeconds, uint64_t sequence, uint32_t flags)
+{
+    m_presentationLatencies.push_back(presentationTimeInNanoSeconds - commitTimeInNanoSeconds);
+    if (refreshInNanoSeconds)
+        m_refreshIntervals.push_back(refreshInNanoSeconds);
+
+    // Count the vblanks elapsed since the previous presentation. Prefer the
+    // MSC counter, fall back to the refresh interval if the output has none.
+    uint64_t elapsedVBlanks = 0;
+    if (m_lastPresentationSequence && sequence > m_lastPresentationSequence)
+        elapsedVBlanks = sequence - m_lastPresentationSequence;
+    else if (m_lastPresentationTimeInNanoSeconds && refreshInNanoSeconds)
+        elapsedVBlanks = (presentationTimeInNanoSeconds - m_lastPresentationTimeInNanoSeconds + refreshInNanoSeconds / 2) / refreshInNanoSeconds;
+
+    if (elapsedVBlanks > 1)
+        m_missedVBlanks += elapsedVBlanks - 1;
+
+    m_lastPresentationTimeInNanoSeconds = presentationTimeInNanoSeconds;
+    m_lastPresentationSequence = sequence;
+
+    if (flags & WP_PRESENTATION_FEEDBACK_KIND_VSYNC)
+        ++m_vsyncPresentations;
+    if (flags & WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK)
+        ++m_hardwareClockPresentations;
+    if (flags & WP_PRESENTATION_FEEDBACK_KIND_HW_COMPLETION)
+        ++m_hardwareCompletionPresentations;
+    if (flags & WP_PRESENTATION_FEEDBACK_KIND_ZERO_COPY)
+        ++m_zeroCopyPresentations;
+}
+
+void Statistics::recordScheduledFrame(int64_t latencyInNanoSeconds, bool missedDeadline)
+{
+    m_scheduledFrameLatencies.push_back(latencyInNanoSeconds);
+    if (missedDeadline)
+        ++m_missedDeadlines;
+}
+
+void Statistics::recordRemoteUpdate(int64_t roundTripTimeInNanoSeconds, int64_t transferTimeInNanoSeconds, int64_t paintTimeInNanoSeconds)
+{
+    m_remoteRoundTripTimes.push_back(roundTripTimeInNanoSeconds);
+    m_remoteTransferTimes.push_back(transferTimeInNanoSeconds);
+    m_remotePaintTimes.push_back(paintTimeInNanoSeconds);
+}
+
+void Statistics::reportRemoteUpdates() const
+{
+    auto updates = m_remoteRoundTripTimes.size();
+    if (!updates)
+        return;
+
+    auto report = [](const char* name, std::vector<int64_t> samples) {
+        std::sort(samples.begin(), samples.end());
+        Logger::info("  %s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+                     percentileInMilliSeconds(samples, 50),
+                     percentileInMilliSeconds(samples, 90),
+                     percentileInMilliSeconds(samples, 99),
+                     percentileInMilliSeconds(samples, 100));
+    };
+
+    // IPC overhead = round trip - time spent painting in the painter process.
+    std::vector<int64_t> overheads(updates);
+    for (size_t i = 0; i < updates; ++i)
+        overheads[i] = m_remoteRoundTripTimes[i] - m_remotePaintTimes[i];
+
+    Logger::info("Received %5llu tile updates from the painter process\n", static_cast<unsigned long long>(updates));
+    report("request-to-update round trip", m_remoteRoundTripTimes);
+    report("painter paint time", m_remotePaintTimes);
+    report("update transfer (painter -> compositor)", m_remoteTransferTimes);
+    report("IPC overhead (round trip - paint)", overheads);
+}
+
+void Statistics::recordGPUTimes(const GPUTimer::StageTimes& times)
+{
+    int64_t frameTime = 0;
+    for (uint32_t stage = 0; stage < GPUTimer::stageCount; ++stage) {
+        m_gpuStageTimes[stage].push_back(times[stage]);
+        frameTime += times[stage];
+    }
+
+    m_gpuFrameTimes.push_back(frameTime);
+}
+
+void Statistics::reportGPUTimes() const
+{
+    auto frames = m_gpuFrameTimes.size();
+    if (!frames)
+        return;
+
+    auto report = [](const char* name, std::vector<int64_t> samples) {
+        std::sort(samples.begin(), samples.end());
+        Logger::info("  %s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+                     percentileInMilliSeconds(samples, 50),
+                     percentileInMilliSeconds(samples, 90),
+                     percentileInMilliSeconds(samples, 99),
+                     percentileInMilliSeconds(samples, 100));
+    };
+
+    Logger::info("GPU time of %5llu frames\n", static_cast<unsigned long long>(frames));
+    for (uint32_t stage = 0; stage < GPUTimer::stageCount; ++stage) {
+        auto& samples = m_gpuStageTimes[stage];
+        if (std::any_of(samples.begin(), samples.end(), [](int64_t time) { return time > 0; }))
+            report(GPUTimer::stageName(static_cast<GPUTimer::Stage>(stage)), samples);
+    }
+    report("frame", m_gpuFrameTimes);
+}
+
+void Statistics::reportScheduledFrames() const
+{
+    auto scheduled = m_scheduledFrameLatencies.size();
+    if (!scheduled)
+        return;
+
+    auto latencies = m_scheduledFrameLatencies;
+    std::sort(latencies.begin(), latencies.end());
+
+    Logger::info("Scheduled %5llu frames (%llu missed deadlines, %.1f%% miss rate)\n",
+                 static_cast<unsigned long long>(scheduled),
+                 static_cast<unsigned long long>(m_missedDeadlines),
+                 100.0 * double(m_missedDeadlines) / double(scheduled));
+    Logger::info("  render-start-to-present latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                 percentileInMilliSeconds(latencies, 50),
+                 percentileInMilliSeconds(latencies, 90),
+                 percentileInMilliSeconds(latencies, 99),
+                 percentileInMilliSeconds(latencies, 100));
+}
+
+void Statistics::reportPresentation() const
+{
+    auto presented = m_presentationLatencies.size();
+    if (!presented && !m_discardedPresentations)
+        return;
+
+    auto latencies = m_presentationLatencies;
+    std::sort(latencies.begin(), latencies.end());
+
+    auto refreshIntervals = m_refreshIntervals;
+    std::sort(refreshIntervals.begin(), refreshIntervals.end());
+
+    auto percentage = [&](uint64_t count) {
+        return presented ? 100.0 * double(count) / double(presented) : 0.0;
+    };
+
+    Logger::info("Presented %5llu frames (%llu discarded, %llu missed vblanks)\n",
+                 static_cast<unsigned long long>(presented),
+                 static_cast<unsigned long long>(m_discardedPresentations),
+                 static_cast<unsigned long long>(m_missedVBlanks));
+    Logger::info("  commit-to-present latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                 percentileInMilliSeconds(latencies, 50),
+                 percentileInMilliSeconds(latencies, 90),
+                 percentileInMilliSeconds(latencies, 99),
+                 percentileInMilliSeconds(latencies, 100));
+    Logger::info("  refresh interval: p50 %.3f ms\n", percentileInMilliSeconds(refreshIntervals, 50));
+    Logger::info("  flags: vsync %.1f%%, hw-clock %.1f%%, hw-completion %.1f%%, zero-copy %.1f%%\n",
+                 percentage(m_vsyncPresentations),
+                 percentage(m_hardwareClockPresentations),
+                 percentage(m_hardwareCompletionPresentations),
+                 percentage(m_zeroCopyPresentations));
 }
 
 void Statistics::reportFrameRate(bool force) const
@@ -48,4 +247,33 @@ void Statistics::reportFrameRate(bool force) const
 		 elapsedTimeInSeconds,
 		 double(frames) / elapsedTimeInSeconds);
     m_lastReportTimeInNanoSeconds = currentTimeInNanoSeconds;
+
+    // Mean GPU time of the frames whose timer queries completed since the last report.
+    if (m_gpuFrameTimes.size() > m_gpuFrameTimesAtLastReport) {
+        auto count = m_gpuFrameTimes.size() - m_gpuFrameTimesAtLastReport;
+        auto mean = [&](const std::vector<int64_t>& samples) {
+            int64_t sum = 0;
+            for (size_t i = m_gpuFrameTimesAtLastReport; i < samples.size(); ++i)
+                sum += samples[i];
+            return double(sum) / double(count) / double(nsPerSecond / msPerSecond);
+        };
+
+        Logger::info("  GPU time per frame %.3f ms (", mean(m_gpuFrameTimes));
+        for (uint32_t stage = 0; stage < GPUTimer::stageCount; ++stage)
+            Logger::info("%s%s %.3f ms", stage ? ", " : "", GPUTimer::stageName(static_cast<GPUTimer::Stage>(stage)), mean(m_gpuStageTimes[stage]));
+        Logger::info(")\n");
+        m_gpuFrameTimesAtLastReport = m_gpuFrameTimes.size();
+    }
+
+    if (force) {
+        reportPresentation();
+        reportScheduledFrames();
+        reportRemoteUpdates();
+        reportGPUTimes();
+
+        if (auto* counters = PerfCounters::singleton())
+            counters->report(frames);
+        if (auto* counters = BandwidthCounters::singleton())
+            counters->report(frames);
+    }
 }
@@ -19,7 +19,11 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <vector>
+
+#include "GPUTimer.h"
 
 class alignas(8) Statistics {
 public:
@@ -31,8 +35,48 @@ public:
     void advanceFrame() { ++m_currentFrame; }
     uint64_t currentFrame() const { return m_currentFrame; }
 
+    // wp_presentation feedback, timestamps in the presentation clock domain.
+    void recordPresentation(int64_t commitTimeInNanoSeconds, int64_t presentationTimeInNanoSeconds, uint32_t refreshInNanoSeconds, uint64_t sequence, uint32_t flags);
+    void recordDiscardedPresentation() { ++m_discardedPresentations; }
+
+    // Deadline scheduling: latency from render start (input sampling) to presentation.
+    void recordScheduledFrame(int64_t latencyInNanoSeconds, bool missedDeadline);
+
+    // --multi-process: cost of obtaining the tiles from the painter process.
+    void recordRemoteUpdate(int64_t roundTripTimeInNanoSeconds, int64_t transferTimeInNanoSeconds, int64_t paintTimeInNanoSeconds);
+
+    // --gpu-timing: GPU time per stage of a frame, recorded when the queries complete (a few frames late).
+    void recordGPUTimes(const GPUTimer::StageTimes&);
+
 private:
+    void reportPresentation() const;
+    void reportScheduledFrames() const;
+    void reportRemoteUpdates() const;
+    void reportGPUTimes() const;
+
     alignas(8) uint64_t m_currentFrame { 0 };
     alignas(8) int64_t m_startTimeInNanoSeconds { 0 };
     alignas(8) mutable int64_t m_lastReportTimeInNanoSeconds { 0 };
+
+    std::vector<int64_t> m_presentationLatencies;
+    std::vector<int64_t> m_refreshIntervals;
+    int64_t m_lastPresentationTimeInNanoSeconds { 0 };
+    uint64_t m_lastPresentationSequence { 0 };
+    uint64_t m_missedVBlanks { 0 };
+    uint64_t m_discardedPresentations { 0 };
+    uint64_t m_zeroCopyPresentations { 0 };
+    uint64_t m_hardwareClockPresentations { 0 };
+    uint64_t m_hardwareCompletionPresentations { 0 };
+    uint64_t m_vsyncPresentations { 0 };
+
+    std::vector<int64_t> m_scheduledFrameLatencies;
+    uint64_t m_missedDeadlines { 0 };
+
+    std::vector<int64_t> m_remoteRoundTripTimes;
+    std::vector<int64_t> m_remoteTransferTimes;
+    std::vector<int64_t> m_remotePaintTimes;
+
+    std::array<std::vector<int64_t>, GPUTimer::stageCount> m_gpuStageTimes;
+    std::vector<int64_t> m_gpuFrameTimes;
+    mutable size_t m_gpuFrameTimesAtLastReport { 0 };
 };
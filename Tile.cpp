@@ -20,11 +20,19 @@
 #include "Tile.h"
 
 #include "Application.h"
+#include "BandwidthCounters.h"
 #include "DMABuffer.h"
 #include "EGL.h"
 #include "GBM.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "PixelUnpackBufferRing.h"
+#include "TilePainter.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <vector>
@@ -42,7 +50,15 @@
 #define HAS_NEON 0
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define HAS_SSE2 1
+#else
+#define HAS_SSE2 0
+#endif
+
 static uint32_t s_tileIndex = 0;
+static uint32_t s_animationIndex = 0;
 
 static inline uintptr_t alignUpper(uintptr_t x, uintptr_t alignment)
 {
@@ -61,11 +77,26 @@ Tile::Tile(uint32_t width, uint32_t height)
 	m_width = alignUpper(m_width, 64 /*superTileSize */);
 	m_height = alignUpper(m_height, 64 /* superTileSize */);
     }
+
+    m_opaque = !pixelFormat().hasAlpha;
 }
 
 Tile::~Tile()
 {
-    glDeleteTextures(1, &m_id);
+    if (m_frameBuffer)
+        glDeleteFramebuffers(1, &m_frameBuffer);
+    if (m_backFrameBuffer)
+        glDeleteFramebuffers(1, &m_backFrameBuffer);
+
+    if (m_id)
+        glDeleteTextures(1, &m_id);
+
+    if (m_mappedAddress)
+        munmap(m_mappedAddress, m_mappedSize);
+    if (m_backMappedAddress)
+        munmap(m_backMappedAddress, m_mappedSize);
+
+    free(m_memory);
 }
 
 std::unique_ptr<Tile> Tile::createGLTile(uint32_t width, uint32_t height)
@@ -73,14 +104,63 @@ std::unique_ptr<Tile> Tile::createGLTile(uint32_t width, uint32_t height)
     auto tile = std::make_unique<Tile>(width, height);
     if (!tile->allocateGLTexture())
         return nullptr;
+    tile->m_updateFunction = updateFunction(Application::commandLineArguments().tileUpdateMethod);
     return tile;
 }
 
-std::unique_ptr<Tile> Tile::createDMABufTile(uint32_t width, uint32_t height, const DRM& drm, const GBM& gbm, const EGL& egl)
+std::vector<std::unique_ptr<Tile>> Tile::createDMABufTiles(uint32_t count, uint32_t width, uint32_t height, const DRM& drm, const GBM& gbm, const EGL& egl, bool doubleBuffered)
+{
+    std::vector<std::unique_ptr<Tile>> tiles;
+    tiles.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+        tiles.push_back(std::make_unique<Tile>(width, height));
+
+    if (tiles.empty())
+        return tiles;
+
+    // The tile size may have been aligned, allocate the buffers with the tile size.
+    const uint32_t bufferCount = doubleBuffered ? count * 2 : count;
+    auto buffers = DMABuffer::createBatch(DMABuffer::Role::TileBuffer, drm, gbm, egl, pixelFormat().fourcc, tiles[0]->width(), tiles[0]->height(), bufferCount);
+    if (buffers.size() != bufferCount)
+        return { };
+
+    for (uint32_t i = 0; i < count; ++i) {
+        auto& tile = *tiles[i];
+        tile.m_buffer = std::move(buffers[i]);
+        if (doubleBuffered)
+            tile.m_backBuffer = std::move(buffers[count + i]);
+        tile.m_id = tile.m_buffer->glTexture();
+        tile.m_dmaBufBacked = true;
+        tile.m_updateFunction = updateFunction(Application::commandLineArguments().tileUpdateMethod);
+    }
+
+    return tiles;
+}
+
+void Tile::swapBuffers()
+{
+    assert(m_backBuffer);
+    std::swap(m_buffer, m_backBuffer);
+    std::swap(m_frameBuffer, m_backFrameBuffer);
+    std::swap(m_mappedAddress, m_backMappedAddress);
+    m_id = m_buffer->glTexture();
+}
+
+std::unique_ptr<Tile> Tile::createImportedDMABufTile(std::unique_ptr<DMABuffer>&& buffer)
+{
+    auto tile = std::make_unique<Tile>(buffer->width(), buffer->height());
+    tile->m_buffer = std::move(buffer);
+    tile->m_id = tile->m_buffer->glTexture();
+    tile->m_dmaBufBacked = true;
+    return tile;
+}
+
+std::unique_ptr<Tile> Tile::createMemoryTile(uint32_t width, uint32_t height)
 {
     auto tile = std::make_unique<Tile>(width, height);
-    if (!tile->allocateDMABuf(drm, gbm, egl))
+    if (!tile->allocateMemory())
         return nullptr;
+    tile->m_updateFunction = &Tile::updateContentMemory;
     return tile;
 }
 
@@ -96,19 +176,21 @@ bool Tile::allocateGLTexture()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // ES 2.0 has no RGBX textures, XBGR8888 tiles are allocated as RGBA and only composited as opaque.
+    auto& format = pixelFormat();
+    glTexImage2D(GL_TEXTURE_2D, 0, format.glFormat, m_width, m_height, 0, format.glFormat, format.glType, nullptr);
     m_dmaBufBacked = false;
     return true;
 }
 
-bool Tile::allocateDMABuf(const DRM& drm, const GBM& gbm, const EGL& egl)
+bool Tile::allocateMemory()
 {
-    m_buffer = DMABuffer::create(DMABuffer::Role::TileBuffer, drm, gbm, egl, DRM_FORMAT_ABGR8888, m_width, m_height);
-    if (!m_buffer)
+    const size_t size = alignUpper(m_width * m_height * sizeof(uint32_t), 64);
+    m_memory = static_cast<uint32_t*>(std::aligned_alloc(64, size));
+    if (!m_memory)
         return false;
 
-    m_id = m_buffer->glTexture();
-    m_dmaBufBacked = true;
+    memset(m_memory, 0, size);
     return true;
 }
 
@@ -273,23 +355,6 @@ static void storeLinearBufferInVivanteSuperTiledFormat_Generic(uint32_t* dst, ui
     }
 }
 
-inline void storeLinearBufferInVivanteSuperTiledFormat(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
-                                                       const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
-{
-    assert(dw == alignUpper(dw, superTileSize));
-    assert(dh == alignUpper(dh, superTileSize));
-
-#if HAS_NEON
-    auto& args = Application::commandLineArguments();
-    if (args.neon) {
-        storeLinearBufferInVivanteSuperTiledFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
-        return;
-    }
-#endif
-
-    storeLinearBufferInVivanteSuperTiledFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
-}
-
 // Vivante Tiled Format
 
 inline void storeLinearBufferInVivanteTiledFormat_Generic(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
@@ -356,20 +421,6 @@ inline void storeLinearBufferInVivanteTiledFormat_NEON(uint32_t* dst, uint32_t d
 }
 #endif
 
-inline void storeLinearBufferInVivanteTiledFormat(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
-                                                  const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
-{
-#if HAS_NEON
-    auto& args = Application::commandLineArguments();
-    if (args.neon) {
-        storeLinearBufferInVivanteTiledFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
-        return;
-    }
-#endif
-
-    storeLinearBufferInVivanteTiledFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
-}
-
 // Linear format
 
 #if HAS_NEON
@@ -378,9 +429,11 @@ inline void storeLinearBufferInLinearFormat_NEON(uint32_t* dst, uint32_t dx, uin
 {
     constexpr uint32_t numberOfPixelsPerBatch = 16;
     constexpr uint32_t prefetchBytes = numberOfPixelsPerBatch * sizeof(uint32_t);
-    const uint32_t dwAligned = alignUpper(dw, numberOfPixelsPerBatch);
 
-    for (uint32_t y = 0; y < dh; ++y) {
+    // Only the source rectangle is copied, the destination size is just an upper bound.
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
         const uint32_t* srcRow = src + y * spitch;
         uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
 
@@ -389,7 +442,7 @@ inline void storeLinearBufferInLinearFormat_NEON(uint32_t* dst, uint32_t dx, uin
         __builtin_prefetch(dstRow + prefetchBytes, 1, 1);
 
         uint32_t x = 0;
-        for (; x < dwAligned; x += numberOfPixelsPerBatch) {
+        for (; x + numberOfPixelsPerBatch <= sw; x += numberOfPixelsPerBatch) {
             // Prefetch the next memory block
             __builtin_prefetch(srcRow + x + prefetchBytes, 0, 1);
             __builtin_prefetch(dstRow + x + prefetchBytes, 1, 1);
@@ -406,7 +459,7 @@ inline void storeLinearBufferInLinearFormat_NEON(uint32_t* dst, uint32_t dx, uin
         }
 
         // Handle remaining pixels
-        for (; x < dw; ++x)
+        for (; x < sw; ++x)
             dstRow[x] = srcRow[x];
     }
 }
@@ -417,9 +470,11 @@ inline void storeLinearBufferInLinearFormat_Generic(uint32_t* dst, uint32_t dx,
 {
     constexpr uint32_t numberOfPixelsPerBatch = 16;
     constexpr uint32_t prefetchBytes = numberOfPixelsPerBatch * sizeof(uint32_t);
-    const uint32_t dwAligned = alignUpper(dw, numberOfPixelsPerBatch);
 
-    for (uint32_t y = 0; y < dh; ++y) {
+    // Only the source rectangle is copied, the destination size is just an upper bound.
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
         const uint32_t* srcRow = src + y * spitch;
         uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
 
@@ -428,7 +483,7 @@ inline void storeLinearBufferInLinearFormat_Generic(uint32_t* dst, uint32_t dx,
         __builtin_prefetch(dstRow + prefetchBytes, 1, 1);
 
         uint32_t x = 0;
-        for (; x < dwAligned; x += numberOfPixelsPerBatch) {
+        for (; x + numberOfPixelsPerBatch <= sw; x += numberOfPixelsPerBatch) {
             // Prefetch the next memory block
             __builtin_prefetch(srcRow + x + prefetchBytes, 0, 1);
             __builtin_prefetch(dstRow + x + prefetchBytes, 1, 1);
@@ -438,29 +493,863 @@ inline void storeLinearBufferInLinearFormat_Generic(uint32_t* dst, uint32_t dx,
         }
 
         // Handle remaining pixels
-        for (; x < dw; ++x)
+        for (; x < sw; ++x)
             dstRow[x] = srcRow[x];
     }
 }
 
-inline void storeLinearBufferInLinearFormat(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
-                                            const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+// Streaming stores (--store-kernel)
+
+// Write-combined mappings are neither read nor cached: no destination prefetch, and every store fills a
+// whole 64 byte burst, bypassing the caches where the ISA has non-temporal stores.
+static constexpr uint32_t burstPixels = 64 / sizeof(uint32_t);
+
+static inline void streamBurst(uint32_t* dst, const uint32_t* src0, const uint32_t* src1, const uint32_t* src2, const uint32_t* src3)
+{
+#if defined(__aarch64__)
+    uint32x4_t v0 = vld1q_u32(src0);
+    uint32x4_t v1 = vld1q_u32(src1);
+    uint32x4_t v2 = vld1q_u32(src2);
+    uint32x4_t v3 = vld1q_u32(src3);
+    asm volatile("stnp %q[v0], %q[v1], [%[dst]]\n\t"
+                 "stnp %q[v2], %q[v3], [%[dst], #32]"
+                 :
+                 : [v0] "w"(v0), [v1] "w"(v1), [v2] "w"(v2), [v3] "w"(v3), [dst] "r"(dst)
+                 : "memory");
+#elif HAS_SSE2
+    // _mm_stream_si128 needs 16 byte aligned destinations, the callers write aligned bursts only.
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0)));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1)));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src2)));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 12), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src3)));
+#elif HAS_NEON
+    // ARMv7 has no non-temporal stores, the burst is still written back to back.
+    vst1q_u32(dst, vld1q_u32(src0));
+    vst1q_u32(dst + 4, vld1q_u32(src1));
+    vst1q_u32(dst + 8, vld1q_u32(src2));
+    vst1q_u32(dst + 12, vld1q_u32(src3));
+#else
+    memcpy(dst, src0, 4 * sizeof(uint32_t));
+    memcpy(dst + 4, src1, 4 * sizeof(uint32_t));
+    memcpy(dst + 8, src2, 4 * sizeof(uint32_t));
+    memcpy(dst + 12, src3, 4 * sizeof(uint32_t));
+#endif
+}
+
+// Orders the non-temporal stores before the DMA_BUF_IOCTL_SYNC / unmap that hands the buffer to the GPU.
+static inline void streamFence()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb ishst" ::: "memory");
+#elif HAS_SSE2
+    _mm_sfence();
+#endif
+}
+
+static inline uint32_t vivanteTiledOffset(uint32_t x, uint32_t y, uint32_t dpitch)
+{
+    return (((y >> 2) * dpitch + (y & 3)) << 2) + ((x >> 2) << 4) + (x & 3);
+}
+
+static inline uint32_t vivanteSuperTiledOffset(uint32_t x, uint32_t y, uint32_t dw)
+{
+    const uint32_t ySuperTileOffset = y & superTileMask;
+    const uint32_t ySuperTile2x2Offset = ySuperTileOffset & superTile2x2Mask;
+    const uint32_t ySuperTile4x4Offset = ySuperTile2x2Offset & superTile4x4Mask;
+    const uint32_t ySuperTile8x8Offset = ySuperTile4x4Offset & superTile8x8Mask;
+
+    const uint32_t xSuperTileOffset = x & superTileMask;
+    const uint32_t xSuperTile2x2Offset = xSuperTileOffset & superTile2x2Mask;
+    const uint32_t xSuperTile4x4Offset = xSuperTile2x2Offset & superTile4x4Mask;
+    const uint32_t xSuperTile8x8Offset = xSuperTile4x4Offset & superTile8x8Mask;
+
+    return (y >> superTileShift) * (dw << superTileShift) +
+           (ySuperTileOffset >> superTile2x2Shift) * stride2x2Pixels +
+           (ySuperTile2x2Offset >> superTile4x4Shift) * stride4x4Pixels +
+           (ySuperTile4x4Offset >> superTile8x8Shift) * stride8x8Pixels +
+           ((ySuperTile8x8Offset >> tileShift) << superTile2x2Shift) +
+           (ySuperTile8x8Offset & tileMask) * tileSize +
+           (xSuperTile8x8Offset & tileMask) +
+           (xSuperTile8x8Offset >> tileShift) * tilePixels +
+           (x >> superTileShift) * superTilePixels +
+           (xSuperTileOffset >> superTile2x2Shift) * superTile2x2Pixels +
+           (xSuperTile2x2Offset >> superTile4x4Shift) * superTile4x4Pixels +
+           (xSuperTile4x4Offset >> superTile8x8Shift) * superTile8x8Pixels;
+}
+
+static void storeLinearBufferInLinearFormat_Streaming(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                                      const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    // Only the source rectangle is copied, the destination size is just an upper bound.
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        const uint32_t* srcRow = src + y * spitch;
+        uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
+
+        // Partial burst up to the first 64 byte aligned destination address.
+        uint32_t x = 0;
+        for (; x < sw && reinterpret_cast<uintptr_t>(dstRow + x) & 63; ++x)
+            dstRow[x] = srcRow[x];
+
+        for (; x + burstPixels <= sw; x += burstPixels) {
+            __builtin_prefetch(srcRow + x + 4 * burstPixels, 0, 0);
+            streamBurst(dstRow + x, srcRow + x, srcRow + x + 4, srcRow + x + 8, srcRow + x + 12);
+        }
+
+        for (; x < sw; ++x)
+            dstRow[x] = srcRow[x];
+    }
+
+    streamFence();
+}
+
+// A 4x4 tile is one 64 byte burst, written from four source rows at once.
+template<BufferModifier modifier>
+static void storeLinearBufferInTiledFormat_Streaming(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t, uint32_t dpitch,
+                                                     const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    auto tileOffset = [&](uint32_t x, uint32_t y) {
+        if constexpr (modifier == BufferModifier::VivanteSuperTiled)
+            return vivanteSuperTiledOffset(x, y, dw);
+        else
+            return vivanteTiledOffset(x, y, dpitch);
+    };
+
+    // Bursts need tile aligned updates, unaligned rows / columns are stored pixel by pixel.
+    const uint32_t xBurstStart = std::min(sw, (tileSize - (dx & tileMask)) & tileMask);
+    const uint32_t yBurstStart = std::min(sh, (tileSize - (dy & tileMask)) & tileMask);
+    const uint32_t xBurstEnd = xBurstStart + ((sw - xBurstStart) & ~tileMask);
+    const uint32_t yBurstEnd = yBurstStart + ((sh - yBurstStart) & ~tileMask);
+
+    auto storePixels = [&](uint32_t y, uint32_t xStart, uint32_t xEnd) {
+        const uint32_t* srcRow = src + y * spitch;
+        for (uint32_t x = xStart; x < xEnd; ++x)
+            dst[tileOffset(dx + x, dy + y)] = srcRow[x];
+    };
+
+    for (uint32_t y = 0; y < yBurstStart; ++y)
+        storePixels(y, 0, sw);
+
+    for (uint32_t y = yBurstStart; y < yBurstEnd; y += tileSize) {
+        const uint32_t* srcRow0 = src + y * spitch;
+        const uint32_t* srcRow1 = srcRow0 + spitch;
+        const uint32_t* srcRow2 = srcRow1 + spitch;
+        const uint32_t* srcRow3 = srcRow2 + spitch;
+
+        for (uint32_t x = xBurstStart; x < xBurstEnd; x += tileSize)
+            streamBurst(dst + tileOffset(dx + x, dy + y), srcRow0 + x, srcRow1 + x, srcRow2 + x, srcRow3 + x);
+
+        for (uint32_t row = 0; row < tileSize; ++row) {
+            storePixels(y + row, 0, xBurstStart);
+            storePixels(y + row, xBurstEnd, sw);
+        }
+    }
+
+    for (uint32_t y = yBurstEnd; y < sh; ++y)
+        storePixels(y, 0, sw);
+
+    streamFence();
+}
+
+// RGB565 (--tile-format rgb565)
+
+// Truncates the RGBA bytes to DRM_FORMAT_RGB565, red in the 5 most significant bits.
+static inline uint16_t packRGB565(uint32_t pixel)
+{
+    return ((pixel & 0xf8) << 8) | ((pixel >> 5) & 0x7e0) | ((pixel >> 19) & 0x1f);
+}
+
+#if HAS_NEON
+// 8 pixels, de-interleaved by vld4_u8: shift-right-insert green and blue below the red bits.
+static inline uint16x8_t packRGB565_NEON(uint8x8x4_t rgba)
+{
+    uint16x8_t result = vshll_n_u8(rgba.val[0], 8);
+    result = vsriq_n_u16(result, vshll_n_u8(rgba.val[1], 8), 5);
+    return vsriq_n_u16(result, vshll_n_u8(rgba.val[2], 8), 11);
+}
+#endif
+
+#if HAS_SSE2
+static inline __m128i packRGB565x4_SSE2(__m128i pixels)
+{
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xf8)), 8);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 5), _mm_set1_epi32(0x7e0));
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1f));
+    // Sign extended, so that _mm_packs_epi32 does not saturate the values above 0x7fff.
+    return _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(_mm_or_si128(r, g), b), 16), 16);
+}
+
+// 8 pixels.
+static inline __m128i packRGB565_SSE2(const uint32_t* src)
+{
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4));
+    return _mm_packs_epi32(packRGB565x4_SSE2(low), packRGB565x4_SSE2(high));
+}
+#endif
+
+template<bool useNEON>
+static inline void packRowRGB565(uint16_t* dst, const uint32_t* src, uint32_t count)
+{
+    uint32_t x = 0;
+#if HAS_NEON
+    if constexpr (useNEON) {
+        for (; x + 8 <= count; x += 8) {
+            __builtin_prefetch(src + x + 32, 0, 1);
+            vst1q_u16(dst + x, packRGB565_NEON(vld4_u8(reinterpret_cast<const uint8_t*>(src + x))));
+        }
+    }
+#elif HAS_SSE2
+    for (; x + 8 <= count; x += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packRGB565_SSE2(src + x));
+#endif
+
+    for (; x < count; ++x)
+        dst[x] = packRGB565(src[x]);
+}
+
+using PackFunction = void (*)(uint16_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                              const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch);
+
+template<bool useNEON>
+static void packLinearBufferInLinearFormat(uint16_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                           const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    // Only the source rectangle is packed, the destination size is just an upper bound.
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y)
+        packRowRGB565<useNEON>(dst + (y + dy) * dpitch + dx, src + y * spitch, sw);
+}
+
+// The Vivante layouts are the same in pixels at 16 bpp: every row of a 4x4 tile is 4 contiguous pixels.
+// Rows are packed into a staging row first, then scattered as 8 byte tile rows.
+template<BufferModifier modifier, bool useNEON>
+static void packLinearBufferInTiledFormat(uint16_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t, uint32_t dpitch,
+                                          const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    auto tileOffset = [&](uint32_t x, uint32_t y) {
+        if constexpr (modifier == BufferModifier::VivanteSuperTiled)
+            return vivanteSuperTiledOffset(x, y, dw);
+        else
+            return vivanteTiledOffset(x, y, dpitch);
+    };
+
+    static std::vector<uint16_t> packedRow;
+    if (packedRow.size() < sw)
+        packedRow.resize(sw);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        packRowRGB565<useNEON>(packedRow.data(), src + y * spitch, sw);
+
+        uint32_t x = 0;
+        for (; x < sw && ((dx + x) & tileMask); ++x)
+            dst[tileOffset(dx + x, dy + y)] = packedRow[x];
+
+        for (; x + tileSize <= sw; x += tileSize)
+            memcpy(dst + tileOffset(dx + x, dy + y), packedRow.data() + x, tileSize * sizeof(uint16_t));
+
+        for (; x < sw; ++x)
+            dst[tileOffset(dx + x, dy + y)] = packedRow[x];
+    }
+}
+
+// Composition (--software)
+
+// The tiles hold RGBA bytes (as uploaded with GL_RGBA), the window buffers are ARGB8888 (BGRA bytes).
+static inline uint32_t swizzleRGBAToBGRA(uint32_t pixel)
+{
+    return (pixel & 0xff00ff00) | ((pixel & 0xff) << 16) | ((pixel >> 16) & 0xff);
+}
+
+// Exact x / 255 for x in [0, 255 * 255].
+static inline uint32_t divideBy255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Premultiplied source over destination, as glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+static inline uint32_t blendPixel(uint32_t src, uint32_t dst)
+{
+    const uint32_t inverseAlpha = 255 - (src >> 24);
+    if (!inverseAlpha)
+        return src;
+
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        const uint32_t channel = ((src >> shift) & 0xff) + divideBy255(((dst >> shift) & 0xff) * inverseAlpha);
+        result |= std::min(channel, 255u) << shift;
+    }
+    return result;
+}
+
+#if HAS_NEON
+// Rounded (channel * alpha) / 255 for 16 channels.
+static inline uint8x16_t multiplyByAlpha_NEON(uint8x16_t channel, uint8x16_t alpha)
+{
+    uint16x8_t low = vmull_u8(vget_low_u8(channel), vget_low_u8(alpha));
+    uint16x8_t high = vmull_u8(vget_high_u8(channel), vget_high_u8(alpha));
+    low = vrsraq_n_u16(low, low, 8);
+    high = vrsraq_n_u16(high, high, 8);
+    return vcombine_u8(vrshrn_n_u16(low, 8), vrshrn_n_u16(high, 8));
+}
+
+template<bool blend>
+inline void compositeLinearBufferInLinearFormat_NEON(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                                     const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    constexpr uint32_t numberOfPixelsPerBatch = 16;
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        const uint32_t* srcRow = src + y * spitch;
+        uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
+
+        uint32_t x = 0;
+        for (; x + numberOfPixelsPerBatch <= sw; x += numberOfPixelsPerBatch) {
+            __builtin_prefetch(srcRow + x + 2 * numberOfPixelsPerBatch, 0, 1);
+            __builtin_prefetch(dstRow + x + 2 * numberOfPixelsPerBatch, 1, 1);
+
+            // De-interleave into R, G, B, A planes, store re-interleaved as B, G, R, A.
+            uint8x16x4_t rgba = vld4q_u8(reinterpret_cast<const uint8_t*>(srcRow + x));
+            uint8x16x4_t bgra = { { rgba.val[2], rgba.val[1], rgba.val[0], rgba.val[3] } };
+
+            if constexpr (blend) {
+                uint8x16x4_t destination = vld4q_u8(reinterpret_cast<const uint8_t*>(dstRow + x));
+                uint8x16_t inverseAlpha = vmvnq_u8(rgba.val[3]);
+                for (uint32_t channel = 0; channel < 4; ++channel)
+                    bgra.val[channel] = vqaddq_u8(bgra.val[channel], multiplyByAlpha_NEON(destination.val[channel], inverseAlpha));
+            }
+
+            vst4q_u8(reinterpret_cast<uint8_t*>(dstRow + x), bgra);
+        }
+
+        // Handle remaining pixels
+        for (; x < sw; ++x) {
+            const uint32_t pixel = swizzleRGBAToBGRA(srcRow[x]);
+            dstRow[x] = blend ? blendPixel(pixel, dstRow[x]) : pixel;
+        }
+    }
+}
+#endif
+
+#if HAS_SSE2
+// swizzleRGBAToBGRA() for 4 pixels.
+static inline __m128i swizzleRGBAToBGRA_SSE2(__m128i pixels)
+{
+    return _mm_or_si128(_mm_and_si128(pixels, _mm_set1_epi32(0xff00ff00)),
+                        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xff)), 16), _mm_and_si128(_mm_srli_epi32(pixels, 16), _mm_set1_epi32(0xff))));
+}
+
+// Rounded (channel * alpha) / 255 for 16 channels, in 16 bit lanes as divideBy255().
+static inline __m128i multiplyByAlpha_SSE2(__m128i channels, __m128i alphas)
+{
+    auto multiply = [](__m128i channels, __m128i alphas) {
+        __m128i product = _mm_add_epi16(_mm_mullo_epi16(channels, alphas), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+    };
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = multiply(_mm_unpacklo_epi8(channels, zero), _mm_unpacklo_epi8(alphas, zero));
+    const __m128i high = multiply(_mm_unpackhi_epi8(channels, zero), _mm_unpackhi_epi8(alphas, zero));
+    return _mm_packus_epi16(low, high);
+}
+
+// The alpha byte of every pixel, copied into all four bytes.
+static inline __m128i replicateAlpha_SSE2(__m128i pixels)
+{
+    const __m128i alpha = _mm_srli_epi32(pixels, 24);
+    return _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(alpha, 8)), _mm_or_si128(_mm_slli_epi32(alpha, 16), _mm_slli_epi32(alpha, 24)));
+}
+
+template<bool blend>
+inline void compositeLinearBufferInLinearFormat_SSE2(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                                     const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    constexpr uint32_t numberOfPixelsPerBatch = 4;
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        const uint32_t* srcRow = src + y * spitch;
+        uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
+
+        uint32_t x = 0;
+        for (; x + numberOfPixelsPerBatch <= sw; x += numberOfPixelsPerBatch) {
+            __builtin_prefetch(srcRow + x + 8 * numberOfPixelsPerBatch, 0, 1);
+            __builtin_prefetch(dstRow + x + 8 * numberOfPixelsPerBatch, 1, 1);
+
+            const __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + x));
+            __m128i bgra = swizzleRGBAToBGRA_SSE2(rgba);
+
+            if constexpr (blend) {
+                const __m128i destination = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dstRow + x));
+                const __m128i inverseAlpha = replicateAlpha_SSE2(_mm_xor_si128(rgba, _mm_set1_epi32(-1)));
+                bgra = _mm_adds_epu8(bgra, multiplyByAlpha_SSE2(destination, inverseAlpha));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow + x), bgra);
+        }
+
+        // Handle remaining pixels
+        for (; x < sw; ++x) {
+            const uint32_t pixel = swizzleRGBAToBGRA(srcRow[x]);
+            dstRow[x] = blend ? blendPixel(pixel, dstRow[x]) : pixel;
+        }
+    }
+}
+#endif
+
+template<bool blend>
+inline void compositeLinearBufferInLinearFormat_Generic(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                                        const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        const uint32_t* srcRow = src + y * spitch;
+        uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
+
+        for (uint32_t x = 0; x < sw; ++x) {
+            const uint32_t pixel = swizzleRGBAToBGRA(srcRow[x]);
+            dstRow[x] = blend ? blendPixel(pixel, dstRow[x]) : pixel;
+        }
+    }
+}
+
+// BGRA content (--content-format bgra)
+
+// Swaps red and blue (the swap is its own inverse), premultiplies straight alpha with --premultiply.
+template<bool premultiply>
+static inline uint32_t convertBGRAPixel(uint32_t pixel)
+{
+    pixel = swizzleRGBAToBGRA(pixel);
+    if constexpr (premultiply) {
+        const uint32_t alpha = pixel >> 24;
+        uint32_t result = pixel & 0xff000000;
+        for (uint32_t shift = 0; shift < 24; shift += 8)
+            result |= divideBy255(((pixel >> shift) & 0xff) * alpha) << shift;
+        return result;
+    }
+    return pixel;
+}
+
+// 4 pixels, in registers. In place conversion (dst == src) is fine.
+template<bool premultiply, bool useNEON>
+static inline void convertBGRAPixels(uint32_t* dst, const uint32_t* src)
 {
 #if HAS_NEON
+    if constexpr (useNEON) {
+        const uint32x4_t pixels = vld1q_u32(src);
+        uint32x4_t rgba = vorrq_u32(vandq_u32(pixels, vdupq_n_u32(0xff00ff00)),
+                                    vorrq_u32(vandq_u32(vshlq_n_u32(pixels, 16), vdupq_n_u32(0x00ff0000)), vandq_u32(vshrq_n_u32(pixels, 16), vdupq_n_u32(0xff))));
+        if constexpr (premultiply) {
+            // Alpha replicated into the color bytes, 255 in the alpha byte keeps it unchanged.
+            const uint32x4_t alpha = vorrq_u32(vmulq_n_u32(vshrq_n_u32(rgba, 24), 0x010101), vdupq_n_u32(0xff000000));
+            rgba = vreinterpretq_u32_u8(multiplyByAlpha_NEON(vreinterpretq_u8_u32(rgba), vreinterpretq_u8_u32(alpha)));
+        }
+        vst1q_u32(dst, rgba);
+        return;
+    }
+#elif HAS_SSE2
+    __m128i rgba = swizzleRGBAToBGRA_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    if constexpr (premultiply) {
+        // 255 in the alpha byte keeps it unchanged.
+        const __m128i alpha = _mm_or_si128(replicateAlpha_SSE2(rgba), _mm_set1_epi32(0xff000000));
+        rgba = multiplyByAlpha_SSE2(rgba, alpha);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), rgba);
+    return;
+#endif
+
+    for (uint32_t i = 0; i < 4; ++i)
+        dst[i] = convertBGRAPixel<premultiply>(src[i]);
+}
+
+template<bool premultiply, bool useNEON, bool streaming>
+static void convertLinearBufferInLinearFormat(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                              const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    // Only the source rectangle is converted, the destination size is just an upper bound.
+    assert(dx + sw <= dw && dy + sh <= dh);
+
+    for (uint32_t y = 0; y < sh; ++y) {
+        const uint32_t* srcRow = src + y * spitch;
+        uint32_t* dstRow = dst + (y + dy) * dpitch + dx;
+
+        uint32_t x = 0;
+        if constexpr (streaming) {
+            for (; x < sw && reinterpret_cast<uintptr_t>(dstRow + x) & 63; ++x)
+                dstRow[x] = convertBGRAPixel<premultiply>(srcRow[x]);
+
+            // Converted in registers / L1, every burst is still streamed out at once.
+            alignas(64) uint32_t burst[burstPixels];
+            for (; x + burstPixels <= sw; x += burstPixels) {
+                __builtin_prefetch(srcRow + x + 4 * burstPixels, 0, 0);
+                for (uint32_t i = 0; i < burstPixels; i += 4)
+                    convertBGRAPixels<premultiply, useNEON>(burst + i, srcRow + x + i);
+                streamBurst(dstRow + x, burst, burst + 4, burst + 8, burst + 12);
+            }
+        } else {
+            for (; x + 4 <= sw; x += 4)
+                convertBGRAPixels<premultiply, useNEON>(dstRow + x, srcRow + x);
+        }
+
+        for (; x < sw; ++x)
+            dstRow[x] = convertBGRAPixel<premultiply>(srcRow[x]);
+    }
+
+    if constexpr (streaming)
+        streamFence();
+}
+
+// A 4x4 tile is converted from four source rows at once, like storeLinearBufferInTiledFormat_Streaming().
+template<BufferModifier modifier, bool premultiply, bool useNEON, bool streaming>
+static void convertLinearBufferInTiledFormat(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t, uint32_t dpitch,
+                                             const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    auto tileOffset = [&](uint32_t x, uint32_t y) {
+        if constexpr (modifier == BufferModifier::VivanteSuperTiled)
+            return vivanteSuperTiledOffset(x, y, dw);
+        else
+            return vivanteTiledOffset(x, y, dpitch);
+    };
+
+    const uint32_t xTileStart = std::min(sw, (tileSize - (dx & tileMask)) & tileMask);
+    const uint32_t yTileStart = std::min(sh, (tileSize - (dy & tileMask)) & tileMask);
+    const uint32_t xTileEnd = xTileStart + ((sw - xTileStart) & ~tileMask);
+    const uint32_t yTileEnd = yTileStart + ((sh - yTileStart) & ~tileMask);
+
+    auto convertPixels = [&](uint32_t y, uint32_t xStart, uint32_t xEnd) {
+        const uint32_t* srcRow = src + y * spitch;
+        for (uint32_t x = xStart; x < xEnd; ++x)
+            dst[tileOffset(dx + x, dy + y)] = convertBGRAPixel<premultiply>(srcRow[x]);
+    };
+
+    for (uint32_t y = 0; y < yTileStart; ++y)
+        convertPixels(y, 0, sw);
+
+    for (uint32_t y = yTileStart; y < yTileEnd; y += tileSize) {
+        const uint32_t* srcRows = src + y * spitch;
+        for (uint32_t x = xTileStart; x < xTileEnd; x += tileSize) {
+            uint32_t* tile = dst + tileOffset(dx + x, dy + y);
+            if constexpr (streaming) {
+                alignas(64) uint32_t burst[burstPixels];
+                for (uint32_t row = 0; row < tileSize; ++row)
+                    convertBGRAPixels<premultiply, useNEON>(burst + row * tileSize, srcRows + row * spitch + x);
+                streamBurst(tile, burst, burst + 4, burst + 8, burst + 12);
+            } else {
+                for (uint32_t row = 0; row < tileSize; ++row)
+                    convertBGRAPixels<premultiply, useNEON>(tile + row * tileSize, srcRows + row * spitch + x);
+            }
+        }
+
+        for (uint32_t row = 0; row < tileSize; ++row) {
+            convertPixels(y + row, 0, xTileStart);
+            convertPixels(y + row, xTileEnd, sw);
+        }
+    }
+
+    for (uint32_t y = yTileEnd; y < sh; ++y)
+        convertPixels(y, 0, sw);
+
+    if constexpr (streaming)
+        streamFence();
+}
+
+// Kernel selection
+
+// The kernels are specialized per (--tile-buffer-modifier, --neon, --blend, --store-kernel) combination and selected once,
+// see Tile::selectKernels(), instead of consulting the command line for every update.
+using StoreFunction = void (*)(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                               const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch);
+
+template<BufferModifier modifier, bool useNEON>
+static void storeLinearBuffer(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                              const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+    if constexpr (modifier == BufferModifier::VivanteSuperTiled) {
+        assert(dw == alignUpper(dw, superTileSize));
+        assert(dh == alignUpper(dh, superTileSize));
+#if HAS_NEON
+        if constexpr (useNEON) {
+            storeLinearBufferInVivanteSuperTiledFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+            return;
+        }
+#endif
+        storeLinearBufferInVivanteSuperTiledFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+    } else if constexpr (modifier == BufferModifier::VivanteTiled) {
+#if HAS_NEON
+        if constexpr (useNEON) {
+            storeLinearBufferInVivanteTiledFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+            return;
+        }
+#endif
+        storeLinearBufferInVivanteTiledFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+    } else {
+        static_assert(modifier == BufferModifier::Linear);
+#if HAS_NEON
+        if constexpr (useNEON) {
+            storeLinearBufferInLinearFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+            return;
+        }
+#endif
+        storeLinearBufferInLinearFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+    }
+}
+
+template<bool blend, bool useNEON>
+static void compositeLinearBuffer(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch,
+                                  const uint32_t* src, uint32_t sw, uint32_t sh, uint32_t spitch)
+{
+#if HAS_NEON
+    if constexpr (useNEON) {
+        compositeLinearBufferInLinearFormat_NEON<blend>(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+        return;
+    }
+#elif HAS_SSE2
+    compositeLinearBufferInLinearFormat_SSE2<blend>(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+    return;
+#endif
+    compositeLinearBufferInLinearFormat_Generic<blend>(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+}
+
+struct TileKernels {
+    StoreFunction storeTiled { nullptr }; // linear source into the --tile-buffer-modifier layout of a mapped dma-buf
+    StoreFunction storeMapped { nullptr }; // linear, into gbm / PBO mappings
+    StoreFunction storeLinear { nullptr }; // linear, into memory tiles
+    StoreFunction composite { nullptr };
+    StoreFunction compositeOpaque { nullptr }; // copy, for opaque tiles
+    PackFunction packTiled { nullptr }; // --tile-format rgb565: storeTiled / storeMapped counterparts
+    PackFunction packMapped { nullptr };
+    StoreFunction convert { nullptr }; // --content-format bgra: BGRA to RGBA, linear into a staging buffer
+    bool fusedConversion { false }; // the store kernels convert the BGRA content themselves
+};
+
+static TileKernels s_kernels;
+
+template<bool useNEON>
+static TileKernels tileKernels(BufferModifier tileBufferModifier, bool blend, StoreKernel storeKernel)
+{
+    // The dma-buf and PBO mappings are write-combined, memory tiles are ordinary cached memory.
+    const bool streamIntoMappings = storeKernel != StoreKernel::Cached;
+    const bool streamIntoMemory = storeKernel == StoreKernel::Streaming;
+
+    TileKernels kernels;
+    switch (tileBufferModifier) {
+    case BufferModifier::VivanteTiled:
+        kernels.storeTiled = streamIntoMappings ? &storeLinearBufferInTiledFormat_Streaming<BufferModifier::VivanteTiled> : &storeLinearBuffer<BufferModifier::VivanteTiled, useNEON>;
+        kernels.packTiled = &packLinearBufferInTiledFormat<BufferModifier::VivanteTiled, useNEON>;
+        break;
+    case BufferModifier::VivanteSuperTiled:
+        kernels.storeTiled = streamIntoMappings ? &storeLinearBufferInTiledFormat_Streaming<BufferModifier::VivanteSuperTiled> : &storeLinearBuffer<BufferModifier::VivanteSuperTiled, useNEON>;
+        kernels.packTiled = &packLinearBufferInTiledFormat<BufferModifier::VivanteSuperTiled, useNEON>;
+        break;
+    case BufferModifier::Linear:
+        kernels.storeTiled = streamIntoMappings ? &storeLinearBufferInLinearFormat_Streaming : &storeLinearBuffer<BufferModifier::Linear, useNEON>;
+        kernels.packTiled = &packLinearBufferInLinearFormat<useNEON>;
+        break;
+    case BufferModifier::Auto:
+        // --tile-buffer-modifier does not support 'auto'.
+        break;
+    }
+
+    kernels.storeMapped = streamIntoMappings ? &storeLinearBufferInLinearFormat_Streaming : &storeLinearBuffer<BufferModifier::Linear, useNEON>;
+    kernels.packMapped = &packLinearBufferInLinearFormat<useNEON>;
+    kernels.storeLinear = streamIntoMemory ? &storeLinearBufferInLinearFormat_Streaming : &storeLinearBuffer<BufferModifier::Linear, useNEON>;
+    kernels.composite = blend ? &compositeLinearBuffer<true, useNEON> : &compositeLinearBuffer<false, useNEON>;
+    kernels.compositeOpaque = &compositeLinearBuffer<false, useNEON>;
+    return kernels;
+}
+
+// --content-format bgra: the conversion kernel for the gl uploads and --content-conversion separate, plus (fused)
+// converting counterparts of the store kernels into mappings and memory tiles.
+template<bool premultiply, bool useNEON>
+static void selectConversionKernels(TileKernels& kernels, BufferModifier tileBufferModifier, StoreKernel storeKernel, bool fused)
+{
+    kernels.convert = &convertLinearBufferInLinearFormat<premultiply, useNEON, false>;
+    kernels.fusedConversion = fused;
+    if (!fused)
+        return;
+
+    const bool streamIntoMappings = storeKernel != StoreKernel::Cached;
+    const bool streamIntoMemory = storeKernel == StoreKernel::Streaming;
+
+    switch (tileBufferModifier) {
+    case BufferModifier::VivanteTiled:
+        kernels.storeTiled = streamIntoMappings ? &convertLinearBufferInTiledFormat<BufferModifier::VivanteTiled, premultiply, useNEON, true> : &convertLinearBufferInTiledFormat<BufferModifier::VivanteTiled, premultiply, useNEON, false>;
+        break;
+    case BufferModifier::VivanteSuperTiled:
+        kernels.storeTiled = streamIntoMappings ? &convertLinearBufferInTiledFormat<BufferModifier::VivanteSuperTiled, premultiply, useNEON, true> : &convertLinearBufferInTiledFormat<BufferModifier::VivanteSuperTiled, premultiply, useNEON, false>;
+        break;
+    case BufferModifier::Linear:
+        kernels.storeTiled = streamIntoMappings ? &convertLinearBufferInLinearFormat<premultiply, useNEON, true> : &convertLinearBufferInLinearFormat<premultiply, useNEON, false>;
+        break;
+    case BufferModifier::Auto:
+        break;
+    }
+
+    kernels.storeMapped = streamIntoMappings ? &convertLinearBufferInLinearFormat<premultiply, useNEON, true> : &convertLinearBufferInLinearFormat<premultiply, useNEON, false>;
+    kernels.storeLinear = streamIntoMemory ? &convertLinearBufferInLinearFormat<premultiply, useNEON, true> : &convertLinearBufferInLinearFormat<premultiply, useNEON, false>;
+}
+
+void Tile::selectKernels()
+{
     auto& args = Application::commandLineArguments();
+
+    const bool fusedConversion = args.contentConversion == ContentConversion::Fused;
+
+#if HAS_NEON
     if (args.neon) {
-        storeLinearBufferInLinearFormat_NEON(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+        s_kernels = tileKernels<true>(args.tileBufferModifier, args.blend, args.storeKernel);
+        if (args.contentFormat == ContentFormat::BGRA) {
+            if (args.premultiply)
+                selectConversionKernels<true, true>(s_kernels, args.tileBufferModifier, args.storeKernel, fusedConversion);
+            else
+                selectConversionKernels<false, true>(s_kernels, args.tileBufferModifier, args.storeKernel, fusedConversion);
+        }
         return;
     }
 #endif
 
-    storeLinearBufferInLinearFormat_Generic(dst, dx, dy, dw, dh, dpitch, src, sw, sh, spitch);
+    s_kernels = tileKernels<false>(args.tileBufferModifier, args.blend, args.storeKernel);
+    if (args.contentFormat == ContentFormat::BGRA) {
+        if (args.premultiply)
+            selectConversionKernels<true, false>(s_kernels, args.tileBufferModifier, args.storeKernel, fusedConversion);
+        else
+            selectConversionKernels<false, false>(s_kernels, args.tileBufferModifier, args.storeKernel, fusedConversion);
+    }
+}
+
+uint8_t* Tile::convertContent(const uint8_t* data, uint32_t width, uint32_t height)
+{
+    assert(s_kernels.convert);
+    static std::vector<uint32_t> convertedPixels;
+    if (convertedPixels.size() < size_t(width) * height)
+        convertedPixels.resize(size_t(width) * height);
+
+    {
+        PerfCounterScope scope(PerfCounters::Scope::ContentConversion);
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::ContentConversion, uint64_t(width) * height * sizeof(uint32_t) * 2);
+        s_kernels.convert(convertedPixels.data(), 0, 0, width, height, width, reinterpret_cast<const uint32_t*>(data), width, height, width);
+    }
+    return reinterpret_cast<uint8_t*>(convertedPixels.data());
+}
+
+const TilePixelFormat& Tile::pixelFormat()
+{
+    static const TilePixelFormat abgr8888 = { "ABGR8888", DRM_FORMAT_ABGR8888, 4, GL_RGBA, GL_UNSIGNED_BYTE, true };
+    static const TilePixelFormat xbgr8888 = { "XBGR8888", DRM_FORMAT_XBGR8888, 4, GL_RGBA, GL_UNSIGNED_BYTE, false };
+    static const TilePixelFormat rgb565 = { "RGB565", DRM_FORMAT_RGB565, 2, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, false };
+
+    switch (Application::commandLineArguments().tileFormat) {
+    case TileFormat::XBGR8888:
+        return xbgr8888;
+    case TileFormat::RGB565:
+        return rgb565;
+    case TileFormat::ABGR8888:
+        break;
+    }
+
+    return abgr8888;
+}
+
+// PSNR of the RGB channels after the RGB565 round trip, expanded by bit replication as the GPU samples them.
+static double rgb565PSNR(const std::vector<uint32_t>& pixels)
+{
+    double squaredError = 0;
+    for (auto pixel : pixels) {
+        const uint16_t packed = packRGB565(pixel);
+        const uint32_t r = packed >> 11;
+        const uint32_t g = (packed >> 5) & 0x3f;
+        const uint32_t b = packed & 0x1f;
+        const uint32_t expanded[3] = { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+        for (uint32_t channel = 0; channel < 3; ++channel) {
+            const double error = double((pixel >> (channel * 8)) & 0xff) - double(expanded[channel]);
+            squaredError += error * error;
+        }
+    }
+
+    const double meanSquaredError = squaredError / double(pixels.size() * 3);
+    return meanSquaredError > 0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+}
+
+void Tile::reportPixelFormat()
+{
+    auto& format = pixelFormat();
+    if (format.fourcc == DRM_FORMAT_ABGR8888)
+        return;
+
+    if (format.fourcc == DRM_FORMAT_XBGR8888) {
+        Logger::info("Tile format: XBGR8888, 4 bytes per pixel, lossless color, alpha dropped: every tile is composited as opaque\n");
+        return;
+    }
+
+    // The checkerboard only uses the pattern colors, a gray ramp stands for gradients and photos.
+    std::vector<uint32_t> patternPixels;
+    for (auto& color : patternColors())
+        patternPixels.push_back(color[0] | color[1] << 8 | color[2] << 16 | uint32_t(color[3]) << 24);
+
+    std::vector<uint32_t> rampPixels;
+    for (uint32_t level = 0; level < 256; ++level)
+        rampPixels.push_back(level | level << 8 | level << 16 | 0xff000000);
+
+    auto formatPSNR = [](double psnr, char* buffer, size_t size) {
+        if (std::isinf(psnr))
+            snprintf(buffer, size, "lossless");
+        else
+            snprintf(buffer, size, "%.1f dB", psnr);
+        return buffer;
+    };
+
+    char patternPSNR[32];
+    char rampPSNR[32];
+    Logger::info("Tile format: %s, %u bytes per pixel (%u%% of the ABGR8888 store / upload / sampling traffic), PSNR %s for the pattern colors, %s for a 256 level gray ramp\n",
+                 format.name, format.bytesPerPixel, format.bytesPerPixel * 100 / 4, formatPSNR(rgb565PSNR(patternPixels), patternPSNR, sizeof(patternPSNR)),
+                 formatPSNR(rgb565PSNR(rampPixels), rampPSNR, sizeof(rampPSNR)));
+}
+
+Tile::UpdateFunction Tile::updateFunction(TileUpdateMethod method)
+{
+    switch (method) {
+    case TileUpdateMethod::GLTexSubImage2D:
+        return &Tile::updateContentGL;
+    case TileUpdateMethod::MemoryMappingMMAP:
+        return &Tile::updateContentMMAP;
+    case TileUpdateMethod::MemoryMappingGBM:
+        return &Tile::updateContentGBM;
+    case TileUpdateMethod::GPU:
+    case TileUpdateMethod::PixelBufferObject:
+        // See paintContent() and streamContent().
+        break;
+    }
+
+    return nullptr;
 }
 
 void Tile::updateContentGL(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
 {
+    auto& format = pixelFormat();
+
+    // There is no store kernel to fuse the BGRA conversion with, the driver copies from client memory.
+    if (s_kernels.fusedConversion)
+        data = convertContent(data, width, height);
+
+    // RGB565 is packed on the CPU, the driver would otherwise convert on upload.
+    const void* pixels = data;
+    if (format.bytesPerPixel == 2) {
+        static std::vector<uint16_t> packedPixels;
+        if (packedPixels.size() < size_t(width) * height)
+            packedPixels.resize(size_t(width) * height);
+
+        PerfCounterScope scope(PerfCounters::Scope::StoreLinear);
+        s_kernels.packMapped(packedPixels.data(), 0, 0, width, height, width, reinterpret_cast<uint32_t*>(data), width, height, width);
+        pixels = packedPixels.data();
+    }
+
+    BandwidthScope bandwidthScope(BandwidthCounters::Stage::TextureUpload, uint64_t(width) * height * format.bytesPerPixel * 2);
     glBindTexture(GL_TEXTURE_2D, m_id);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, xOffset, yOffset, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, xOffset, yOffset, width, height, format.glFormat, format.glType, pixels);
 }
 
 void Tile::updateContentGBM(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
@@ -469,75 +1358,125 @@ void Tile::updateContentGBM(uint32_t xOffset, uint32_t yOffset, uint32_t width,
     void* mapData = nullptr;
     void* destAddress = gbm_bo_map(m_buffer->gbmBufferObject(), 0, 0, m_width, m_height, GBM_BO_TRANSFER_WRITE, &dstStride, &mapData);
 
+    auto& format = pixelFormat();
     const uint32_t srcPitch = width;
-    const uint32_t dstPitch = dstStride / sizeof(uint32_t);
-    storeLinearBufferInLinearFormat(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
+    const uint32_t dstPitch = dstStride / format.bytesPerPixel;
+    {
+        PerfCounterScope scope(PerfCounters::Scope::StoreLinear);
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::MappedStore, uint64_t(width) * height * (sizeof(uint32_t) + format.bytesPerPixel));
+        if (format.bytesPerPixel == 2)
+            s_kernels.packMapped(reinterpret_cast<uint16_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
+        else
+            s_kernels.storeMapped(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
+    }
 
     gbm_bo_unmap(m_buffer->gbmBufferObject(), mapData);
 }
 
 void Tile::updateContentMMAP(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
 {
+    auto& format = pixelFormat();
     const uint32_t srcPitch = width;
     const uint32_t dstStride = gbm_bo_get_stride(m_buffer->gbmBufferObject());
-    const uint32_t dstPitch = dstStride / sizeof(uint32_t);
-    assert(dstStride >= m_width);
+    const uint32_t dstPitch = dstStride / format.bytesPerPixel;
+    assert(dstStride >= m_width * format.bytesPerPixel);
 
     int dmaBufFD = m_buffer->dmabufFDForPlane(0);
 
-    static void* mmapAddress = nullptr;
-    if (!mmapAddress) {
+    // Every tile keeps its own mapping for its lifetime.
+    if (!m_mappedAddress) {
         assert(m_height == gbm_bo_get_height(m_buffer->gbmBufferObject()));
-        mmapAddress = mmap(nullptr, dstStride * m_height, PROT_WRITE, MAP_SHARED, dmaBufFD, 0);
-        assert(mmapAddress != MAP_FAILED);
+        m_mappedSize = size_t(dstStride) * m_height;
+        m_mappedAddress = mmap(nullptr, m_mappedSize, PROT_WRITE, MAP_SHARED, dmaBufFD, 0);
+        if (m_mappedAddress == MAP_FAILED) {
+            Logger::error("Failed to mmap() the tile dma-buf\n");
+            abort();
+        }
     }
-    void* destAddress = mmapAddress;
+    void* destAddress = m_mappedAddress;
 
+    // Does not block if the fences were already waited for, see exportWriteFence().
     const struct dma_buf_sync syncStart = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
     ioctl(dmaBufFD, DMA_BUF_IOCTL_SYNC, &syncStart);
 
-    auto& args = Application::commandLineArguments();
-    switch (args.tileBufferModifier) {
-    case BufferModifier::VivanteTiled:
-        storeLinearBufferInVivanteTiledFormat(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
-        break;
-    case BufferModifier::VivanteSuperTiled:
-        storeLinearBufferInVivanteSuperTiledFormat(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
-        break;
-    case BufferModifier::Linear:
-        storeLinearBufferInLinearFormat(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
-        break;
+    assert(s_kernels.storeTiled && "--tile-buffer-modifier does not support 'auto'");
+    {
+        PerfCounterScope scope(PerfCounters::Scope::StoreTiled);
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::MappedStore, uint64_t(width) * height * (sizeof(uint32_t) + format.bytesPerPixel));
+        if (format.bytesPerPixel == 2)
+            s_kernels.packTiled(reinterpret_cast<uint16_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
+        else
+            s_kernels.storeTiled(reinterpret_cast<uint32_t*>(destAddress), xOffset, yOffset, m_width, m_height, dstPitch, reinterpret_cast<uint32_t*>(data), width, height, srcPitch);
     }
 
     const struct dma_buf_sync syncEnd = { DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE };
     ioctl(dmaBufFD, DMA_BUF_IOCTL_SYNC, &syncEnd);
 }
 
-void Tile::updateContent(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
+int Tile::exportWriteFence() const
 {
-    auto& args = Application::commandLineArguments();
+    assert(m_buffer);
 
-    if (args.tileUpdateMethod == TileUpdateMethod::GLTexSubImage2D) {
-        updateContentGL(xOffset, yOffset, width, height, data);
-        return;
+    // DMA_BUF_SYNC_WRITE: a snapshot of all fences, readers included, a CPU write has to wait for.
+    struct dma_buf_export_sync_file exportSyncFile = { DMA_BUF_SYNC_WRITE, -1 };
+    if (ioctl(m_buffer->dmabufFDForPlane(0), DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &exportSyncFile) < 0)
+        return -1;
+
+    return exportSyncFile.fd;
+}
+
+void Tile::streamContent(PixelUnpackBufferRing& ring, uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
+{
+    auto& format = pixelFormat();
+    auto* destAddress = ring.begin(width * height * format.bytesPerPixel);
+    {
+        PerfCounterScope scope(PerfCounters::Scope::StoreLinear);
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::MappedStore, uint64_t(width) * height * (sizeof(uint32_t) + format.bytesPerPixel));
+        if (format.bytesPerPixel == 2)
+            s_kernels.packMapped(static_cast<uint16_t*>(destAddress), 0, 0, width, height, width, reinterpret_cast<uint32_t*>(data), width, height, width);
+        else
+            s_kernels.storeMapped(static_cast<uint32_t*>(destAddress), 0, 0, width, height, width, reinterpret_cast<uint32_t*>(data), width, height, width);
     }
+    ring.end(m_id, xOffset, yOffset, width, height, format.glFormat, format.glType);
 
-    assert(m_dmaBufBacked);
-    if (args.tileUpdateMethod == TileUpdateMethod::MemoryMappingMMAP) {
-        updateContentMMAP(xOffset, yOffset, width, height, data);
-        return;
+    if (auto* counters = BandwidthCounters::singleton())
+        counters->add(BandwidthCounters::Stage::PixelBufferUpload, uint64_t(width) * height * format.bytesPerPixel * 2);
+}
+
+void Tile::updateContentMemory(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
+{
+    {
+        PerfCounterScope scope(PerfCounters::Scope::StoreLinear);
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::MappedStore, uint64_t(width) * height * sizeof(uint32_t) * 2);
+        s_kernels.storeLinear(m_memory, xOffset, yOffset, m_width, m_height, m_width, reinterpret_cast<uint32_t*>(data), width, height, width);
     }
+}
 
-    assert(args.tileUpdateMethod == TileUpdateMethod::MemoryMappingGBM);
-    updateContentGBM(xOffset, yOffset, width, height, data);
+void Tile::compositeInMemory(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch) const
+{
+    assert(m_memory);
+    if (dx >= dw || dy >= dh)
+        return;
+
+    const uint32_t sw = std::min(m_width, dw - dx);
+    const uint32_t sh = std::min(m_height, dh - dy);
+    {
+        PerfCounterScope scope(PerfCounters::Scope::Composition);
+        const bool blend = Application::commandLineArguments().blend && !m_opaque;
+        BandwidthScope bandwidthScope(BandwidthCounters::Stage::SoftwareComposition, uint64_t(sw) * sh * sizeof(uint32_t) * (blend ? 3 : 2));
+        (m_opaque ? s_kernels.compositeOpaque : s_kernels.composite)(dst, dx, dy, dw, dh, dpitch, m_memory, sw, sh, m_width);
+    }
 }
 
-uint8_t* Tile::createRandomContent(uint32_t width, uint32_t height) const
+void Tile::updateContent(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data)
 {
-    auto& args = Application::commandLineArguments();
+    assert(m_updateFunction);
+    (this->*m_updateFunction)(xOffset, yOffset, width, height, data);
+}
 
-    using RGBAColor = std::tuple<uint8_t, uint8_t, uint8_t, uint8_t>;
-    static std::vector<RGBAColor> colors = {
+const std::array<std::array<uint8_t, 4>, Tile::patternColorCount>& Tile::patternColors()
+{
+    static const std::array<std::array<uint8_t, 4>, patternColorCount> colors = { {
         {255, 0, 0, 255},      // Red
         {0, 255, 0, 255},      // Green
         {0, 0, 255, 255},      // Blue
@@ -546,7 +1485,95 @@ uint8_t* Tile::createRandomContent(uint32_t width, uint32_t height) const
         {0, 255, 255, 255},    // Cyan
         {255, 0, 255, 255},    // Magenta
         {128, 0, 128, 255}     // Purple
-    };
+    } };
+
+    return colors;
+}
+
+// Alpha scan
+
+#if HAS_NEON
+static bool isOpaqueContent_NEON(const uint8_t* data, uint32_t pixelCount)
+{
+    uint8x16_t alpha = vdupq_n_u8(0xff);
+    uint32_t i = 0;
+    for (; i + 16 <= pixelCount; i += 16)
+        alpha = vandq_u8(alpha, vld4q_u8(data + i * 4).val[3]);
+
+    const uint64x2_t folded = vreinterpretq_u64_u8(alpha);
+    bool opaque = (vgetq_lane_u64(folded, 0) & vgetq_lane_u64(folded, 1)) == UINT64_MAX;
+    for (; i < pixelCount; ++i)
+        opaque &= data[i * 4 + 3] == 0xff;
+    return opaque;
+}
+#endif
+
+static bool isOpaqueContent_Generic(const uint8_t* data, uint32_t pixelCount)
+{
+    // Alpha is the most significant byte of the little endian RGBA pixels.
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(data);
+    uint32_t alpha = 0xff000000;
+    for (uint32_t i = 0; i < pixelCount; ++i)
+        alpha &= pixels[i];
+    return alpha == 0xff000000;
+}
+
+bool Tile::isOpaqueContent(const uint8_t* data, uint32_t width, uint32_t height)
+{
+    auto& args = Application::commandLineArguments();
+
+    // The checkerboard fills every pixel with a pattern color, the circle leaves the corners untouched.
+    // A --content-file can hold anything.
+    static const bool patternIsOpaque = std::all_of(patternColors().begin(), patternColors().end(), [](auto& color) { return color[3] == 0xff; });
+    if (!args.circle && args.contentFile.empty() && patternIsOpaque)
+        return true;
+
+#if HAS_NEON
+    if (args.neon)
+        return isOpaqueContent_NEON(data, width * height);
+#endif
+    return isOpaqueContent_Generic(data, width * height);
+}
+
+void Tile::didUpdateContent(const TileDamage& damage, bool damageIsOpaque)
+{
+    // A partial update keeps the opacity of the rest of the tile.
+    const bool coversTile = !damage.x && !damage.y && damage.width == m_width && damage.height == m_height;
+    m_opaque = !pixelFormat().hasAlpha || (damageIsOpaque && (coversTile || m_opaque));
+}
+
+void Tile::paintContent(const TilePainter& painter, uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height)
+{
+    auto& args = Application::commandLineArguments();
+
+    if (!m_frameBuffer) {
+        glGenFramebuffers(1, &m_frameBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_id, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            Logger::error("Tile FBO creation failed\n");
+            abort();
+        }
+    }
+
+    painter.paint(m_frameBuffer, xOffset, yOffset, width, height, args.cellSize * m_tileIndex, s_animationIndex);
+
+    if (auto* counters = BandwidthCounters::singleton())
+        counters->add(BandwidthCounters::Stage::GPUPaint, uint64_t(width) * height * pixelFormat().bytesPerPixel);
+
+    if (!args.noAnimate)
+        ++s_animationIndex;
+}
+
+uint8_t* Tile::createRandomContent(uint32_t width, uint32_t height) const
+{
+    PerfCounterScope scope(PerfCounters::Scope::ContentGeneration);
+    BandwidthScope bandwidthScope(BandwidthCounters::Stage::ContentGeneration, uint64_t(width) * height * sizeof(uint32_t));
+    auto& args = Application::commandLineArguments();
+
+    using RGBAColor = std::array<uint8_t, 4>;
+    auto& colors = patternColors();
 
     static uint8_t* rgbaBuffer = nullptr;
     if (!rgbaBuffer)
@@ -554,15 +1581,16 @@ uint8_t* Tile::createRandomContent(uint32_t width, uint32_t height) const
     else if (args.noAnimate)
         return rgbaBuffer;
 
-    static uint32_t s_animationIndex = 0;
     auto cellSize = args.cellSize * m_tileIndex;
 
+    // --content-format bgra: painted in the byte order of Cairo / Skia.
+    const bool bgra = args.contentFormat == ContentFormat::BGRA;
     auto fillPixelWithColor = [&](int x, int y, const RGBAColor& color) {
         int offset = (y * width + x) * 4;
-        rgbaBuffer[offset] = std::get<0>(color);
-        rgbaBuffer[offset + 1] = std::get<1>(color);
-        rgbaBuffer[offset + 2] = std::get<2>(color);
-        rgbaBuffer[offset + 3] = std::get<3>(color);
+        rgbaBuffer[offset] = color[bgra ? 2 : 0];
+        rgbaBuffer[offset + 1] = color[1];
+        rgbaBuffer[offset + 2] = color[bgra ? 0 : 2];
+        rgbaBuffer[offset + 3] = color[3];
     };
 
     auto fillPixelAutoColor = [&](int x, int y) {
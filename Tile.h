@@ -19,15 +19,40 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <GLES2/gl2.h>
 
+enum class TileUpdateMethod;
+
 class DMABuffer;
 class DRM;
 class EGL;
 class GBM;
+class PixelUnpackBufferRing;
+class TilePainter;
+
+// Area of a tile updated in a frame, in tile coordinates.
+struct TileDamage {
+    uint32_t x { 0 };
+    uint32_t y { 0 };
+    uint32_t width { 0 };
+    uint32_t height { 0 };
+    bool opaque { false }; // every pixel of the tile is opaque after the update
+};
+
+// --tile-format: DRM fourcc, GL upload format / type and size of the tile pixels.
+struct TilePixelFormat {
+    const char* name { nullptr };
+    uint32_t fourcc { 0 };
+    uint32_t bytesPerPixel { 0 };
+    GLenum glFormat { 0 };
+    GLenum glType { 0 };
+    bool hasAlpha { false };
+};
 
 class Tile {
 public:
@@ -35,29 +60,86 @@ public:
     ~Tile();
 
     static std::unique_ptr<Tile> createGLTile(uint32_t width, uint32_t height);
-    static std::unique_ptr<Tile> createDMABufTile(uint32_t width, uint32_t height, const DRM&, const GBM&, const EGL&);
+    // Allocates all buffer objects before importing them into EGL. Returns an empty vector on failure.
+    // Double buffered tiles get a second buffer, to paint into while the compositor reads the first one.
+    static std::vector<std::unique_ptr<Tile>> createDMABufTiles(uint32_t count, uint32_t width, uint32_t height, const DRM&, const GBM&, const EGL&, bool doubleBuffered = false);
+    static std::unique_ptr<Tile> createImportedDMABufTile(std::unique_ptr<DMABuffer>&&);
+    static std::unique_ptr<Tile> createMemoryTile(uint32_t width, uint32_t height);
+
+    // Selects the CPU store / composition kernels for the command line options, before any tile is updated.
+    static void selectKernels();
+
+    static const TilePixelFormat& pixelFormat();
+    // Memory traffic and quantization error of the --tile-format, compared to ABGR8888.
+    static void reportPixelFormat();
 
     GLuint id() const { return m_id; }
     uint32_t width() const { return m_width; }
     uint32_t height() const { return m_height; }
+    DMABuffer* buffer() const { return m_buffer.get(); }
+    DMABuffer* backBuffer() const { return m_backBuffer.get(); }
+    // Double buffered tiles: the following updates go to the other buffer.
+    void swapBuffers();
+    const uint32_t* memory() const { return m_memory; }
+
+    // Opaque tiles are composited without blending and are not cleared beneath. Tiles start translucent,
+    // as their initial content is undefined, unless the --tile-format has no alpha.
+    bool isOpaque() const { return m_opaque; }
+    void setOpaque(bool opaque) { m_opaque = opaque; }
+    void didUpdateContent(const TileDamage&, bool damageIsOpaque);
+
+    // Whether all pixels of RGBA content have alpha 255, without scanning it for the opaque checkerboard pattern.
+    static bool isOpaqueContent(const uint8_t* data, uint32_t width, uint32_t height);
+
+    // --software: copies (or blends, with --blend, unless the tile is opaque) the tile into a linear ARGB8888 buffer, clipped to the given size.
+    void compositeInMemory(uint32_t* dst, uint32_t dx, uint32_t dy, uint32_t dw, uint32_t dh, uint32_t dpitch) const;
+
+    // RGBA colors of the checkerboard pattern.
+    static constexpr uint32_t patternColorCount = 8;
+    static const std::array<std::array<uint8_t, 4>, patternColorCount>& patternColors();
 
     uint8_t* createRandomContent(uint32_t width, uint32_t height) const;
+    // --content-format bgra: converts the content to RGBA in a pass of its own, into a staging buffer.
+    static uint8_t* convertContent(const uint8_t* data, uint32_t width, uint32_t height);
     void updateContent(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
 
+    // --sync-file-fencing: sync file of the fences pending on the tile dma-buf (DMA_BUF_IOCTL_EXPORT_SYNC_FILE),
+    // it becomes readable once the tile can be written without blocking. Returns -1 if unsupported.
+    int exportWriteFence() const;
+
+    // --tile-update-method pbo: copies the content into the next pixel unpack buffer of the ring and uploads from there.
+    void streamContent(PixelUnpackBufferRing&, uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
+
+    // --tile-update-method gpu: renders the pattern into the tile texture (or dma-buf EGLImage) through an FBO.
+    void paintContent(const TilePainter&, uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height);
+
 private:
+    using UpdateFunction = void (Tile::*)(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
+    static UpdateFunction updateFunction(TileUpdateMethod);
+
     bool allocateGLTexture();
-    bool allocateDMABuf(const DRM&, const GBM&, const EGL&);
+    bool allocateMemory();
 
     void updateContentGL(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
     void updateContentGBM(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
     void updateContentMMAP(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
+    void updateContentMemory(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, uint8_t* data);
 
     uint32_t m_width { 0 };
     uint32_t m_height { 0 };
     uint32_t m_tileIndex { 0 };
 
     GLuint m_id { 0 };
+    GLuint m_frameBuffer { 0 };
 
+    UpdateFunction m_updateFunction { nullptr }; // selected at creation, see updateFunction()
     bool m_dmaBufBacked { false };
+    bool m_opaque { false };
     std::unique_ptr<DMABuffer> m_buffer;
+    std::unique_ptr<DMABuffer> m_backBuffer;
+    GLuint m_backFrameBuffer { 0 };
+    uint32_t* m_memory { nullptr };
+    void* m_mappedAddress { nullptr }; // --tile-update-method mmap
+    void* m_backMappedAddress { nullptr };
+    size_t m_mappedSize { 0 };
 };
@@ -0,0 +1,145 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "TilePainter.h"
+
+#include "Application.h"
+#include "EGL.h"
+#include "Logger.h"
+#include "ProgramCache.h"
+#include "Tile.h"
+
+TilePainter::~TilePainter()
+{
+    if (m_paletteTexture)
+        glDeleteTextures(1, &m_paletteTexture);
+
+    if (m_program)
+        glDeleteProgram(m_program);
+}
+
+std::unique_ptr<TilePainter> TilePainter::create(const EGL& egl)
+{
+    auto tilePainter = std::make_unique<TilePainter>();
+    if (!tilePainter->createProgram(egl))
+        return nullptr;
+    tilePainter->createPalette();
+    return tilePainter;
+}
+
+bool TilePainter::createProgram(const EGL& egl)
+{
+    const char* vertexShaderSource = "attribute vec2 position;\n"
+                                     "\n"
+                                     "void main() {\n"
+                                     "    gl_Position = vec4(position, 0.0, 1.0);\n"
+                                     "}\n";
+
+    // The FBO rows map 1:1 to the texture rows, gl_FragCoord needs no flip. Tile coordinates
+    // exceed the mediump range, so prefer highp.
+    const char* fragmentShaderSource = "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+                                       "precision highp float;\n"
+                                       "#else\n"
+                                       "precision mediump float;\n"
+                                       "#endif\n"
+                                       "uniform sampler2D paletteSampler;\n"
+                                       "uniform vec2 u_origin;\n"
+                                       "uniform vec2 u_size;\n"
+                                       "uniform float u_cellSize;\n"
+                                       "uniform float u_animationIndex;\n"
+                                       "uniform bool u_circle;\n"
+                                       "\n"
+                                       "void main() {\n"
+                                       "    vec2 position = floor(gl_FragCoord.xy) - u_origin;\n"
+                                       "    if (u_circle) {\n"
+                                       "        vec2 delta = position - floor(u_size * 0.5);\n"
+                                       "        float radius = floor(min(u_size.x, u_size.y) * 0.5);\n"
+                                       "        if (dot(delta, delta) > radius * radius)\n"
+                                       "            discard;\n"
+                                       "    }\n"
+                                       "    vec2 cell = floor(position / u_cellSize);\n"
+                                       "    float colorIndex = mod(cell.x + cell.y + u_animationIndex, 8.0);\n"
+                                       "    gl_FragColor = texture2D(paletteSampler, vec2((colorIndex + 0.5) / 8.0, 0.5));\n"
+                                       "}\n";
+
+    m_program = egl.programCache().createProgram("tile painting", vertexShaderSource, fragmentShaderSource);
+    if (!m_program) {
+        Logger::error("Failed to link the tile painting program\n");
+        return false;
+    }
+
+    m_positionLocation = glGetAttribLocation(m_program, "position");
+    m_paletteLocation = glGetUniformLocation(m_program, "paletteSampler");
+    m_originLocation = glGetUniformLocation(m_program, "u_origin");
+    m_sizeLocation = glGetUniformLocation(m_program, "u_size");
+    m_cellSizeLocation = glGetUniformLocation(m_program, "u_cellSize");
+    m_animationIndexLocation = glGetUniformLocation(m_program, "u_animationIndex");
+    m_circleLocation = glGetUniformLocation(m_program, "u_circle");
+    return true;
+}
+
+void TilePainter::createPalette()
+{
+    auto& colors = Tile::patternColors();
+    static_assert(Tile::patternColorCount == 8, "the fragment shader assumes 8 colors");
+
+    glGenTextures(1, &m_paletteTexture);
+    glBindTexture(GL_TEXTURE_2D, m_paletteTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, colors.size(), 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TilePainter::paint(GLuint frameBuffer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t cellSize, uint32_t animationIndex) const
+{
+    auto& args = Application::commandLineArguments();
+
+    static const GLfloat vertices[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f,
+    };
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glViewport(x, y, width, height);
+
+    glUseProgram(m_program);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_paletteTexture);
+    glUniform1i(m_paletteLocation, 0);
+
+    glUniform2f(m_originLocation, x, y);
+    glUniform2f(m_sizeLocation, width, height);
+    glUniform1f(m_cellSizeLocation, cellSize);
+    glUniform1f(m_animationIndexLocation, animationIndex % Tile::patternColorCount);
+    glUniform1i(m_circleLocation, args.circle);
+
+    glVertexAttribPointer(m_positionLocation, 2, GL_FLOAT, GL_FALSE, 0, vertices);
+    glEnableVertexAttribArray(m_positionLocation);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableVertexAttribArray(m_positionLocation);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,57 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <GLES2/gl2.h>
+
+class EGL;
+
+// Rasterizes the tile content (the same checkerboard / --circle pattern as the CPU
+// painting in Tile::createRandomContent()) with a fragment shader into a tile FBO,
+// for --tile-update-method gpu.
+class TilePainter {
+public:
+    TilePainter() = default;
+    ~TilePainter();
+
+    static std::unique_ptr<TilePainter> create(const EGL&);
+
+    // Paints a rectangle (in tile coordinates) of the framebuffer. As for CPU painting, the
+    // pattern starts at the rectangle origin. Leaves the framebuffer bound.
+    void paint(GLuint frameBuffer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t cellSize, uint32_t animationIndex) const;
+
+private:
+    bool createProgram(const EGL&);
+    void createPalette();
+
+    GLuint m_program { 0 };
+    GLuint m_paletteTexture { 0 };
+
+    GLint m_positionLocation { -1 };
+    GLint m_paletteLocation { -1 };
+    GLint m_originLocation { -1 };
+    GLint m_sizeLocation { -1 };
+    GLint m_cellSizeLocation { -1 };
+    GLint m_animationIndexLocation { -1 };
+    GLint m_circleLocation { -1 };
+};
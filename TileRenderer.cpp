@@ -20,32 +20,86 @@
 #include "TileRenderer.h"
 
 #include "Application.h"
+#include "BandwidthCounters.h"
+#include "ContentSource.h"
 #include "EGL.h"
 #include "GBM.h"
-#include "Tile.h"
-
+#include "GPUTimer.h"
+#include "IPC.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "PixelUnpackBufferRing.h"
+#include "ProgramCache.h"
+#include "TilePainter.h"
+#include "Utilities.h"
+#include "VideoPlayer.h"
+
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <unistd.h>
 
-TileRenderer::TileRenderer(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL& egl)
+TileRenderer::TileRenderer(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL* egl)
     : m_egl(egl)
     , m_numberOfTiles(numberOfTiles)
     , m_tileWidth(tileWidth)
     , m_tileHeight(tileHeight)
 {
+    auto& args = Application::commandLineArguments();
+    auto animation = args.compositorAnimation;
+    m_blend = args.blend || animation == CompositorAnimation::Fade || animation == CompositorAnimation::All;
+
+    Tile::selectKernels();
+    if (!m_egl)
+        return;
+
     createShaders();
+
+    // The uploads are tightly packed, RGB565 rows of an odd width are not 4 byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, Tile::pixelFormat().bytesPerPixel);
+
+    m_compositeTilesFunction = compositeTilesFunction(m_blend, args.fences);
+
+    m_syncFileFencing = args.syncFileFencing && args.tileUpdateMethod == TileUpdateMethod::MemoryMappingMMAP;
+
+    if (args.tileUpdateMethod == TileUpdateMethod::GPU) {
+        m_tilePainter = TilePainter::create(*m_egl);
+        if (!m_tilePainter) {
+            Logger::error("Failed to initialize GPU tile painting\n");
+            abort();
+        }
+    }
 }
 
 TileRenderer::~TileRenderer()
 {
-    for (auto fence : m_fences)
-        m_egl.destroyFence(fence);
+    if (m_painterChannel) {
+        IPC::Quit quit;
+        m_painterChannel->send(&quit, sizeof(quit));
+    }
+
+    m_tilePainter.reset();
+    m_pixelUnpackBuffers.reset();
+    m_videoPlayer.reset();
 
-    glDeleteProgram(m_program);
+    for (auto fence : m_fences) {
+        if (fence)
+            m_egl->destroyFence(fence);
+    }
+
+    if (m_syncFileEpollFD != -1)
+        close(m_syncFileEpollFD);
+
+    if (m_program)
+        glDeleteProgram(m_program);
     m_tiles.clear();
 }
 
-std::unique_ptr<TileRenderer> TileRenderer::create(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL& egl)
+std::unique_ptr<TileRenderer> TileRenderer::create(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL* egl)
 {
     return std::make_unique<TileRenderer>(numberOfTiles, tileWidth, tileHeight, egl);
 }
@@ -68,29 +122,148 @@ void TileRenderer::allocateGLTiles()
         m_fences.push_back(nullptr);
         m_tiles.push_back(Tile::createGLTile(m_tileWidth, m_tileHeight));
     }
+
+    m_damage.resize(m_numberOfTiles);
+    createPixelUnpackBuffers();
 }
 
 void TileRenderer::allocateDMABufTiles(const DRM& drm, const GBM& gbm)
+{
+    // --subsurfaces: the compositor reads the attached tile buffers until they are replaced.
+    m_tiles = Tile::createDMABufTiles(m_numberOfTiles, m_tileWidth, m_tileHeight, drm, gbm, *m_egl, Application::commandLineArguments().subsurfaces);
+    if (m_tiles.size() != m_numberOfTiles) {
+        Logger::error("Failed to allocate the dma-buf tiles\n");
+        abort();
+    }
+
+    m_fences.resize(m_numberOfTiles, nullptr);
+    m_damage.resize(m_numberOfTiles);
+    createPixelUnpackBuffers();
+}
+
+void TileRenderer::createPixelUnpackBuffers()
+{
+    auto& args = Application::commandLineArguments();
+    if (args.tileUpdateMethod != TileUpdateMethod::PixelBufferObject)
+        return;
+
+    // One slot per tile for every frame in flight, so that a slot is usually idle when it comes around
+    // again. The tiles may be larger than requested (super-tiled alignment), size the slots accordingly.
+    constexpr uint32_t framesInFlight = 3;
+    const uint32_t slotSize = m_tiles[0]->width() * m_tiles[0]->height() * 4;
+    m_pixelUnpackBuffers = PixelUnpackBufferRing::create(*m_egl, framesInFlight * m_numberOfTiles, slotSize);
+    if (!m_pixelUnpackBuffers) {
+        Logger::error("Failed to initialize the pixel unpack buffers\n");
+        abort();
+    }
+}
+
+void TileRenderer::allocateMemoryTiles()
 {
     for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
         m_fences.push_back(nullptr);
-        m_tiles.push_back(Tile::createDMABufTile(m_tileWidth, m_tileHeight, drm, gbm, m_egl));
+        m_tiles.push_back(Tile::createMemoryTile(m_tileWidth, m_tileHeight));
     }
+
+    m_damage.resize(m_numberOfTiles);
 }
 
-static GLuint loadShader(GLenum type, const char* shaderSource)
+bool TileRenderer::exportTiles(IPC::Channel& channel) const
 {
-    GLuint shader = glCreateShader(type);
-    assert(shader);
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        auto* buffer = m_tiles[i]->buffer();
+        assert(buffer);
+
+        IPC::TileAnnouncement announcement;
+        announcement.tileIndex = i;
+        announcement.width = buffer->width();
+        announcement.height = buffer->height();
+        announcement.format = buffer->format();
+        announcement.modifier = buffer->modifier();
+        announcement.planeCount = buffer->planeCount();
+
+        int fds[DMABuffer::maxBufferPlanes];
+        for (uint32_t plane = 0; plane < buffer->planeCount(); ++plane) {
+            announcement.strides[plane] = buffer->strideForPlane(plane);
+            announcement.offsets[plane] = buffer->offsetForPlane(plane);
+            fds[plane] = buffer->dmabufFDForPlane(plane);
+        }
 
-    glShaderSource(shader, 1, &shaderSource, nullptr);
-    glCompileShader(shader);
+        if (!channel.send(&announcement, sizeof(announcement), nullptr, 0, fds, buffer->planeCount()))
+            return false;
+    }
 
-    GLint compiled;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    assert(compiled);
+    return true;
+}
 
-    return shader;
+bool TileRenderer::importTiles(std::unique_ptr<IPC::Channel>&& channel)
+{
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        IPC::TileAnnouncement announcement;
+        int fds[IPC::Channel::maxFDsPerMessage];
+        uint32_t fdCount = 0;
+
+        auto size = channel->receive(&announcement, sizeof(announcement), fds, &fdCount);
+        if (size != sizeof(announcement) || announcement.type != IPC::MessageType::TileAnnouncement || announcement.tileIndex != i || fdCount != announcement.planeCount) {
+            Logger::error("Unexpected message from the painter process while importing tile %u.\n", i);
+            for (uint32_t fd = 0; fd < fdCount; ++fd)
+                close(fds[fd]);
+            return false;
+        }
+
+        auto buffer = DMABuffer::createFromFDs(DMABuffer::Role::TileBuffer, *m_egl, announcement.format, announcement.width, announcement.height, announcement.modifier,
+                                               announcement.planeCount, fds, announcement.strides, announcement.offsets);
+        if (!buffer)
+            return false;
+
+        m_fences.push_back(nullptr);
+        m_tiles.push_back(Tile::createImportedDMABufTile(std::move(buffer)));
+    }
+
+    m_damage.resize(m_numberOfTiles);
+    m_painterChannel = std::move(channel);
+    return true;
+}
+
+bool TileRenderer::requestRemoteUpdate()
+{
+    IPC::FrameRequest request;
+    request.frame = ++m_remoteFrame;
+    request.sendTime = getCurrentTimeInNanoSeconds();
+    if (!m_painterChannel->send(&request, sizeof(request)))
+        return false;
+
+    // The update is followed by the damage of every tile.
+    uint8_t message[IPC::Channel::maxMessageSize];
+    int fds[IPC::Channel::maxFDsPerMessage];
+    uint32_t fdCount = 0;
+
+    auto size = m_painterChannel->receive(message, sizeof(message), fds, &fdCount);
+    auto receiveTime = getCurrentTimeInNanoSeconds();
+
+    IPC::FrameUpdate update;
+    if (size < static_cast<ssize_t>(sizeof(update)))
+        return false;
+
+    memcpy(&update, message, sizeof(update));
+    if (update.type != IPC::MessageType::FrameUpdate || update.frame != request.frame || update.tileCount != m_numberOfTiles
+        || size != static_cast<ssize_t>(sizeof(update) + update.tileCount * sizeof(TileDamage)) || fdCount > 1) {
+        Logger::error("Unexpected message from the painter process in frame %llu.\n", static_cast<unsigned long long>(request.frame));
+        return false;
+    }
+
+    memcpy(m_damage.data(), message + sizeof(update), update.tileCount * sizeof(TileDamage));
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i)
+        m_tiles[i]->setOpaque(m_damage[i].opaque);
+
+    // The painter only attaches a fence if the tiles are painted on the GPU.
+    if (fdCount)
+        m_egl->waitFenceFD(fds[0]);
+
+    m_remoteUpdateTiming.roundTripTime = receiveTime - request.sendTime;
+    m_remoteUpdateTiming.transferTime = receiveTime - update.sendTime;
+    m_remoteUpdateTiming.paintTime = update.sendTime - update.paintStartTime;
+    return true;
 }
 
 void TileRenderer::createShaders()
@@ -108,136 +281,284 @@ void TileRenderer::createShaders()
     const char* fragmentShaderSource = "precision mediump float;\n"
                                        "varying vec2 v_texCoord;\n"
                                        "uniform sampler2D textureSampler;\n"
+                                       "uniform float u_opacity;\n"
                                        "\n"
                                        "void main() {\n"
-                                       "    gl_FragColor = texture2D(textureSampler, v_texCoord);\n"
+                                       "    gl_FragColor = texture2D(textureSampler, v_texCoord) * u_opacity;\n"
                                        "}\n";
 
-    auto vertexShader = loadShader(GL_VERTEX_SHADER, vertexShaderSource);
-    auto fragmentShader = loadShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-    m_program = glCreateProgram();
+    m_program = m_egl->programCache().createProgram("tile composition", vertexShaderSource, fragmentShaderSource);
     assert(m_program);
 
-    glAttachShader(m_program, vertexShader);
-    glAttachShader(m_program, fragmentShader);
+    m_positionLocation = glGetAttribLocation(m_program, "position");
+    m_texCoordLocation = glGetAttribLocation(m_program, "texCoord");
+    m_mvpLocation = glGetUniformLocation(m_program, "u_mvp");
+    m_textureSamplerLocation = glGetUniformLocation(m_program, "textureSampler");
+    m_opacityLocation = glGetUniformLocation(m_program, "u_opacity");
+}
 
-    glLinkProgram(m_program);
+TileDamage TileRenderer::tileDamage(const Tile& tile) const
+{
+    auto& args = Application::commandLineArguments();
+
+    TileDamage damage;
+    switch (args.tileUpdateType) {
+    case TileUpdateType::ThirdUpdate:
+        damage.width = tile.width() / 3;
+        damage.height = tile.height() / 3;
+        damage.x = (m_tileWidth - damage.width) / 3;
+        damage.y = (m_tileHeight - damage.height) / 3;
+        break;
+    case TileUpdateType::HalfUpdate:
+        damage.width = tile.width() / 2;
+        damage.height = tile.height() / 2;
+        damage.x = (m_tileWidth - damage.width) / 2;
+        damage.y = (m_tileHeight - damage.height) / 2;
+        break;
+    case TileUpdateType::FullUpdate:
+    default:
+        damage = { 0, 0, tile.width(), tile.height() };
+        break;
+    }
 
-    GLint linked;
-    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
-    assert(linked);
+    return damage;
 }
 
-void TileRenderer::renderTiles()
+void TileRenderer::updateTile(uint32_t index)
 {
     auto& args = Application::commandLineArguments();
+    auto& tile = *m_tiles[index].get();
+
+    auto damage = tileDamage(tile);
+    bool damageIsOpaque = false;
+    if (m_tilePainter) {
+        tile.paintContent(*m_tilePainter, damage.x, damage.y, damage.width, damage.height);
+        // The painter discards the pixels outside of the --circle, they keep their previous content.
+        damageIsOpaque = !args.circle;
+    } else {
+        auto* contentSource = ContentSource::singleton();
+        auto* rgbaBuffer = contentSource ? contentSource->tileContent(index, m_tileWidth, m_tileHeight, damage) : tile.createRandomContent(damage.width, damage.height);
+        if (args.contentFormat == ContentFormat::BGRA && args.contentConversion == ContentConversion::Separate)
+            rgbaBuffer = Tile::convertContent(rgbaBuffer, damage.width, damage.height);
+        damageIsOpaque = Tile::isOpaqueContent(rgbaBuffer, damage.width, damage.height);
+        if (m_pixelUnpackBuffers)
+            tile.streamContent(*m_pixelUnpackBuffers, damage.x, damage.y, damage.width, damage.height, rgbaBuffer);
+        else
+            tile.updateContent(damage.x, damage.y, damage.width, damage.height, rgbaBuffer);
+    }
 
-    glViewport(0, 0, m_screenWidth, m_screenHeight);
-    if (args.clear) {
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    tile.didUpdateContent(damage, damageIsOpaque);
+    damage.opaque = tile.isOpaque();
+    m_damage[index] = damage;
+
+    if (auto* counters = PerfCounters::singleton())
+        counters->addUploadedBytes(uint64_t(damage.width) * damage.height * Tile::pixelFormat().bytesPerPixel);
+
+    if (args.fences)
+        m_fences[index] = m_egl->createFence();
+}
+
+void TileRenderer::updateTiles()
+{
+    if (m_syncFileFencing) {
+        updateTilesInFenceOrder();
+        return;
     }
 
-    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
-        auto& tile = *m_tiles[i].get();
-        switch (args.tileUpdateType) {
-        case TileUpdateType::ThirdUpdate: {
-            auto width = tile.width() / 3;
-            auto height = tile.height() / 3;
-            auto xOffset = (m_tileWidth - width) / 3;
-            auto yOffset = (m_tileHeight - height) / 3;
-            auto* rgbaBuffer = tile.createRandomContent(width, height);
-            tile.updateContent(xOffset, yOffset, width, height, rgbaBuffer);
-            break;
+    updateTiles(0, m_numberOfTiles);
+}
+
+void TileRenderer::updateTiles(uint32_t first, uint32_t count, uint32_t stride)
+{
+    // Painting into the tile FBOs must not clobber the framebuffer the tiles get composited into.
+    GLint frameBuffer = 0;
+    if (m_tilePainter)
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &frameBuffer);
+
+    for (uint32_t i = 0; i < count; ++i)
+        updateTile((first + i * stride) % m_numberOfTiles);
+
+    if (m_tilePainter)
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+}
+
+void TileRenderer::updateTilesInFenceOrder()
+{
+    if (m_syncFileEpollFD == -1) {
+        m_syncFileEpollFD = epoll_create1(EPOLL_CLOEXEC);
+        if (m_syncFileEpollFD == -1) {
+            Logger::error("Failed to create the sync file epoll instance\n");
+            abort();
         }
-        case TileUpdateType::HalfUpdate: {
-            auto width = tile.width() / 2;
-            auto height = tile.height() / 2;
-            auto xOffset = (m_tileWidth - width) / 2;
-            auto yOffset = (m_tileHeight - height) / 2;
-            auto* rgbaBuffer = tile.createRandomContent(width, height);
-            tile.updateContent(xOffset, yOffset, width, height, rgbaBuffer);
-            break;
+    }
+
+    // Snapshot the fences of all tiles first: a tile the GPU is still reading must not delay the others.
+    std::vector<int> syncFileFDs(m_numberOfTiles, -1);
+    uint32_t pendingTiles = 0;
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        int fd = m_syncFileFencing ? m_tiles[i]->exportWriteFence() : -1;
+        if (fd == -1) {
+            if (m_syncFileFencing && (errno == ENOTTY || errno == EINVAL)) {
+                Logger::info("DMA_BUF_IOCTL_EXPORT_SYNC_FILE is not supported (Linux >= 6.0), --sync-file-fencing is disabled.\n");
+                m_syncFileFencing = false;
+            }
+
+            // Blocks in DMA_BUF_IOCTL_SYNC instead.
+            updateTile(i);
+            continue;
         }
-        case TileUpdateType::FullUpdate:
-        default: {
-            auto* rgbaBuffer = tile.createRandomContent(tile.width(), tile.height());
-            tile.updateContent(0, 0, tile.width(), tile.height(), rgbaBuffer);
-            break;
+
+        struct epoll_event event = { };
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(m_syncFileEpollFD, EPOLL_CTL_ADD, fd, &event);
+        syncFileFDs[i] = fd;
+        ++pendingTiles;
+    }
+
+    // Update the tiles in the order their fences signal.
+    std::array<struct epoll_event, 16> events;
+    while (pendingTiles) {
+        int count = epoll_wait(m_syncFileEpollFD, events.data(), events.size(), -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+
+            Logger::error("Failed to wait for the tile sync files\n");
+            abort();
         }
+
+        for (int i = 0; i < count; ++i) {
+            auto index = events[i].data.u32;
+            epoll_ctl(m_syncFileEpollFD, EPOLL_CTL_DEL, syncFileFDs[index], nullptr);
+            close(syncFileFDs[index]);
+            syncFileFDs[index] = -1;
+
+            updateTile(index);
+            --pendingTiles;
         }
+    }
+}
+
+TileRenderer::CompositeTilesFunction TileRenderer::compositeTilesFunction(bool blend, bool fences)
+{
+    static constexpr CompositeTilesFunction compositeTilesFunctions[2][2] = {
+        { &TileRenderer::compositeTilesWith<false, false>, &TileRenderer::compositeTilesWith<false, true> },
+        { &TileRenderer::compositeTilesWith<true, false>, &TileRenderer::compositeTilesWith<true, true> }
+    };
+    return compositeTilesFunctions[blend][fences];
+}
 
-        if (args.fences)
-            m_fences[i] = m_egl.createFence();
+void TileRenderer::compositeTiles()
+{
+    auto& args = Application::commandLineArguments();
+
+    auto* gpuTimer = m_egl->gpuTimer();
+
+    if (args.compositorAnimation != CompositorAnimation::None)
+        animateTiles();
+
+    glViewport(0, 0, m_screenWidth, m_screenHeight);
+    uint64_t clearedPixels = 0;
+    if (args.clear) {
+        GPUTimerScope clearScope(gpuTimer, GPUTimer::Stage::ColorClear);
+        clearedPixels = clearUncoveredArea();
     }
 
-    int tileIndex = 0;
-    for (int row = 0; row < m_numberOfTileRows; row++) {
-        for (int column = 0; column < m_numberOfTileColumns; column++) {
-            renderTile(m_fences[tileIndex], m_tiles[tileIndex]->id(), column * m_tileWidth, row * m_tileHeight);
-            ++tileIndex;
+    {
+        GPUTimerScope compositionScope(gpuTimer, GPUTimer::Stage::Composition);
+        auto projection = TransformationMatrix::orthographicProjection(0, m_screenWidth, m_screenHeight, 0, -1000, 1000);
+        (this->*m_compositeTilesFunction)(projection, 1.0f);
+        if (m_videoPlayer)
+            m_videoPlayer->composite(projection, m_screenWidth, m_screenHeight);
+    }
 
-            if (tileIndex == m_numberOfTiles)
-                break;
-        }
+    recordComposition(m_blend, clearedPixels);
+
+    // Texels sampled and written (and read back for blending) within the window, plus the --clear fill.
+    if (auto* counters = BandwidthCounters::singleton()) {
+        const uint64_t texelSize = Tile::pixelFormat().bytesPerPixel;
+        uint64_t bytes = clearedPixels * sizeof(uint32_t);
+        for (uint32_t i = 0; i < m_numberOfTiles; ++i)
+            bytes += visibleTilePixels(i) * (texelSize + sizeof(uint32_t) * (isTileBlended(i, m_blend) ? 2 : 1));
+        counters->add(BandwidthCounters::Stage::GPUComposition, bytes);
     }
 }
 
-static void constructOrthogonalProjectionMatrix(float* m, int mOffset, float left, float right, float bottom, float top, float near, float far)
-{
-    float r_width = 1.0f / (right - left);
-    float r_height = 1.0f / (top - bottom);
-    float r_depth = 1.0f / (far - near);
-    float x = 2.0f * (r_width);
-    float y = -2.0f * (r_height);
-    float z = -2.0f * (r_depth);
-    float tx = -(right + left) * r_width;
-    float ty = (top + bottom) * r_height;
-    float tz = -(far + near) * r_depth;
-
-    m[mOffset +  0] = x;
-    m[mOffset +  1] = 0.0f;
-    m[mOffset +  2] = 0.0f;
-    m[mOffset +  3] = 0.0f;
-    m[mOffset +  4] = 0.0f;
-    m[mOffset +  5] = y;
-    m[mOffset +  6] = 0.0f;
-    m[mOffset +  7] = 0.0f;
-    m[mOffset +  8] = 0.0f;
-    m[mOffset +  9] = 0.0f;
-    m[mOffset + 10] = z;
-    m[mOffset + 11] = 0.0f;
-    m[mOffset + 12] = tx;
-    m[mOffset + 13] = ty;
-    m[mOffset + 14] = tz;
-    m[mOffset + 15] = 1.0f;
+void TileRenderer::setVideoPlayer(std::unique_ptr<VideoPlayer>&& videoPlayer)
+{
+    m_videoPlayer = std::move(videoPlayer);
 }
 
-void TileRenderer::renderTile(EGLSyncKHR& fence, GLuint textureID, GLfloat x, GLfloat y)
+void TileRenderer::compositeLayer(const TransformationMatrix& mvp, float opacity, const LayerBounds& bounds)
 {
     auto& args = Application::commandLineArguments();
-    if (fence) {
-        m_egl.clientWaitFence(fence);
-        m_egl.destroyFence(fence);
-        fence = nullptr;
+    m_layerBounds = bounds;
+    (this->*compositeTilesFunction(args.blend || opacity < 1.0f, args.fences))(mvp, opacity);
+    m_layerBounds.reset();
+}
+
+template<bool fences>
+void TileRenderer::renderTile(EGLSyncKHR& fence, GLuint textureID, GLfloat x, GLfloat y)
+{
+    if constexpr (fences) {
+        if (fence) {
+            m_egl->clientWaitFence(fence);
+            m_egl->destroyFence(fence);
+            fence = nullptr;
+        }
     }
 
-    float mvp[16];
-    constructOrthogonalProjectionMatrix(mvp, 0, 0, m_screenWidth, m_screenHeight, 0, -1000, 1000);
+    GLfloat left = x;
+    GLfloat top = y;
+    GLfloat right = x + m_tileWidth;
+    GLfloat bottom = y + m_tileHeight;
+
+    // --scene: the edge tiles extend past the layer. A scissor cannot clip them once the layer is rotated, cut the
+    // quad and its texture coordinates instead.
+    GLfloat u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    if (m_layerBounds) {
+        left = std::max(left, m_layerBounds->x);
+        top = std::max(top, m_layerBounds->y);
+        right = std::min(right, m_layerBounds->x + m_layerBounds->width);
+        bottom = std::min(bottom, m_layerBounds->y + m_layerBounds->height);
+        if (left >= right || top >= bottom)
+            return;
+
+        u0 = (left - x) / m_tileWidth;
+        v0 = (top - y) / m_tileHeight;
+        u1 = (right - x) / m_tileWidth;
+        v1 = (bottom - y) / m_tileHeight;
+    }
 
     GLfloat vertices[] = {
-        x,
-        y,
-        x + m_tileWidth,
-        y,
-        x,
-        y + m_tileHeight,
-        x + m_tileWidth,
-        y + m_tileHeight,
+        left,
+        top,
+        right,
+        top,
+        left,
+        bottom,
+        right,
+        bottom,
     };
 
-    GLfloat texCoords[] = {
+    // Otherwise the texture coordinates set up in compositeTilesWith() are used.
+    const GLfloat texCoords[] = { u0, v0, u1, v0, u0, v1, u1, v1 };
+    if (m_layerBounds)
+        glVertexAttribPointer(m_texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glVertexAttribPointer(m_positionLocation, 2, GL_FLOAT, GL_FALSE, 0, vertices);
+
+    // Draw the image
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+template<bool blend, bool fences>
+void TileRenderer::compositeTilesWith(const TransformationMatrix& mvp, float opacity)
+{
+    // The state shared by all tiles is set up once per frame, renderTile() only binds the tile.
+    static const GLfloat texCoords[] = {
         0.0f,
         0.0f,
         1.0f,
@@ -250,39 +571,274 @@ void TileRenderer::renderTile(EGLSyncKHR& fence, GLuint textureID, GLfloat x, GL
 
     glUseProgram(m_program);
 
-    // Get attribute and uniform locations
-    GLint positionLoc = glGetAttribLocation(m_program, "position");
-    GLint texCoordLoc = glGetAttribLocation(m_program, "texCoord");
-    GLint mvpLoc = glGetUniformLocation(m_program, "u_mvp");
-    GLint textureSamplerLoc = glGetUniformLocation(m_program, "textureSampler");
-
-    // Bind the texture
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glUniform1i(textureSamplerLoc, 0);
+    glUniform1i(m_textureSamplerLocation, 0);
+    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, mvp.data());
+    glUniform1f(m_opacityLocation, opacity);
+
+    glVertexAttribPointer(m_texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
+    glEnableVertexAttribArray(m_texCoordLocation);
+    glEnableVertexAttribArray(m_positionLocation);
+
+    // Translucent layers (--scene) and fading tiles (--compositor-animation) are always blended.
+    const bool animated = !m_tileAnimations.empty();
+    auto tileOpacity = [&](uint32_t i) { return animated ? opacity * m_tileAnimations[i].opacity : opacity; };
+    auto isTileOpaque = [&](uint32_t i) { return m_tiles[i]->isOpaque() && tileOpacity(i) == 1.0f; };
+    auto drawTile = [&](uint32_t i) {
+        if (animated) {
+            auto tileMVP = mvp;
+            tileMVP.multiply(m_tileAnimations[i].transform);
+            glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, tileMVP.data());
+            glUniform1f(m_opacityLocation, tileOpacity(i));
+        }
+
+        uint32_t x, y;
+        tilePosition(i, x, y);
+        renderTile<fences>(m_fences[i], m_tiles[i]->id(), x, y);
+    };
+
+    if constexpr (blend) {
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        if (animated) {
+            // Animated tiles overlap each other: they are drawn in index order, blending is switched per tile.
+            bool blending = false;
+            for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+                if (isTileOpaque(i) == blending) {
+                    blending = !blending;
+                    if (blending)
+                        glEnable(GL_BLEND);
+                    else
+                        glDisable(GL_BLEND);
+                }
+                drawTile(i);
+            }
+        } else {
+            // The grid tiles do not overlap: the opaque ones are drawn first without blending, the translucent
+            // ones are blended afterwards.
+            for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+                if (isTileOpaque(i))
+                    drawTile(i);
+            }
+
+            glEnable(GL_BLEND);
+            for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+                if (!isTileOpaque(i))
+                    drawTile(i);
+            }
+        }
+        glDisable(GL_BLEND);
+    } else {
+        for (uint32_t i = 0; i < m_numberOfTiles; ++i)
+            drawTile(i);
+    }
+
+    // Cleanup
+    glDisableVertexAttribArray(m_positionLocation);
+    glDisableVertexAttribArray(m_texCoordLocation);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, mvp);
+void TileRenderer::compositeTilesInMemory(uint32_t* dst, uint32_t pitch)
+{
+    auto& args = Application::commandLineArguments();
 
-    // Set vertex attribute pointers
-    glVertexAttribPointer(positionLoc, 2, GL_FLOAT, GL_FALSE, 0, vertices);
-    glEnableVertexAttribArray(positionLoc);
+    // Only the area not covered by opaque tiles is cleared.
+    uint64_t clearedPixels = 0;
+    if (args.clear) {
+        forEachUncoveredRect([&](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+            for (uint32_t row = y; row < y + height; ++row)
+                std::fill_n(dst + row * pitch + x, width, 0xffffffff);
+            clearedPixels += uint64_t(width) * height;
+        });
+    }
 
-    glVertexAttribPointer(texCoordLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
-    glEnableVertexAttribArray(texCoordLoc);
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        uint32_t x, y;
+        tilePosition(i, x, y);
+        m_tiles[i]->compositeInMemory(dst, x, y, m_screenWidth, m_screenHeight, pitch);
+    }
 
-    if (args.blend) {
-        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_BLEND);
+    recordComposition(m_blend, clearedPixels);
+}
+
+template<typename Function>
+void TileRenderer::forEachUncoveredRect(const Function& function) const
+{
+    auto clippedRect = [&](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+        if (x >= m_screenWidth || y >= m_screenHeight)
+            return;
+
+        width = std::min(width, m_screenWidth - x);
+        height = std::min(height, m_screenHeight - y);
+        if (width && height)
+            function(x, y, width, height);
+    };
+
+    // No opaque tile: a single rect is cheaper than one per grid cell. Animated tiles move away from their cell.
+    if (!m_tileAnimations.empty() || std::none_of(m_tiles.begin(), m_tiles.end(), [](auto& tile) { return tile->isOpaque(); })) {
+        clippedRect(0, 0, m_screenWidth, m_screenHeight);
+        return;
     }
 
-    // Draw the image
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    // The grid cells without an opaque tile, then the strips right of and below the grid.
+    for (uint32_t row = 0; row < m_numberOfTileRows; ++row) {
+        for (uint32_t column = 0; column < m_numberOfTileColumns; ++column) {
+            const uint32_t index = row * m_numberOfTileColumns + column;
+            if (index >= m_numberOfTiles || !m_tiles[index]->isOpaque())
+                clippedRect(column * m_tileWidth, row * m_tileHeight, m_tileWidth, m_tileHeight);
+        }
+    }
 
-    if (args.blend)
-        glDisable(GL_BLEND);
+    const uint32_t gridWidth = m_numberOfTileColumns * m_tileWidth;
+    const uint32_t gridHeight = m_numberOfTileRows * m_tileHeight;
+    clippedRect(gridWidth, 0, m_screenWidth - std::min(gridWidth, m_screenWidth), m_screenHeight);
+    clippedRect(0, gridHeight, gridWidth, m_screenHeight - std::min(gridHeight, m_screenHeight));
+}
 
-    // Cleanup
-    glDisableVertexAttribArray(positionLoc);
-    glDisableVertexAttribArray(texCoordLoc);
-    glBindTexture(GL_TEXTURE_2D, 0);
+uint64_t TileRenderer::clearUncoveredArea()
+{
+    uint64_t clearedPixels = 0;
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glEnable(GL_SCISSOR_TEST);
+
+    // The projection maps the tile coordinates 1:1 to window coordinates.
+    forEachUncoveredRect([&](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+        glScissor(x, y, width, height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        clearedPixels += uint64_t(width) * height;
+    });
+
+    glDisable(GL_SCISSOR_TEST);
+    return clearedPixels;
+}
+
+uint64_t TileRenderer::visibleTilePixels(uint32_t index) const
+{
+    uint32_t x, y;
+    tilePosition(index, x, y);
+    if (x >= m_screenWidth || y >= m_screenHeight)
+        return 0;
+
+    return uint64_t(std::min(m_tileWidth, m_screenWidth - x)) * std::min(m_tileHeight, m_screenHeight - y);
+}
+
+bool TileRenderer::isTileBlended(uint32_t index, bool blend) const
+{
+    if (!blend)
+        return false;
+
+    return !m_tiles[index]->isOpaque() || (!m_tileAnimations.empty() && m_tileAnimations[index].opacity < 1.0f);
+}
+
+void TileRenderer::animateTiles()
+{
+    auto& args = Application::commandLineArguments();
+    auto animates = [&](CompositorAnimation animation) {
+        return args.compositorAnimation == animation || args.compositorAnimation == CompositorAnimation::All;
+    };
+
+    m_tileAnimations.resize(m_numberOfTiles);
+
+    // One period every 120 frames, neighbouring tiles are out of phase. Rotation and scale are around the tile center.
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        float phase = float(m_animationFrame % 120) * 2.0f * float(M_PI) / 120.0f + float(i) * 0.5f;
+
+        uint32_t x, y;
+        tilePosition(i, x, y);
+        float centerX = x + m_tileWidth / 2.0f;
+        float centerY = y + m_tileHeight / 2.0f;
+
+        TransformationMatrix transform;
+        if (animates(CompositorAnimation::Translate))
+            transform.translate(sinf(phase) * m_tileWidth / 4.0f, cosf(phase) * m_tileHeight / 4.0f);
+
+        transform.translate(centerX, centerY);
+        if (animates(CompositorAnimation::Rotate))
+            transform.rotate(phase * 180.0f / float(M_PI));
+        if (animates(CompositorAnimation::Scale))
+            transform.scale(0.75f + 0.25f * sinf(phase), 0.75f + 0.25f * sinf(phase));
+        transform.translate(-centerX, -centerY);
+
+        m_tileAnimations[i].transform = transform;
+        m_tileAnimations[i].opacity = animates(CompositorAnimation::Fade) ? 0.5f + 0.5f * sinf(phase) : 1.0f;
+    }
+
+    ++m_animationFrame;
+}
+
+void TileRenderer::recordComposition(bool blend, uint64_t clearedPixels)
+{
+    auto& args = Application::commandLineArguments();
+
+    auto& statistics = m_compositionStatistics;
+    ++statistics.frames;
+    statistics.clearedPixels += clearedPixels;
+    if (args.clear)
+        statistics.fullClearPixels += uint64_t(m_screenWidth) * m_screenHeight;
+
+    for (uint32_t i = 0; i < m_numberOfTiles; ++i) {
+        auto pixels = visibleTilePixels(i);
+        statistics.tilePixels += pixels;
+        if (isTileBlended(i, blend))
+            statistics.blendedPixels += pixels;
+    }
+}
+
+void TileRenderer::reportComposition() const
+{
+    auto& args = Application::commandLineArguments();
+
+    auto& statistics = m_compositionStatistics;
+    if (!statistics.frames || !m_screenWidth || !m_screenHeight)
+        return;
+
+    const double frames = double(statistics.frames);
+    const double windowPixels = double(m_screenWidth) * m_screenHeight;
+    auto perFrame = [&](uint64_t pixels) { return double(pixels) / frames / 1e6; };
+
+    // Overdraw: pixels written per frame (clear + tiles) relative to the window size.
+    Logger::info("Composition: overdraw %.2fx of the window (%.2fx without occlusion)\n",
+                 double(statistics.clearedPixels + statistics.tilePixels) / frames / windowPixels,
+                 double(statistics.fullClearPixels + statistics.tilePixels) / frames / windowPixels);
+    if (args.clear)
+        Logger::info("  cleared %.2f MPixel / frame instead of %.2f\n", perFrame(statistics.clearedPixels), perFrame(statistics.fullClearPixels));
+    if (m_blend)
+        Logger::info("  blended %.2f MPixel / frame instead of %.2f, the rest belongs to opaque tiles\n", perFrame(statistics.blendedPixels), perFrame(statistics.tilePixels));
+}
+
+void TileRenderer::tilePosition(uint32_t index, uint32_t& x, uint32_t& y) const
+{
+    x = (index % m_numberOfTileColumns) * m_tileWidth;
+    y = (index / m_numberOfTileColumns) * m_tileHeight;
+}
+
+void TileRenderer::paintTiles()
+{
+    if (!m_painterChannel) {
+        auto* contentSource = ContentSource::singleton();
+        if (contentSource && !Application::commandLineArguments().noAnimate)
+            contentSource->advance();
+        updateTiles();
+        return;
+    }
+
+    if (!requestRemoteUpdate()) {
+        Logger::error("Lost connection to the painter process.\n");
+        abort();
+    }
+}
+
+void TileRenderer::renderTiles()
+{
+    PerfCounterScope scope(PerfCounters::Scope::RenderTiles);
+    // --compositor-animation: the content is painted in the first frame only.
+    auto& args = Application::commandLineArguments();
+    if (args.compositorAnimation == CompositorAnimation::None || !m_animationFrame) {
+        GPUTimerScope updateScope(m_egl->gpuTimer(), GPUTimer::Stage::TileUpdate);
+        paintTiles();
+    }
+
+    if (m_videoPlayer)
+        m_videoPlayer->update();
+    compositeTiles();
 }
@@ -20,38 +20,126 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 
+#include "Tile.h"
+#include "TransformationMatrix.h"
+
 class DRM;
 class EGL;
 class GBM;
-class Tile;
+class PixelUnpackBufferRing;
+class TilePainter;
+class VideoPlayer;
+
+namespace IPC {
+class Channel;
+}
 
 class TileRenderer {
 public:
-    TileRenderer(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL&);
+    TileRenderer(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL*);
     ~TileRenderer();
 
-    static std::unique_ptr<TileRenderer> create(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL&);
+    // Without EGL (--software) only memory tiles and compositeTilesInMemory() are available.
+    static std::unique_ptr<TileRenderer> create(uint32_t numberOfTiles, uint32_t tileWidth, uint32_t tileHeight, const EGL*);
 
     void initialize(uint32_t screenWidth, uint32_t screenHeight);
 
     void allocateGLTiles();
     void allocateDMABufTiles(const DRM&, const GBM&);
-
+    void allocateMemoryTiles();
+
+    // Painter process: sends the tile dma-bufs to the compositor process.
+    bool exportTiles(IPC::Channel&) const;
+    // Compositor process: imports the tiles, every frame is painted by the painter process.
+    bool importTiles(std::unique_ptr<IPC::Channel>&&);
+    bool isRemote() const { return !!m_painterChannel; }
+
+    uint32_t tileCount() const { return m_tiles.size(); }
+    Tile& tile(uint32_t index) const { return *m_tiles[index]; }
+    void tilePosition(uint32_t index, uint32_t& x, uint32_t& y) const;
+
+    void updateTiles();
+    // Updates the tiles first, first + stride, ... (modulo the tile count).
+    void updateTiles(uint32_t first, uint32_t count, uint32_t stride = 1);
+    // Updates the tiles locally, or obtains the update from the painter process.
+    void paintTiles();
+    void compositeTiles();
+    // --scene: composites the tiles as a layer, mapped into the window by the given MVP matrix and multiplied
+    // by the opacity. The tiles are clipped to the layer bounds, given in tile grid coordinates, as the grid is
+    // rounded up to whole tiles. The caller sets up the viewport and the clip in window coordinates.
+    struct LayerBounds {
+        float x { 0.0f };
+        float y { 0.0f };
+        float width { 0.0f };
+        float height { 0.0f };
+    };
+    void compositeLayer(const TransformationMatrix& mvp, float opacity, const LayerBounds&);
+    void compositeTilesInMemory(uint32_t* dst, uint32_t pitch);
     void renderTiles();
 
+    // Overdraw removed by skipping the clear beneath opaque tiles and by not blending them.
+    void reportComposition() const;
+
+    // --video-width: the video is decoded at its own frame rate and composited above the tiles.
+    void setVideoPlayer(std::unique_ptr<VideoPlayer>&&);
+    const VideoPlayer* videoPlayer() const { return m_videoPlayer.get(); }
+
+    const std::vector<TileDamage>& damage() const { return m_damage; }
+
+    struct RemoteUpdateTiming {
+        int64_t roundTripTime { 0 }; // request sent -> update received
+        int64_t transferTime { 0 };  // update sent by the painter -> update received
+        int64_t paintTime { 0 };     // spent in the painter process
+    };
+
+    const RemoteUpdateTiming& remoteUpdateTiming() const { return m_remoteUpdateTiming; }
+
 private:
+    bool requestRemoteUpdate();
+
+    TileDamage tileDamage(const Tile&) const;
+    void updateTile(uint32_t index);
+    // --sync-file-fencing: waits for the fences of all tiles at once and updates the tiles as they become writable.
+    void updateTilesInFenceOrder();
+
+    template<typename Function> void forEachUncoveredRect(const Function&) const;
+    uint64_t clearUncoveredArea();
+    uint64_t visibleTilePixels(uint32_t index) const;
+    bool isTileBlended(uint32_t index, bool blend) const;
+    void recordComposition(bool blend, uint64_t clearedPixels);
+
+    // --compositor-animation: advances the per-tile transforms and opacities by one frame.
+    void animateTiles();
+
     void createShaders();
+    void createPixelUnpackBuffers();
 
-    void renderTile(EGLSyncKHR&, GLuint textureID, GLfloat x, GLfloat y);
+    // Specialized per (--blend, --fences) combination, selected once at construction for the tile grid.
+    using CompositeTilesFunction = void (TileRenderer::*)(const TransformationMatrix& mvp, float opacity);
+    static CompositeTilesFunction compositeTilesFunction(bool blend, bool fences);
+    template<bool blend, bool fences> void compositeTilesWith(const TransformationMatrix& mvp, float opacity);
+    template<bool fences> void renderTile(EGLSyncKHR&, GLuint textureID, GLfloat x, GLfloat y);
 
-    const EGL& m_egl;
+    const EGL* m_egl { nullptr };
     GLuint m_program { 0 };
+    GLint m_positionLocation { -1 };
+    GLint m_texCoordLocation { -1 };
+    GLint m_mvpLocation { -1 };
+    GLint m_textureSamplerLocation { -1 };
+    GLint m_opacityLocation { -1 };
+    CompositeTilesFunction m_compositeTilesFunction { nullptr };
+    bool m_blend { false }; // --blend, or fading tiles
+    std::unique_ptr<TilePainter> m_tilePainter;
+    std::unique_ptr<PixelUnpackBufferRing> m_pixelUnpackBuffers;
+    std::unique_ptr<VideoPlayer> m_videoPlayer;
+    std::optional<LayerBounds> m_layerBounds; // set while compositeLayer() draws
 
     uint32_t m_screenWidth { 0 };
     uint32_t m_screenHeight { 0 };
@@ -63,6 +151,31 @@ private:
     uint32_t m_numberOfTileColumns { 0 };
     uint32_t m_numberOfTileRows { 0 };
 
+    bool m_syncFileFencing { false };
+    int m_syncFileEpollFD { -1 };
+
     std::vector<EGLSyncKHR> m_fences;
     std::vector<std::unique_ptr<Tile>> m_tiles;
+    std::vector<TileDamage> m_damage;
+
+    // Applied on top of the grid position, empty unless --compositor-animation is used.
+    struct TileAnimation {
+        TransformationMatrix transform;
+        float opacity { 1.0f };
+    };
+    std::vector<TileAnimation> m_tileAnimations;
+    uint64_t m_animationFrame { 0 };
+
+    struct CompositionStatistics {
+        uint64_t frames { 0 };
+        uint64_t tilePixels { 0 }; // visible tile pixels
+        uint64_t blendedPixels { 0 };
+        uint64_t clearedPixels { 0 };
+        uint64_t fullClearPixels { 0 }; // --clear without occlusion
+    };
+    CompositionStatistics m_compositionStatistics;
+
+    std::unique_ptr<IPC::Channel> m_painterChannel;
+    uint64_t m_remoteFrame { 0 };
+    RemoteUpdateTiming m_remoteUpdateTiming;
 };
@@ -0,0 +1,112 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "TransformationMatrix.h"
+
+#include <cmath>
+
+TransformationMatrix TransformationMatrix::orthographicProjection(float left, float right, float bottom, float top, float near, float far)
+{
+    float r_width = 1.0f / (right - left);
+    float r_height = 1.0f / (top - bottom);
+    float r_depth = 1.0f / (far - near);
+    float x = 2.0f * (r_width);
+    float y = -2.0f * (r_height);
+    float z = -2.0f * (r_depth);
+    float tx = -(right + left) * r_width;
+    float ty = (top + bottom) * r_height;
+    float tz = -(far + near) * r_depth;
+
+    return TransformationMatrix({
+        x, 0.0f, 0.0f, 0.0f,
+        0.0f, y, 0.0f, 0.0f,
+        0.0f, 0.0f, z, 0.0f,
+        tx, ty, tz, 1.0f,
+    });
+}
+
+TransformationMatrix TransformationMatrix::affine(float a, float b, float c, float d, float e, float f)
+{
+    return TransformationMatrix({
+        a, b, 0.0f, 0.0f,
+        c, d, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        e, f, 0.0f, 1.0f,
+    });
+}
+
+TransformationMatrix& TransformationMatrix::multiply(const TransformationMatrix& other)
+{
+    std::array<float, 16> result;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int i = 0; i < 4; ++i)
+                sum += m_matrix[i * 4 + row] * other.m_matrix[column * 4 + i];
+            result[column * 4 + row] = sum;
+        }
+    }
+
+    m_matrix = result;
+    return *this;
+}
+
+TransformationMatrix& TransformationMatrix::translate(float x, float y)
+{
+    for (int row = 0; row < 4; ++row)
+        m_matrix[12 + row] += m_matrix[row] * x + m_matrix[4 + row] * y;
+    return *this;
+}
+
+TransformationMatrix& TransformationMatrix::scale(float x, float y)
+{
+    for (int row = 0; row < 4; ++row) {
+        m_matrix[row] *= x;
+        m_matrix[4 + row] *= y;
+    }
+    return *this;
+}
+
+TransformationMatrix& TransformationMatrix::rotate(float degrees)
+{
+    float radians = degrees * float(M_PI) / 180.0f;
+    float cosine = cosf(radians);
+    float sine = sinf(radians);
+    for (int row = 0; row < 4; ++row) {
+        float column0 = m_matrix[row];
+        float column1 = m_matrix[4 + row];
+        m_matrix[row] = column0 * cosine + column1 * sine;
+        m_matrix[4 + row] = column1 * cosine - column0 * sine;
+    }
+    return *this;
+}
+
+void TransformationMatrix::map(float& x, float& y) const
+{
+    float mappedX = m_matrix[0] * x + m_matrix[4] * y + m_matrix[12];
+    float mappedY = m_matrix[1] * x + m_matrix[5] * y + m_matrix[13];
+    float w = m_matrix[3] * x + m_matrix[7] * y + m_matrix[15];
+    if (w && w != 1.0f) {
+        mappedX /= w;
+        mappedY /= w;
+    }
+
+    x = mappedX;
+    y = mappedY;
+}
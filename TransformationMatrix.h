@@ -0,0 +1,51 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+
+// 4x4 matrix in column-major order, as uploaded with glUniformMatrix4fv(). Starts as identity.
+class TransformationMatrix {
+public:
+    TransformationMatrix() = default;
+    explicit TransformationMatrix(const std::array<float, 16>& matrix)
+        : m_matrix(matrix)
+    {
+    }
+
+    static TransformationMatrix orthographicProjection(float left, float right, float bottom, float top, float near, float far);
+    // CSS matrix(a, b, c, d, e, f).
+    static TransformationMatrix affine(float a, float b, float c, float d, float e, float f);
+
+    // Post-multiplies, the new transformation applies before the existing ones.
+    TransformationMatrix& multiply(const TransformationMatrix&);
+    TransformationMatrix& translate(float x, float y);
+    TransformationMatrix& scale(float x, float y);
+    // Around the z axis, clockwise in window coordinates.
+    TransformationMatrix& rotate(float degrees);
+
+    // Maps a point of the z = 0 plane, with perspective division.
+    void map(float& x, float& y) const;
+
+    const float* data() const { return m_matrix.data(); }
+
+private:
+    std::array<float, 16> m_matrix { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+};
@@ -21,9 +21,9 @@
 
 #include <time.h>
 
-int64_t getCurrentTimeInNanoSeconds()
+int64_t getCurrentTimeInNanoSeconds(clockid_t clockID)
 {
 	struct timespec tv;
-	clock_gettime(CLOCK_MONOTONIC, &tv);
+	clock_gettime(clockID, &tv);
 	return tv.tv_nsec + tv.tv_sec * nsPerSecond;
 }
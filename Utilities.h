@@ -20,9 +20,10 @@
 #pragma once
 
 #include <cstdint>
+#include <ctime>
 
 static constexpr int64_t msPerSecond = uint64_t(1000);
 static constexpr int64_t usPerSecond = uint64_t(1000) * msPerSecond;
 static constexpr int64_t nsPerSecond = uint64_t(1000) * usPerSecond;
 
-int64_t getCurrentTimeInNanoSeconds();
+int64_t getCurrentTimeInNanoSeconds(clockid_t = CLOCK_MONOTONIC);
@@ -0,0 +1,253 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "VideoPlayer.h"
+
+#include "Application.h"
+#include "BandwidthCounters.h"
+#include "EGL.h"
+#include "Logger.h"
+#include "ProgramCache.h"
+#include "TransformationMatrix.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <drm_fourcc.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+VideoPlayer::VideoPlayer(const EGL& egl, uint32_t width, uint32_t height, uint32_t frameRate, uint32_t format)
+    : m_egl(egl)
+    , m_width(width)
+    , m_height(height)
+    , m_frameRate(frameRate)
+    , m_format(format)
+{
+}
+
+VideoPlayer::~VideoPlayer()
+{
+    for (auto& frame : m_frames) {
+        for (uint32_t plane = 0; plane < DMABuffer::maxBufferPlanes; ++plane) {
+            if (frame.mappedAddresses[plane])
+                munmap(frame.mappedAddresses[plane], frame.mappedSizes[plane]);
+        }
+    }
+    m_frames.clear();
+
+    if (m_program)
+        glDeleteProgram(m_program);
+}
+
+std::unique_ptr<VideoPlayer> VideoPlayer::create(const DRM& drm, const GBM& gbm, const EGL& egl)
+{
+    auto& args = Application::commandLineArguments();
+    if (!egl.glEGLImageTargetTexture2DOES) {
+        Logger::error("Video composition requires GL_OES_EGL_image_external\n");
+        return nullptr;
+    }
+
+    const uint32_t format = args.videoFormat == VideoFormat::NV12 ? DRM_FORMAT_NV12 : DRM_FORMAT_YUV420;
+    auto videoPlayer = std::make_unique<VideoPlayer>(egl, args.videoWidth, args.videoHeight, args.videoFrameRate, format);
+    if (!videoPlayer->allocateFrames(drm, gbm) || !videoPlayer->createProgram())
+        return nullptr;
+
+    return videoPlayer;
+}
+
+bool VideoPlayer::allocateFrames(const DRM& drm, const GBM& gbm)
+{
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        Frame frame;
+        frame.buffer = DMABuffer::create(DMABuffer::Role::VideoBuffer, drm, gbm, m_egl, m_format, m_width, m_height, { DRM_FORMAT_MOD_LINEAR });
+        if (!frame.buffer) {
+            Logger::error("Failed to allocate the %ux%u video frames\n", m_width, m_height);
+            return false;
+        }
+
+        // Mapped once, every plane through its own FD.
+        auto& buffer = *frame.buffer;
+        for (uint32_t plane = 0; plane < buffer.planeCount(); ++plane) {
+            const uint32_t planeHeight = plane ? m_height / 2 : m_height;
+            frame.mappedSizes[plane] = size_t(buffer.offsetForPlane(plane)) + size_t(buffer.strideForPlane(plane)) * planeHeight;
+            void* address = mmap(nullptr, frame.mappedSizes[plane], PROT_WRITE, MAP_SHARED, buffer.dmabufFDForPlane(plane), 0);
+            if (address == MAP_FAILED) {
+                Logger::error("Failed to mmap() plane %u of the video frame\n", plane);
+                return false;
+            }
+
+            frame.mappedAddresses[plane] = address;
+            frame.planes[plane] = static_cast<uint8_t*>(address) + buffer.offsetForPlane(plane);
+        }
+
+        m_frames.push_back(std::move(frame));
+    }
+
+    Logger::info("Video: %ux%u %s at %u fps, %u planes\n", m_width, m_height, m_format == DRM_FORMAT_NV12 ? "NV12" : "YUV420", m_frameRate,
+                 m_frames[0].buffer->planeCount());
+    return true;
+}
+
+bool VideoPlayer::createProgram()
+{
+    const char* vertexShaderSource = "uniform mat4 u_mvp;\n"
+                                     "attribute vec2 position;\n"
+                                     "attribute vec2 texCoord;\n"
+                                     "varying vec2 v_texCoord;\n"
+                                     "\n"
+                                     "void main() {\n"
+                                     "    gl_Position = u_mvp * vec4(position, 0.0, 1.0);\n"
+                                     "    v_texCoord = texCoord;\n"
+                                     "}\n";
+
+    const char* fragmentShaderSource = "#extension GL_OES_EGL_image_external : require\n"
+                                       "precision mediump float;\n"
+                                       "varying vec2 v_texCoord;\n"
+                                       "uniform samplerExternalOES videoSampler;\n"
+                                       "\n"
+                                       "void main() {\n"
+                                       "    gl_FragColor = texture2D(videoSampler, v_texCoord);\n"
+                                       "}\n";
+
+    m_program = m_egl.programCache().createProgram("video composition", vertexShaderSource, fragmentShaderSource);
+    if (!m_program)
+        return false;
+
+    m_positionLocation = glGetAttribLocation(m_program, "position");
+    m_texCoordLocation = glGetAttribLocation(m_program, "texCoord");
+    m_mvpLocation = glGetUniformLocation(m_program, "u_mvp");
+    m_videoSamplerLocation = glGetUniformLocation(m_program, "videoSampler");
+    return true;
+}
+
+void VideoPlayer::decodeFrame(Frame& frame, uint64_t frameNumber)
+{
+    auto& buffer = *frame.buffer;
+    BandwidthScope bandwidthScope(BandwidthCounters::Stage::VideoDecode, uint64_t(m_width) * m_height * 3 / 2);
+
+    // Waits until the GPU is done with the frame, it was composited two window frames ago at the earliest.
+    for (uint32_t plane = 0; plane < buffer.planeCount(); ++plane) {
+        const struct dma_buf_sync syncStart = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+        ioctl(buffer.dmabufFDForPlane(plane), DMA_BUF_IOCTL_SYNC, &syncStart);
+    }
+
+    // Limited range luma ramp moving diagonally, chroma slowly cycling through the hues.
+    for (uint32_t y = 0; y < m_height; ++y) {
+        uint8_t* row = frame.planes[0] + size_t(y) * buffer.strideForPlane(0);
+        const uint32_t phase = y + uint32_t(frameNumber) * 4;
+        for (uint32_t x = 0; x < m_width; ++x)
+            row[x] = uint8_t(16 + (((x + phase) & 0xff) * 219 >> 8));
+    }
+
+    const uint8_t u = uint8_t(128 + ((frameNumber * 2) & 0x7f) - 64);
+    const uint8_t v = uint8_t(128 + 63 - ((frameNumber * 3) & 0x7f));
+    for (uint32_t y = 0; y < m_height / 2; ++y) {
+        if (m_format == DRM_FORMAT_NV12) {
+            uint8_t* row = frame.planes[1] + size_t(y) * buffer.strideForPlane(1);
+            for (uint32_t x = 0; x < m_width / 2; ++x) {
+                row[x * 2] = u;
+                row[x * 2 + 1] = v;
+            }
+        } else {
+            memset(frame.planes[1] + size_t(y) * buffer.strideForPlane(1), u, m_width / 2);
+            memset(frame.planes[2] + size_t(y) * buffer.strideForPlane(2), v, m_width / 2);
+        }
+    }
+
+    for (uint32_t plane = 0; plane < buffer.planeCount(); ++plane) {
+        const struct dma_buf_sync syncEnd = { DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE };
+        ioctl(buffer.dmabufFDForPlane(plane), DMA_BUF_IOCTL_SYNC, &syncEnd);
+    }
+}
+
+void VideoPlayer::update()
+{
+    const int64_t now = getCurrentTimeInNanoSeconds();
+    if (!m_startTime)
+        m_startTime = now;
+
+    const uint64_t frameNumber = uint64_t(now - m_startTime) * m_frameRate / nsPerSecond;
+    if (m_decodedFrames && frameNumber == m_frameNumber)
+        return;
+
+    // Frames that became due and were replaced before a window frame could show them are not decoded.
+    if (m_decodedFrames)
+        m_skippedFrames += frameNumber - m_frameNumber - 1;
+
+    const uint32_t nextFrame = m_decodedFrames ? (m_currentFrame + 1) % frameCount : 0;
+    const int64_t decodeStartTime = getCurrentTimeInNanoSeconds();
+    decodeFrame(m_frames[nextFrame], frameNumber);
+    m_decodeTime += getCurrentTimeInNanoSeconds() - decodeStartTime;
+
+    m_currentFrame = nextFrame;
+    m_frameNumber = frameNumber;
+    ++m_decodedFrames;
+}
+
+void VideoPlayer::composite(const TransformationMatrix& projection, uint32_t screenWidth, uint32_t screenHeight)
+{
+    if (!m_decodedFrames)
+        return;
+
+    // Centered, scaled down to fit the window with the aspect ratio preserved.
+    const float scale = std::min({ 1.0f, float(screenWidth) / float(m_width), float(screenHeight) / float(m_height) });
+    const float width = m_width * scale;
+    const float height = m_height * scale;
+    const float x = (screenWidth - width) / 2.0f;
+    const float y = (screenHeight - height) / 2.0f;
+
+    const GLfloat vertices[] = { x, y, x + width, y, x, y + height, x + width, y + height };
+    static const GLfloat texCoords[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+    glUseProgram(m_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_frames[m_currentFrame].buffer->glTexture());
+    glUniform1i(m_videoSamplerLocation, 0);
+    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, projection.data());
+
+    glVertexAttribPointer(m_positionLocation, 2, GL_FLOAT, GL_FALSE, 0, vertices);
+    glVertexAttribPointer(m_texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
+    glEnableVertexAttribArray(m_positionLocation);
+    glEnableVertexAttribArray(m_texCoordLocation);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableVertexAttribArray(m_positionLocation);
+    glDisableVertexAttribArray(m_texCoordLocation);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+    ++m_compositedFrames;
+
+    // 1.5 bytes of YUV sampled per pixel at 1:1 scale, plus the window buffer write.
+    if (auto* counters = BandwidthCounters::singleton())
+        counters->add(BandwidthCounters::Stage::GPUComposition, uint64_t(width * height) * 3 / 2 + uint64_t(width * height) * sizeof(uint32_t));
+}
+
+void VideoPlayer::report() const
+{
+    if (!m_decodedFrames)
+        return;
+
+    Logger::info("Video: %llu frames decoded (%.2f ms each), %llu skipped, every frame composited %.2f times on average\n",
+                 static_cast<unsigned long long>(m_decodedFrames), double(m_decodeTime) / double(m_decodedFrames) / 1e6,
+                 static_cast<unsigned long long>(m_skippedFrames), double(m_compositedFrames) / double(m_decodedFrames));
+}
@@ -0,0 +1,88 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GLES2/gl2.h>
+
+#include "DMABuffer.h"
+
+class DRM;
+class EGL;
+class GBM;
+class TransformationMatrix;
+
+// --video-width / --video-height: synthetic video, decoded on the CPU at --video-frame-rate into a ring of
+// linear YUV dma-bufs (--video-format), like a software decoder would. The current frame is composited on top
+// of the tiles through a samplerExternalOES, the GPU converts it to RGB.
+class VideoPlayer {
+public:
+    VideoPlayer(const EGL&, uint32_t width, uint32_t height, uint32_t frameRate, uint32_t format);
+    ~VideoPlayer();
+
+    static std::unique_ptr<VideoPlayer> create(const DRM&, const GBM&, const EGL&);
+
+    // Decodes the frame due at the current time, unless it is already the current one.
+    void update();
+    // Draws the current frame centered in the window, scaled down to fit.
+    void composite(const TransformationMatrix& projection, uint32_t screenWidth, uint32_t screenHeight);
+
+    void report() const;
+
+private:
+    static constexpr uint32_t frameCount = 3; // displayed, being decoded and one the GPU may still read
+
+    struct Frame {
+        std::unique_ptr<DMABuffer> buffer;
+        std::array<uint8_t*, DMABuffer::maxBufferPlanes> planes { };
+        std::array<void*, DMABuffer::maxBufferPlanes> mappedAddresses { };
+        std::array<size_t, DMABuffer::maxBufferPlanes> mappedSizes { };
+    };
+
+    bool allocateFrames(const DRM&, const GBM&);
+    bool createProgram();
+    void decodeFrame(Frame&, uint64_t frameNumber);
+
+    const EGL& m_egl;
+    uint32_t m_width { 0 };
+    uint32_t m_height { 0 };
+    uint32_t m_frameRate { 0 };
+    uint32_t m_format { 0 };
+
+    std::vector<Frame> m_frames;
+    uint32_t m_currentFrame { 0 };
+
+    GLuint m_program { 0 };
+    GLint m_positionLocation { -1 };
+    GLint m_texCoordLocation { -1 };
+    GLint m_mvpLocation { -1 };
+    GLint m_videoSamplerLocation { -1 };
+
+    int64_t m_startTime { 0 };
+    uint64_t m_frameNumber { 0 }; // of the current frame
+    uint64_t m_decodedFrames { 0 };
+    uint64_t m_skippedFrames { 0 }; // due while another one was shown, never decoded
+    uint64_t m_compositedFrames { 0 };
+    int64_t m_decodeTime { 0 };
+};
@@ -20,12 +20,15 @@
 #include "Wayland.h"
 
 #include "Application.h"
+#include "DMABufFeedback.h"
 #include "EGL.h"
 #include "Logger.h"
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
 #include "linux-explicit-synchronization-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "xdg-shell-client-protocol.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstring>
@@ -58,6 +61,16 @@ static const struct zwp_linux_dmabuf_v1_listener dmabuf_listener = {
     .modifier = dmabuf_modifiers
 };
 
+static void presentation_clock_id(void* data, struct wp_presentation*, uint32_t clockID)
+{
+    auto& wayland = *reinterpret_cast<Wayland*>(data);
+    wayland.setPresentationClock(static_cast<clockid_t>(clockID));
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = presentation_clock_id
+};
+
 static void registry_global(void* data, struct wl_registry* registry, uint32_t id, const char* interface, uint32_t version)
 {
     auto& wayland = *static_cast<Wayland*>(data);
@@ -70,6 +83,16 @@ static const struct wl_registry_listener registry_listener = {
 };
 /* (end) Registry Listener */
 
+static void initial_sync_done(void* data, struct wl_callback* callback, uint32_t)
+{
+    auto& wayland = *static_cast<Wayland*>(data);
+    wayland.didFinishInitialSync(callback);
+}
+
+static const struct wl_callback_listener initial_sync_listener = {
+    initial_sync_done
+};
+
 /* XDG surface */
 static void xdg_surface_configure(void* data, struct xdg_surface* xdg_surface,
     uint32_t serial)
@@ -83,7 +106,7 @@ const struct xdg_surface_listener xdg_surface_listener = {
 };
 /* (end) XDG surface */
 
-Wayland::Wayland(struct wl_display* display, const DRM& drm, const GBM& gbm, const EGL& egl)
+Wayland::Wayland(struct wl_display* display, const DRM* drm, const GBM* gbm, const EGL* egl)
     : m_wlDisplay(display)
     , m_drm(drm)
     , m_gbm(gbm)
@@ -96,16 +119,31 @@ Wayland::Wayland(struct wl_display* display, const DRM& drm, const GBM& gbm, con
     assert(m_wlRegistry);
 
     wl_registry_add_listener(m_wlRegistry, &registry_listener, this);
-    wl_display_dispatch(m_wlDisplay);
     wl_display_roundtrip(m_wlDisplay);
 
     assert(m_wlCompositor);
     assert(m_xdgWmBase);
 
+    // The events of the bound globals (modifiers, dma-buf feedback, presentation clock) follow the
+    // bind requests. Don't wait for them here, finishInitialization() collects them.
+    m_initialSyncCallback = wl_display_sync(m_wlDisplay);
+    wl_callback_add_listener(m_initialSyncCallback, &initial_sync_listener, this);
+    wl_display_flush(m_wlDisplay);
+
+    if (args.software && !m_wlShm) {
+        Logger::error("Wayland wl_shm not supported, cannot use software composition. Aborting!\n");
+        abort();
+    }
+
+    if (!args.software && !m_zwpLinuxDmabufV1) {
+        Logger::error("Wayland zwp_linux_dmabuf_v1 protocol (version >= 3) not supported, use --software instead. Aborting!\n");
+        abort();
+    }
+
     if (args.explicitSync) {
-        m_useExplicitSync = m_egl.supportsExplicitSync() && m_zwpLinuxExplicitSynchronizationV1;
+        m_useExplicitSync = m_egl->supportsExplicitSync() && m_zwpLinuxExplicitSynchronizationV1;
 
-        if (!m_egl.supportsExplicitSync()) {
+        if (!m_egl->supportsExplicitSync()) {
             Logger::error("EGL does not support the required extension for explicit sync. Aborting!\n");
             abort();
         }
@@ -115,14 +153,61 @@ Wayland::Wayland(struct wl_display* display, const DRM& drm, const GBM& gbm, con
             abort();
         }
     }
+
+    if (args.subsurfaces && !m_wlSubcompositor) {
+        Logger::error("Wayland wl_subcompositor not supported, cannot use subsurfaces. Aborting!\n");
+        abort();
+    }
+
+    if (args.presentationFeedback && !m_wpPresentation) {
+        Logger::error("Wayland wp_presentation protocol not supported, cannot use presentation feedback. Aborting!\n");
+        abort();
+    }
 }
 
 Wayland::~Wayland()
 {
+    if (m_initialSyncCallback)
+        wl_callback_destroy(m_initialSyncCallback);
+
+    m_defaultDMABufFeedback.reset();
+
+    if (m_wlShm)
+        wl_shm_destroy(m_wlShm);
+
     if (m_modifiers)
         free(m_modifiers);
 }
 
+void Wayland::finishInitialization()
+{
+    while (m_initialSyncCallback) {
+        if (wl_display_dispatch(m_wlDisplay) == -1)
+            return;
+    }
+
+    if (m_defaultDMABufFeedback) {
+        while (!m_defaultDMABufFeedback->isDone()) {
+            if (wl_display_dispatch(m_wlDisplay) == -1)
+                break;
+        }
+
+        for (auto& tranche : m_defaultDMABufFeedback->tranches()) {
+            for (auto& [format, modifier] : tranche.formats)
+                setDMABufModifiers(format, modifier);
+        }
+
+        m_defaultDMABufFeedback->report("Default");
+    }
+}
+
+void Wayland::didFinishInitialSync(struct wl_callback* callback)
+{
+    assert(callback == m_initialSyncCallback);
+    wl_callback_destroy(callback);
+    m_initialSyncCallback = nullptr;
+}
+
 void Wayland::setDMABufModifiers(uint32_t format, uint64_t modifier)
 {
     if (format != m_format)
@@ -130,7 +215,7 @@ void Wayland::setDMABufModifiers(uint32_t format, uint64_t modifier)
 
     m_formatSupported = true;
 
-    if (modifier != DRM_FORMAT_MOD_INVALID) {
+    if (modifier != DRM_FORMAT_MOD_INVALID && std::find(m_modifiers, m_modifiers + m_modifiersCount, modifier) == m_modifiers + m_modifiersCount) {
         ++m_modifiersCount;
         m_modifiers = static_cast<uint64_t*>(realloc(m_modifiers, m_modifiersCount * sizeof(*m_modifiers)));
         m_modifiers[m_modifiersCount - 1] = modifier;
@@ -142,6 +227,12 @@ void Wayland::registerInterface(struct wl_registry* registry, uint32_t id, const
     if (!strcmp(interface, wl_compositor_interface.name)) {
         Logger::info("Registering interface (%s) ...\n", interface);
         m_wlCompositor = static_cast<struct wl_compositor*>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+    } else if (!strcmp(interface, wl_subcompositor_interface.name)) {
+        Logger::info("Registering interface (%s) ...\n", interface);
+        m_wlSubcompositor = static_cast<struct wl_subcompositor*>(wl_registry_bind(registry, id, &wl_subcompositor_interface, 1));
+    } else if (!strcmp(interface, wl_shm_interface.name)) {
+        Logger::info("Registering interface (%s) ...\n", interface);
+        m_wlShm = static_cast<struct wl_shm*>(wl_registry_bind(registry, id, &wl_shm_interface, 1));
     } else if (!strcmp(interface, xdg_wm_base_interface.name)) {
         Logger::info("Registering interface (%s) ...\n", interface);
         m_xdgWmBase = static_cast<struct xdg_wm_base*>(wl_registry_bind(registry, id, &xdg_wm_base_interface, 1));
@@ -151,16 +242,24 @@ void Wayland::registerInterface(struct wl_registry* registry, uint32_t id, const
             Logger::error("Failed to register interface (%s), version: %i < 3.\n", interface, version);
             return;
         }
+        // Version 4 replaces the format/modifier events with the feedback objects.
         Logger::info("Registering interface (%s) ...\n", interface);
-        m_zwpLinuxDmabufV1 = static_cast<struct zwp_linux_dmabuf_v1*>(wl_registry_bind(registry, id, &zwp_linux_dmabuf_v1_interface, 3));
+        m_zwpLinuxDmabufV1Version = std::min(version, 4u);
+        m_zwpLinuxDmabufV1 = static_cast<struct zwp_linux_dmabuf_v1*>(wl_registry_bind(registry, id, &zwp_linux_dmabuf_v1_interface, m_zwpLinuxDmabufV1Version));
         zwp_linux_dmabuf_v1_add_listener(m_zwpLinuxDmabufV1, &dmabuf_listener, this);
+        if (m_zwpLinuxDmabufV1Version >= 4)
+            m_defaultDMABufFeedback = DMABufFeedback::create(zwp_linux_dmabuf_v1_get_default_feedback(m_zwpLinuxDmabufV1));
     } else if (!strcmp(interface, "zwp_linux_explicit_synchronization_v1")) {
         Logger::info("Registering interface (%s) ...\n", interface);
         m_zwpLinuxExplicitSynchronizationV1 = static_cast<struct zwp_linux_explicit_synchronization_v1*>(wl_registry_bind(registry, id, &zwp_linux_explicit_synchronization_v1_interface, 1));
+    } else if (!strcmp(interface, wp_presentation_interface.name)) {
+        Logger::info("Registering interface (%s) ...\n", interface);
+        m_wpPresentation = static_cast<struct wp_presentation*>(wl_registry_bind(registry, id, &wp_presentation_interface, 1));
+        wp_presentation_add_listener(m_wpPresentation, &presentation_listener, this);
     }
 }
 
-std::unique_ptr<Wayland> Wayland::create(const DRM& drm, const GBM& gbm, const EGL& egl)
+std::unique_ptr<Wayland> Wayland::create(const DRM* drm, const GBM* gbm, const EGL* egl)
 {
     Logger::info("Initializing Wayland...\n");
 
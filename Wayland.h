@@ -19,53 +19,79 @@
 
 #pragma once
 
+#include <ctime>
 #include <memory>
+#include <vector>
 
 #include <wayland-client.h>
 #include <wayland-egl.h>
 
+class DMABufFeedback;
 class DRM;
 class EGL;
 class GBM;
 
+struct wp_presentation;
 struct zwp_linux_dmabuf_v1;
 
 class Wayland {
 public:
-    Wayland(struct wl_display*, const DRM&, const GBM&, const EGL&);
+    Wayland(struct wl_display*, const DRM*, const GBM*, const EGL*);
     ~Wayland();
 
-    static std::unique_ptr<Wayland> create(const DRM&, const GBM&, const EGL&);
+    // DRM, GBM and EGL are null in --software mode.
+    static std::unique_ptr<Wayland> create(const DRM*, const GBM*, const EGL*);
 
-    const DRM& drm() const { return m_drm; }
-    const GBM& gbm() const { return m_gbm; }
-    const EGL& egl() const { return m_egl; }
+    // Binding the globals only needs one roundtrip. Their initial events are received here, so
+    // that the caller can do independent work while the compositor answers.
+    void finishInitialization();
+    void didFinishInitialSync(struct wl_callback*);
+
+    const DRM& drm() const { return *m_drm; }
+    const GBM& gbm() const { return *m_gbm; }
+    const EGL& egl() const { return *m_egl; }
 
     struct wl_compositor* compositor() const { return m_wlCompositor; }
+    struct wl_subcompositor* subcompositor() const { return m_wlSubcompositor; }
     struct wl_display* display() const { return m_wlDisplay; }
+    struct wl_shm* shm() const { return m_wlShm; }
     struct xdg_wm_base* xdgWmBase() const { return m_xdgWmBase; }
     struct zwp_linux_dmabuf_v1* zwpLinuxDmabufV1() const { return m_zwpLinuxDmabufV1; }
+    uint32_t zwpLinuxDmabufV1Version() const { return m_zwpLinuxDmabufV1Version; }
+    const DMABufFeedback* defaultDMABufFeedback() const { return m_defaultDMABufFeedback.get(); }
     struct zwp_linux_explicit_synchronization_v1* zwpLinuxExplicitSynchronizationV1() const { return m_zwpLinuxExplicitSynchronizationV1; }
+    struct wp_presentation* wpPresentation() const { return m_wpPresentation; }
+
+    clockid_t presentationClock() const { return m_presentationClock; }
+    void setPresentationClock(clockid_t clock) { m_presentationClock = clock; }
 
     uint32_t format() const { return m_format; }
     bool useExplicitSync() const { return m_useExplicitSync; }
 
+    std::vector<uint64_t> supportedModifiers() const { return std::vector<uint64_t>(m_modifiers, m_modifiers + m_modifiersCount); }
     void setDMABufModifiers(uint32_t format, uint64_t modifier);
     void registerInterface(struct wl_registry*, uint32_t id, const char* interface, uint32_t version);
 
 private:
-    const DRM& m_drm;
-    const GBM& m_gbm;
-    const EGL& m_egl;
+    const DRM* m_drm { nullptr };
+    const GBM* m_gbm { nullptr };
+    const EGL* m_egl { nullptr };
 
     struct wl_display* m_wlDisplay { nullptr };
     struct wl_registry* m_wlRegistry { nullptr };
+    struct wl_callback* m_initialSyncCallback { nullptr };
 
     struct wl_compositor* m_wlCompositor { nullptr };
+    struct wl_subcompositor* m_wlSubcompositor { nullptr };
+    struct wl_shm* m_wlShm { nullptr };
     struct xdg_wm_base* m_xdgWmBase { nullptr };
     struct zwp_linux_dmabuf_v1* m_zwpLinuxDmabufV1 { nullptr };
+    uint32_t m_zwpLinuxDmabufV1Version { 0 };
+    std::unique_ptr<DMABufFeedback> m_defaultDMABufFeedback;
     struct zwp_linux_explicit_synchronization_v1* m_zwpLinuxExplicitSynchronizationV1 { nullptr };
+    struct wp_presentation* m_wpPresentation { nullptr };
 
+    clockid_t m_presentationClock { CLOCK_MONOTONIC };
     bool m_useExplicitSync { false };
     bool m_formatSupported { false };
     uint32_t m_format { 0 };
@@ -0,0 +1,34 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "WaylandBuffer.h"
+
+#include <wayland-client.h>
+
+WaylandBuffer::WaylandBuffer(uint32_t width, uint32_t height)
+    : m_width(width)
+    , m_height(height)
+{
+}
+
+WaylandBuffer::~WaylandBuffer()
+{
+    if (m_wlBuffer)
+        wl_buffer_destroy(m_wlBuffer);
+}
@@ -0,0 +1,59 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+struct wl_buffer;
+struct zwp_linux_buffer_release_v1;
+
+// State shared by all buffers that can be attached to a wl_surface (dma-buf or wl_shm backed).
+class WaylandBuffer {
+public:
+    WaylandBuffer(uint32_t width, uint32_t height);
+    virtual ~WaylandBuffer();
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+
+    // Memory used by the color planes, without auxiliary (depth/stencil) buffers.
+    virtual uint64_t colorBufferSize() const = 0;
+
+    struct wl_buffer* wlBuffer() const { return m_wlBuffer; }
+    void setWaylandBuffer(struct wl_buffer* buffer) { m_wlBuffer = buffer; }
+
+    struct zwp_linux_buffer_release_v1* zwpLinuxBufferReleaseV1() const { return m_zwpLinuxBufferReleaseV1; }
+    void setBufferRelease(struct zwp_linux_buffer_release_v1* release) { m_zwpLinuxBufferReleaseV1 = release; }
+
+    int32_t releaseFenceFD() const { return m_releaseFenceFD; }
+    void setReleaseFenceFD(int32_t fd) { m_releaseFenceFD = fd; }
+
+    bool isInUse() const { return m_isInUse; }
+    void setIsInUse(bool isInUse) { m_isInUse = isInUse; }
+
+protected:
+    uint32_t m_width { 0 };
+    uint32_t m_height { 0 };
+
+    struct wl_buffer* m_wlBuffer { nullptr };
+    struct zwp_linux_buffer_release_v1* m_zwpLinuxBufferReleaseV1 { nullptr };
+    int32_t m_releaseFenceFD { -1 };
+    bool m_isInUse { false };
+};
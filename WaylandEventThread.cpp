@@ -0,0 +1,128 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "WaylandEventThread.h"
+
+#include "Logger.h"
+
+#include <cassert>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+WaylandEventThread::WaylandEventThread(struct wl_display* display)
+    : m_display(display)
+{
+    m_queue = wl_display_create_queue(m_display);
+    assert(m_queue);
+
+    m_notifyFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_stopFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    assert(m_notifyFD >= 0 && m_stopFD >= 0);
+}
+
+WaylandEventThread::~WaylandEventThread()
+{
+    stop();
+
+    close(m_notifyFD);
+    close(m_stopFD);
+    wl_event_queue_destroy(m_queue);
+}
+
+std::unique_ptr<WaylandEventThread> WaylandEventThread::create(struct wl_display* display)
+{
+    return std::make_unique<WaylandEventThread>(display);
+}
+
+void WaylandEventThread::start()
+{
+    assert(!m_running);
+    m_running = true;
+    m_thread = std::thread([this] { run(); });
+}
+
+void WaylandEventThread::stop()
+{
+    // The thread may have stopped on its own after a read error, join it anyway.
+    if (!m_thread.joinable())
+        return;
+
+    m_running = false;
+
+    uint64_t value = 1;
+    write(m_stopFD, &value, sizeof(value));
+    m_thread.join();
+}
+
+void WaylandEventThread::post(const WaylandEvent& event)
+{
+    // The render thread drains the queue on every wakeup, so it can only be full if
+    // the render thread is stuck -- yield until it catches up instead of dropping events.
+    while (!m_events.push(event)) {
+        notify();
+        std::this_thread::yield();
+    }
+}
+
+void WaylandEventThread::notify()
+{
+    uint64_t value = 1;
+    write(m_notifyFD, &value, sizeof(value));
+}
+
+void WaylandEventThread::acknowledgeNotification()
+{
+    uint64_t value;
+    read(m_notifyFD, &value, sizeof(value));
+}
+
+void WaylandEventThread::run()
+{
+    while (m_running) {
+        while (wl_display_prepare_read_queue(m_display, m_queue) != 0)
+            wl_display_dispatch_queue_pending(m_display, m_queue);
+
+        wl_display_flush(m_display);
+
+        struct pollfd pollFDs[2] = {
+            { wl_display_get_fd(m_display), POLLIN, 0 },
+            { m_stopFD, POLLIN, 0 }
+        };
+
+        if (poll(pollFDs, 2, -1) <= 0 || !(pollFDs[0].revents & POLLIN)) {
+            wl_display_cancel_read(m_display);
+            continue;
+        }
+
+        if (wl_display_read_events(m_display) == -1) {
+            Logger::error("Failed to read Wayland events, stopping event thread.\n");
+            m_running = false;
+            notify();
+            return;
+        }
+
+        wl_display_dispatch_queue_pending(m_display, m_queue);
+
+        // Events for the default queue have been read as well, the render thread dispatches them.
+        notify();
+    }
+}
@@ -0,0 +1,126 @@
+/* wpe-testbed: WPE/WebKit painting/composition simulation
+ *
+ * Copyright (C) 2025 Igalia S.L.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+struct wl_display;
+struct wl_event_queue;
+
+// Single-producer / single-consumer lock-free ring buffer.
+template<typename T, uint32_t capacity>
+class SPSCQueue {
+    static_assert(!(capacity & (capacity - 1)), "capacity must be a power of two");
+
+public:
+    bool push(const T& value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == capacity)
+            return false;
+
+        m_values[tail & (capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        value = m_values[head & (capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, capacity> m_values;
+    alignas(64) std::atomic<uint32_t> m_head { 0 };
+    alignas(64) std::atomic<uint32_t> m_tail { 0 };
+};
+
+// Events received on the private queue, forwarded to the render thread.
+struct WaylandEvent {
+    enum class Type : uint8_t {
+        BufferRelease,
+        FencedBufferRelease,
+        ImmediateBufferRelease,
+        FrameDone,
+        Presented,
+        Discarded
+    };
+
+    Type type { Type::BufferRelease };
+    void* object { nullptr }; // wl_buffer, zwp_linux_buffer_release_v1, wl_callback or wp_presentation_feedback
+    void* data { nullptr };
+    int32_t fenceFD { -1 };
+    uint32_t refresh { 0 };
+    uint32_t flags { 0 };
+    uint64_t sequence { 0 };
+    int64_t presentationTime { 0 };
+};
+
+// Reads the Wayland socket on a dedicated thread, using wl_display_prepare_read_queue()
+// and wl_display_read_events(), and dispatches the private event queue. The listeners
+// of the proxies assigned to that queue post WaylandEvents, which the render thread
+// consumes after being woken up through notifyFD().
+class WaylandEventThread {
+public:
+    explicit WaylandEventThread(struct wl_display*);
+    ~WaylandEventThread();
+
+    static std::unique_ptr<WaylandEventThread> create(struct wl_display*);
+
+    static constexpr uint32_t queueCapacity = 256;
+
+    struct wl_event_queue* queue() const { return m_queue; }
+    int notifyFD() const { return m_notifyFD; }
+    bool isRunning() const { return m_running; }
+
+    void start();
+    void stop();
+
+    // Called from the event thread (listeners).
+    void post(const WaylandEvent&);
+
+    // Called from the render thread.
+    bool pop(WaylandEvent& event) { return m_events.pop(event); }
+    void acknowledgeNotification();
+
+private:
+    void run();
+    void notify();
+
+    struct wl_display* m_display { nullptr };
+    struct wl_event_queue* m_queue { nullptr };
+
+    int m_notifyFD { -1 };
+    int m_stopFD { -1 };
+    std::atomic<bool> m_running { false };
+    std::thread m_thread;
+
+    SPSCQueue<WaylandEvent, queueCapacity> m_events;
+};
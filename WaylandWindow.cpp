@@ -20,19 +20,39 @@
 #include "WaylandWindow.h"
 
 #include "Application.h"
+#include "ContentSource.h"
+#include "DMABufFeedback.h"
 #include "DMABuffer.h"
 #include "EGL.h"
+#include "FrameScheduler.h"
 #include "GBM.h"
+#include "GPUTimer.h"
 #include "Logger.h"
+#include "PerfCounters.h"
+#include "ProgramCache.h"
+#include "SceneRenderer.h"
+#include "ShmBuffer.h"
+#include "StartupProfiler.h"
 #include "TileRenderer.h"
+#include "Utilities.h"
+#include "VideoPlayer.h"
 #include "Wayland.h"
+#include "WaylandEventThread.h"
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
 #include "linux-explicit-synchronization-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "xdg-shell-client-protocol.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 
+#include <drm_fourcc.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 
 /* XDG surface */
@@ -81,35 +101,23 @@ static const struct xdg_toplevel_listener xdg_toplevel_listener = {
 
 static void buffer_release(void* data, struct wl_buffer* buffer)
 {
-    auto& dmaBuffer = *static_cast<DMABuffer*>(data);
-    dmaBuffer.setIsInUse(false);
+    auto& waylandBuffer = *static_cast<WaylandBuffer*>(data);
+    waylandBuffer.setIsInUse(false);
 }
 
 static const struct wl_buffer_listener buffer_listener = {
     buffer_release
 };
 
-static void create_succeeded(void* data, struct zwp_linux_buffer_params_v1* params, struct wl_buffer* new_buffer)
+static void create_failed(void*, struct zwp_linux_buffer_params_v1*)
 {
-    auto& dmaBuffer = *static_cast<DMABuffer*>(data);
-    dmaBuffer.setWaylandBuffer(new_buffer);
-
-    auto& args = Application::commandLineArguments();
-    if (!args.explicitSync)
-        wl_buffer_add_listener(new_buffer, &buffer_listener, data);
-
-    zwp_linux_buffer_params_v1_destroy(params);
-}
-
-static void create_failed(void* data, struct zwp_linux_buffer_params_v1* params)
-{
-    auto& dmaBuffer = *static_cast<DMABuffer*>(data);
-    zwp_linux_buffer_params_v1_destroy(params);
-    Logger::error("zwp_linux_buffer_params_v1.create failed.\n");
+    // The wl_buffer returned by create_immed is inert, there is nothing to fall back to.
+    Logger::error("zwp_linux_buffer_params_v1.create_immed failed. Aborting!\n");
+    abort();
 }
 
 static const struct zwp_linux_buffer_params_v1_listener params_listener = {
-    .created = create_succeeded,
+    .created = nullptr, // only sent for zwp_linux_buffer_params_v1.create
     .failed = create_failed
 };
 
@@ -125,28 +133,28 @@ static const struct wl_callback_listener frame_listener = {
 
 static void buffer_fenced_release(void* data, struct zwp_linux_buffer_release_v1* release, int32_t fence)
 {
-    auto& dmaBuffer = *static_cast<DMABuffer*>(data);
+    auto& waylandBuffer = *static_cast<WaylandBuffer*>(data);
 
-    assert(release == dmaBuffer.zwpLinuxBufferReleaseV1());
-    assert(dmaBuffer.releaseFenceFD() == -1);
+    assert(release == waylandBuffer.zwpLinuxBufferReleaseV1());
+    assert(waylandBuffer.releaseFenceFD() == -1);
 
-    dmaBuffer.setIsInUse(false);
-    dmaBuffer.setReleaseFenceFD(fence);
+    waylandBuffer.setIsInUse(false);
+    waylandBuffer.setReleaseFenceFD(fence);
 
-    zwp_linux_buffer_release_v1_destroy(dmaBuffer.zwpLinuxBufferReleaseV1());
-    dmaBuffer.setBufferRelease(nullptr);
+    zwp_linux_buffer_release_v1_destroy(waylandBuffer.zwpLinuxBufferReleaseV1());
+    waylandBuffer.setBufferRelease(nullptr);
 }
 
 static void buffer_immediate_release(void* data, struct zwp_linux_buffer_release_v1* release)
 {
-    auto& dmaBuffer = *static_cast<DMABuffer*>(data);
+    auto& waylandBuffer = *static_cast<WaylandBuffer*>(data);
 
-    assert(release == dmaBuffer.zwpLinuxBufferReleaseV1());
-    assert(dmaBuffer.releaseFenceFD() == -1);
+    assert(release == waylandBuffer.zwpLinuxBufferReleaseV1());
+    assert(waylandBuffer.releaseFenceFD() == -1);
 
-    dmaBuffer.setIsInUse(false);
-    zwp_linux_buffer_release_v1_destroy(dmaBuffer.zwpLinuxBufferReleaseV1());
-    dmaBuffer.setBufferRelease(nullptr);
+    waylandBuffer.setIsInUse(false);
+    zwp_linux_buffer_release_v1_destroy(waylandBuffer.zwpLinuxBufferReleaseV1());
+    waylandBuffer.setBufferRelease(nullptr);
 }
 
 static const struct zwp_linux_buffer_release_v1_listener buffer_release_listener = {
@@ -154,60 +162,313 @@ static const struct zwp_linux_buffer_release_v1_listener buffer_release_listener
     buffer_immediate_release,
 };
 
-WaylandWindow::WaylandWindow(const Wayland& wayland, std::unique_ptr<TileRenderer>&& tileRenderer)
+struct PresentationFeedback {
+    WaylandWindow& waylandWindow;
+    WaylandWindow::FrameTiming timing;
+};
+
+static void feedback_sync_output(void*, struct wp_presentation_feedback*, struct wl_output*)
+{
+}
+
+static void didReceivePresentationFeedback(PresentationFeedback* presentationFeedback, struct wp_presentation_feedback* feedback, int64_t presentationTime, uint32_t refresh, uint64_t sequence, uint32_t flags)
+{
+    presentationFeedback->waylandWindow.didPresentFrame(presentationFeedback->timing, presentationTime, refresh, sequence, flags);
+
+    wp_presentation_feedback_destroy(feedback);
+    delete presentationFeedback;
+}
+
+static void didDiscardPresentationFeedback(PresentationFeedback* presentationFeedback, struct wp_presentation_feedback* feedback)
+{
+    presentationFeedback->waylandWindow.didDiscardFrame();
+
+    wp_presentation_feedback_destroy(feedback);
+    delete presentationFeedback;
+}
+
+static void feedback_presented(void* data, struct wp_presentation_feedback* feedback, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+                               uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+{
+    const int64_t seconds = (static_cast<int64_t>(tv_sec_hi) << 32) + tv_sec_lo;
+    const uint64_t sequence = (static_cast<uint64_t>(seq_hi) << 32) + seq_lo;
+    didReceivePresentationFeedback(static_cast<PresentationFeedback*>(data), feedback, seconds * nsPerSecond + tv_nsec, refresh, sequence, flags);
+}
+
+static void feedback_discarded(void* data, struct wp_presentation_feedback* feedback)
+{
+    didDiscardPresentationFeedback(static_cast<PresentationFeedback*>(data), feedback);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+    .sync_output = feedback_sync_output,
+    .presented = feedback_presented,
+    .discarded = feedback_discarded
+};
+
+/* Event thread: the listeners of the proxies on the private queue only forward the events to the render thread. */
+static void forward_buffer_release(void* data, struct wl_buffer* buffer)
+{
+    auto& waylandWindow = *static_cast<WaylandWindow*>(data);
+    waylandWindow.postEvent({ .type = WaylandEvent::Type::BufferRelease, .object = buffer });
+}
+
+static const struct wl_buffer_listener forward_buffer_listener = {
+    forward_buffer_release
+};
+
+static void forward_frame_done(void* data, struct wl_callback* callback, uint32_t)
+{
+    auto& waylandWindow = *static_cast<WaylandWindow*>(data);
+    waylandWindow.postEvent({ .type = WaylandEvent::Type::FrameDone, .object = callback });
+}
+
+static const struct wl_callback_listener forward_frame_listener = {
+    forward_frame_done
+};
+
+static void forward_buffer_fenced_release(void* data, struct zwp_linux_buffer_release_v1* release, int32_t fence)
+{
+    auto& waylandWindow = *static_cast<WaylandWindow*>(data);
+    waylandWindow.postEvent({ .type = WaylandEvent::Type::FencedBufferRelease, .object = release, .fenceFD = fence });
+}
+
+static void forward_buffer_immediate_release(void* data, struct zwp_linux_buffer_release_v1* release)
+{
+    auto& waylandWindow = *static_cast<WaylandWindow*>(data);
+    waylandWindow.postEvent({ .type = WaylandEvent::Type::ImmediateBufferRelease, .object = release });
+}
+
+static const struct zwp_linux_buffer_release_v1_listener forward_buffer_release_listener = {
+    forward_buffer_fenced_release,
+    forward_buffer_immediate_release,
+};
+
+static void forward_feedback_presented(void* data, struct wp_presentation_feedback* feedback, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+                                       uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+{
+    auto* presentationFeedback = static_cast<PresentationFeedback*>(data);
+
+    const int64_t seconds = (static_cast<int64_t>(tv_sec_hi) << 32) + tv_sec_lo;
+    presentationFeedback->waylandWindow.postEvent({ .type = WaylandEvent::Type::Presented, .object = feedback, .data = presentationFeedback, .refresh = refresh, .flags = flags,
+                                                    .sequence = (static_cast<uint64_t>(seq_hi) << 32) + seq_lo, .presentationTime = seconds * nsPerSecond + tv_nsec });
+}
+
+static void forward_feedback_discarded(void* data, struct wp_presentation_feedback* feedback)
+{
+    auto* presentationFeedback = static_cast<PresentationFeedback*>(data);
+    presentationFeedback->waylandWindow.postEvent({ .type = WaylandEvent::Type::Discarded, .object = feedback, .data = presentationFeedback });
+}
+
+static const struct wp_presentation_feedback_listener forward_feedback_listener = {
+    .sync_output = feedback_sync_output,
+    .presented = forward_feedback_presented,
+    .discarded = forward_feedback_discarded
+};
+/* (end) Event thread */
+
+WaylandWindow::WaylandWindow(const Wayland& wayland)
     : m_wayland(wayland)
-    , m_tileRenderer(std::move(tileRenderer))
 {
+    auto& args = Application::commandLineArguments();
+    if (args.eventThread)
+        m_eventThread = WaylandEventThread::create(m_wayland.display());
+
     m_statistics.initialize();
 }
 
 WaylandWindow::~WaylandWindow()
 {
+    for (auto* params : m_bufferParams)
+        zwp_linux_buffer_params_v1_destroy(params);
+
+    if (!m_eventThread)
+        return;
+
+    m_eventThread->stop();
+
+    if (m_wpPresentationWrapper)
+        wl_proxy_wrapper_destroy(m_wpPresentationWrapper);
+    if (m_zwpLinuxSurfaceSynchronizationV1Wrapper)
+        wl_proxy_wrapper_destroy(m_zwpLinuxSurfaceSynchronizationV1Wrapper);
+    wl_proxy_wrapper_destroy(m_wlSurfaceWrapper);
+    close(m_epollFD);
 }
 
-std::unique_ptr<WaylandWindow> WaylandWindow::create(const Wayland& wayland, std::unique_ptr<TileRenderer>&& tileRenderer)
+std::unique_ptr<WaylandWindow> WaylandWindow::create(const Wayland& wayland)
 {
-    auto waylandWindow = std::make_unique<WaylandWindow>(wayland, std::move(tileRenderer));
+    auto waylandWindow = std::make_unique<WaylandWindow>(wayland);
     assert(waylandWindow->m_waitForConfigure);
     waylandWindow->createSurface();
-    assert(!waylandWindow->m_waitForConfigure);
-    if (!waylandWindow->createBuffers())
-        return nullptr;
     return waylandWindow;
 }
 
-bool WaylandWindow::dmaBufferAssignmentFinished() const
+bool WaylandWindow::initialize(std::unique_ptr<TileRenderer>&& tileRenderer)
 {
-    for (uint32_t i = 0; i < numBuffers; ++i) {
-        if (!m_buffers[i]->wlBuffer())
-            return false;
-    }
+    m_tileRenderer = std::move(tileRenderer);
+    return initializeWindow();
+}
 
+bool WaylandWindow::initialize(std::unique_ptr<SceneRenderer>&& sceneRenderer)
+{
+    m_sceneRenderer = std::move(sceneRenderer);
+    return initializeWindow();
+}
+
+bool WaylandWindow::initializeWindow()
+{
+    auto& args = Application::commandLineArguments();
+
+    // Wayland::finishInitialization() received the presentation clock.
+    if (args.deadlineScheduling)
+        m_frameScheduler = std::make_unique<FrameScheduler>(m_wayland.presentationClock(), static_cast<int64_t>(args.deadlineMargin) * (nsPerSecond / usPerSecond));
+
+    waitForConfigure();
+    assert(!m_waitForConfigure);
+    if (m_sceneRenderer)
+        m_sceneRenderer->initialize(m_width, m_height);
+    else
+        m_tileRenderer->initialize(m_width, m_height);
+    StartupProfiler::markPhase("window configure");
+
+    if (!createBuffers())
+        return false;
+    if (args.subsurfaces && !createSubsurfaces())
+        return false;
+    StartupProfiler::markPhase("window buffers");
+
+    if (m_eventThread)
+        startEventThread();
     return true;
 }
 
+void WaylandWindow::createWaylandBuffer(DMABuffer& dmaBuffer)
+{
+    struct zwp_linux_buffer_params_v1* params = zwp_linux_dmabuf_v1_create_params(m_wayland.zwpLinuxDmabufV1());
+    for (uint32_t i = 0; i < dmaBuffer.planeCount(); ++i) {
+        auto modifier = dmaBuffer.modifier();
+        zwp_linux_buffer_params_v1_add(params, dmaBuffer.dmabufFDForPlane(i), i, dmaBuffer.offsetForPlane(i), dmaBuffer.strideForPlane(i), modifier >> 32, modifier & 0xffffffff);
+    }
+
+    // create_immed: the wl_buffer can be used right away, instead of waiting a roundtrip for every buffer. An
+    // invalid buffer is reported asynchronously, keep the params object alive to receive the failed event.
+    zwp_linux_buffer_params_v1_add_listener(params, &params_listener, nullptr);
+    auto* buffer = zwp_linux_buffer_params_v1_create_immed(params, dmaBuffer.width(), dmaBuffer.height(), dmaBuffer.format(), 0);
+    m_bufferParams.push_back(params);
+
+    dmaBuffer.setWaylandBuffer(buffer);
+
+    auto& args = Application::commandLineArguments();
+    // In --event-thread mode the listener is installed once the buffer is moved to the private queue.
+    if (!args.explicitSync && !args.eventThread)
+        wl_buffer_add_listener(buffer, &buffer_listener, static_cast<WaylandBuffer*>(&dmaBuffer));
+}
+
+std::unique_ptr<DMABuffer> WaylandWindow::createWindowBuffer(uint32_t index)
+{
+    auto& args = Application::commandLineArguments();
+    const auto format = m_wayland.format();
+
+    if (args.windowBufferModifier != BufferModifier::Auto)
+        return DMABuffer::create(DMABuffer::Role::WindowBuffer, m_wayland.drm(), m_wayland.gbm(), m_wayland.egl(), format, m_width, m_height);
+
+    // Only modifiers EGL can render to qualify. Without the EGL extension, trust the compositor.
+    auto renderableModifiers = m_wayland.egl().renderableModifiers(format);
+    auto renderableSubset = [&](std::vector<uint64_t> modifiers) {
+        if (renderableModifiers.empty())
+            return modifiers;
+
+        std::erase_if(modifiers, [&](uint64_t modifier) {
+            return std::find(renderableModifiers.begin(), renderableModifiers.end(), modifier) == renderableModifiers.end();
+        });
+        return modifiers;
+    };
+
+    // Walk the feedback tranches in compositor preference order, the scanout tranche usually comes first.
+    auto* feedback = m_surfaceDMABufFeedback ? m_surfaceDMABufFeedback.get() : m_wayland.defaultDMABufFeedback();
+    if (feedback) {
+        for (uint32_t tranche = 0; tranche < feedback->tranches().size(); ++tranche) {
+            auto modifiers = renderableSubset(feedback->modifiersForFormat(tranche, format));
+            if (modifiers.empty())
+                continue;
+
+            auto dmaBuffer = DMABuffer::create(DMABuffer::Role::WindowBuffer, m_wayland.drm(), m_wayland.gbm(), m_wayland.egl(), format, m_width, m_height, modifiers);
+            if (!dmaBuffer)
+                continue;
+
+            auto landedTranche = feedback->trancheForBuffer(format, dmaBuffer->modifier()).value_or(tranche);
+            auto& trancheInfo = feedback->tranches()[landedTranche];
+            Logger::info("Window buffer %u: modifier 0x%016llx, tranche %u (target device %u:%u%s)\n", index,
+                         static_cast<unsigned long long>(dmaBuffer->modifier()), landedTranche,
+                         major(trancheInfo.targetDevice), minor(trancheInfo.targetDevice), trancheInfo.scanout ? ", scanout" : "");
+            return dmaBuffer;
+        }
+    } else {
+        auto modifiers = renderableSubset(m_wayland.supportedModifiers());
+        if (!modifiers.empty()) {
+            if (auto dmaBuffer = DMABuffer::create(DMABuffer::Role::WindowBuffer, m_wayland.drm(), m_wayland.gbm(), m_wayland.egl(), format, m_width, m_height, modifiers)) {
+                Logger::info("Window buffer %u: modifier 0x%016llx (no dma-buf feedback, linux-dmabuf v%u)\n", index,
+                             static_cast<unsigned long long>(dmaBuffer->modifier()), m_wayland.zwpLinuxDmabufV1Version());
+                return dmaBuffer;
+            }
+        }
+    }
+
+    Logger::info("Window buffer %u: no common modifier between the compositor and EGL, falling back to linear\n", index);
+    return DMABuffer::create(DMABuffer::Role::WindowBuffer, m_wayland.drm(), m_wayland.gbm(), m_wayland.egl(), format, m_width, m_height, { DRM_FORMAT_MOD_LINEAR });
+}
+
+std::unique_ptr<ShmBuffer> WaylandWindow::createShmWindowBuffer()
+{
+    auto& args = Application::commandLineArguments();
+    auto shmBuffer = ShmBuffer::create(m_wayland.shm(), args.opaque ? WL_SHM_FORMAT_XRGB8888 : WL_SHM_FORMAT_ARGB8888, m_width, m_height);
+    if (!shmBuffer)
+        return nullptr;
+
+    // In --event-thread mode the listener is installed once the buffer is moved to the private queue.
+    if (!args.eventThread)
+        wl_buffer_add_listener(shmBuffer->wlBuffer(), &buffer_listener, static_cast<WaylandBuffer*>(shmBuffer.get()));
+    return shmBuffer;
+}
+
+DMABuffer& WaylandWindow::dmaBuffer(uint32_t bufferIndex) const
+{
+    assert(!Application::commandLineArguments().software);
+    return static_cast<DMABuffer&>(*m_buffers[bufferIndex]);
+}
+
+ShmBuffer& WaylandWindow::shmBuffer(uint32_t bufferIndex) const
+{
+    assert(Application::commandLineArguments().software);
+    return static_cast<ShmBuffer&>(*m_buffers[bufferIndex]);
+}
+
 bool WaylandWindow::createBuffers()
 {
     auto& args = Application::commandLineArguments();
-    for (uint32_t i = 0; i < numBuffers; ++i) {
-        auto dmaBuffer = DMABuffer::create(DMABuffer::Role::WindowBuffer, m_wayland.drm(), m_wayland.gbm(), m_wayland.egl(), m_wayland.format(), m_width, m_height);
-        if (!dmaBuffer)
-            return false;
 
-        struct zwp_linux_buffer_params_v1* params = zwp_linux_dmabuf_v1_create_params(m_wayland.zwpLinuxDmabufV1());
-        for (uint32_t i = 0; i < dmaBuffer->planeCount(); ++i) {
-            auto modifier = dmaBuffer->modifier();
-            zwp_linux_buffer_params_v1_add(params, dmaBuffer->dmabufFDForPlane(i), i, dmaBuffer->offsetForPlane(i), dmaBuffer->strideForPlane(i), modifier >> 32, modifier & 0xffffffff);
+    // With subsurfaces, the single window buffer only holds the background.
+    const uint32_t bufferCount = args.subsurfaces ? 1 : args.bufferCount;
+    m_buffers.resize(bufferCount);
+    m_bufferUsage.resize(bufferCount);
+    m_busyBuffersHistogram.resize(bufferCount + 1);
+
+    for (uint32_t i = 0; i < bufferCount; ++i) {
+        if (args.software) {
+            m_buffers[i] = createShmWindowBuffer();
+            if (!m_buffers[i])
+                return false;
+            continue;
         }
 
-        zwp_linux_buffer_params_v1_add_listener(params, &params_listener, dmaBuffer.get());
-        zwp_linux_buffer_params_v1_create(params, dmaBuffer->width(), dmaBuffer->height(), dmaBuffer->format(), 0);
+        auto dmaBuffer = createWindowBuffer(i);
+        if (!dmaBuffer)
+            return false;
+
+        createWaylandBuffer(*dmaBuffer);
         m_buffers[i] = std::move(dmaBuffer);
     }
 
-    while (!dmaBufferAssignmentFinished())
-        wl_display_roundtrip(m_wayland.display());
-
     return true;
 }
 
@@ -235,8 +496,78 @@ void WaylandWindow::createSurface()
 
     wl_surface_commit(m_wlSurface);
 
-    while (m_waitForConfigure)
-        wl_display_roundtrip(m_wayland.display());
+    // Per-surface feedback adds the scanout tranches, once the surface is mapped fullscreen.
+    if (!Application::commandLineArguments().software && m_wayland.zwpLinuxDmabufV1Version() >= 4)
+        m_surfaceDMABufFeedback = DMABufFeedback::create(zwp_linux_dmabuf_v1_get_surface_feedback(m_wayland.zwpLinuxDmabufV1(), m_wlSurface));
+
+    // Don't wait for the compositor, the tiles are allocated meanwhile.
+    wl_display_flush(m_wayland.display());
+}
+
+void WaylandWindow::waitForConfigure()
+{
+    while (m_waitForConfigure) {
+        if (wl_display_dispatch(m_wayland.display()) == -1)
+            break;
+    }
+
+    if (m_surfaceDMABufFeedback) {
+        while (!m_surfaceDMABufFeedback->isDone()) {
+            if (wl_display_dispatch(m_wayland.display()) == -1)
+                break;
+        }
+
+        m_surfaceDMABufFeedback->report("Surface");
+    }
+}
+
+bool WaylandWindow::createSubsurfaces()
+{
+    auto& args = Application::commandLineArguments();
+    Logger::info("Creating %u tile subsurfaces...\n", m_tileRenderer->tileCount());
+
+    for (uint32_t i = 0; i < m_tileRenderer->tileCount(); ++i) {
+        auto& tile = m_tileRenderer->tile(i);
+        assert(tile.buffer() && tile.backBuffer());
+        for (auto* buffer : { tile.buffer(), tile.backBuffer() }) {
+            createWaylandBuffer(*buffer);
+            // The subsurface commits do not request an explicit release, wl_buffer.release is sent instead.
+            if (args.explicitSync && !args.eventThread)
+                wl_buffer_add_listener(buffer->wlBuffer(), &buffer_listener, static_cast<WaylandBuffer*>(buffer));
+        }
+
+        TileSubsurface tileSubsurface;
+        tileSubsurface.surface = wl_compositor_create_surface(m_wayland.compositor());
+        tileSubsurface.subsurface = wl_subcompositor_get_subsurface(m_wayland.subcompositor(), tileSubsurface.surface, m_wlSurface);
+        assert(tileSubsurface.surface && tileSubsurface.subsurface);
+
+        // Synchronized (the default): the tile commits are applied atomically with the next window commit.
+        uint32_t x, y;
+        m_tileRenderer->tilePosition(i, x, y);
+        wl_subsurface_set_position(tileSubsurface.subsurface, x, y);
+
+        if (args.opaque) {
+            struct wl_region* region = wl_compositor_create_region(m_wayland.compositor());
+            wl_region_add(region, 0, 0, tile.width(), tile.height());
+            wl_surface_set_opaque_region(tileSubsurface.surface, region);
+            wl_region_destroy(region);
+        }
+
+        m_tileSubsurfaces.push_back(tileSubsurface);
+    }
+
+    // Paint the background once, it stays attached to the window surface.
+    auto& background = dmaBuffer(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, background.glFrameBuffer());
+    glViewport(0, 0, m_width, m_height);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+
+    background.setIsInUse(true);
+    wl_surface_attach(m_wlSurface, background.wlBuffer(), 0, 0);
+    wl_surface_damage(m_wlSurface, 0, 0, m_width, m_height);
+    return true;
 }
 
 void WaylandWindow::setSize(uint32_t width, uint32_t height)
@@ -244,31 +575,314 @@ void WaylandWindow::setSize(uint32_t width, uint32_t height)
     m_width = width;
     m_height = height;
     m_waitForConfigure = false;
-    m_tileRenderer->initialize(width, height);
+
+    // The first configure event arrives before initialize() provides the tile renderer.
+    if (m_tileRenderer)
+        m_tileRenderer->initialize(width, height);
+    if (m_sceneRenderer)
+        m_sceneRenderer->initialize(width, height);
 }
 
-DMABuffer* WaylandWindow::obtainBuffer()
+void WaylandWindow::startEventThread()
 {
-    auto& args = Application::commandLineArguments();
-    if (args.unbounded)
-        return m_buffers[0].get();
+    auto* queue = m_eventThread->queue();
+
+    // Objects created through the wrappers (frame callbacks, buffer releases, presentation feedback) are
+    // assigned to the private queue, without racing against the event thread dispatching the queue.
+    m_wlSurfaceWrapper = static_cast<struct wl_surface*>(wl_proxy_create_wrapper(m_wlSurface));
+    wl_proxy_set_queue(reinterpret_cast<struct wl_proxy*>(m_wlSurfaceWrapper), queue);
+
+    if (m_zwpLinuxSurfaceSynchronizationV1) {
+        m_zwpLinuxSurfaceSynchronizationV1Wrapper = static_cast<struct zwp_linux_surface_synchronization_v1*>(wl_proxy_create_wrapper(m_zwpLinuxSurfaceSynchronizationV1));
+        wl_proxy_set_queue(reinterpret_cast<struct wl_proxy*>(m_zwpLinuxSurfaceSynchronizationV1Wrapper), queue);
+    }
+
+    if (auto* wpPresentation = m_wayland.wpPresentation()) {
+        m_wpPresentationWrapper = static_cast<struct wp_presentation*>(wl_proxy_create_wrapper(wpPresentation));
+        wl_proxy_set_queue(reinterpret_cast<struct wl_proxy*>(m_wpPresentationWrapper), queue);
+    }
+
+    if (!m_wayland.useExplicitSync()) {
+        for (auto& buffer : m_buffers) {
+            wl_proxy_set_queue(reinterpret_cast<struct wl_proxy*>(buffer->wlBuffer()), queue);
+            wl_buffer_add_listener(buffer->wlBuffer(), &forward_buffer_listener, this);
+        }
+    }
+
+    for (uint32_t i = 0; i < m_tileSubsurfaces.size(); ++i) {
+        auto& tile = m_tileRenderer->tile(i);
+        for (auto* buffer : { tile.buffer(), tile.backBuffer() }) {
+            wl_proxy_set_queue(reinterpret_cast<struct wl_proxy*>(buffer->wlBuffer()), queue);
+            wl_buffer_add_listener(buffer->wlBuffer(), &forward_buffer_listener, this);
+        }
+    }
+
+    // The render thread waits for the event thread notification and for the release fences.
+    m_epollFD = epoll_create1(EPOLL_CLOEXEC);
+    assert(m_epollFD >= 0);
+
+    struct epoll_event event = { .events = EPOLLIN, .data = { .u32 = UINT32_MAX } };
+    epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_eventThread->notifyFD(), &event);
+
+    Logger::info("Starting Wayland event thread...\n");
+    m_eventThread->start();
+}
+
+void WaylandWindow::postEvent(const WaylandEvent& event)
+{
+    m_eventThread->post(event);
+}
+
+int WaylandWindow::pollEventThread(int timeout)
+{
+    if (!m_eventThread->isRunning())
+        return -1;
+
+    // Requests are only flushed by the event thread when it wakes up.
+    if (wl_display_flush(m_wayland.display()) == -1 && errno != EAGAIN)
+        return -1;
+
+    std::array<struct epoll_event, maxBuffers + 1> events;
+    auto eventCount = epoll_wait(m_epollFD, events.data(), events.size(), timeout);
+    if (eventCount == -1)
+        return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < eventCount; ++i) {
+        if (events[i].data.u32 != UINT32_MAX)
+            didSignalReleaseFence(events[i].data.u32);
+    }
+
+    processEventThreadEvents();
+    return eventCount;
+}
+
+void WaylandWindow::processEventThreadEvents()
+{
+    m_eventThread->acknowledgeNotification();
+
+    // The default queue (xdg-shell, dmabuf feedback, ...) was read by the event thread, dispatch it here.
+    wl_display_dispatch_pending(m_wayland.display());
+
+    WaylandEvent event;
+    while (m_eventThread->pop(event)) {
+        ++m_forwardedEventCount;
+        handleEvent(event);
+    }
+}
+
+void WaylandWindow::handleEvent(const WaylandEvent& event)
+{
+    auto findBuffer = [&](auto predicate) -> uint32_t {
+        for (uint32_t i = 0; i < m_buffers.size(); ++i) {
+            if (predicate(*m_buffers[i]))
+                return i;
+        }
+
+        Logger::error("Received a release event for an unknown buffer.\n");
+        abort();
+    };
+
+    switch (event.type) {
+    case WaylandEvent::Type::BufferRelease:
+        if (auto* tileBuffer = findTileBuffer(static_cast<struct wl_buffer*>(event.object))) {
+            tileBuffer->setIsInUse(false);
+            break;
+        }
+        m_buffers[findBuffer([&](const WaylandBuffer& buffer) { return buffer.wlBuffer() == event.object; })]->setIsInUse(false);
+        break;
+    case WaylandEvent::Type::FencedBufferRelease:
+    case WaylandEvent::Type::ImmediateBufferRelease: {
+        auto bufferIndex = findBuffer([&](const WaylandBuffer& buffer) { return buffer.zwpLinuxBufferReleaseV1() == event.object; });
+        auto& waylandBuffer = *m_buffers[bufferIndex];
+        assert(waylandBuffer.releaseFenceFD() == -1);
+
+        zwp_linux_buffer_release_v1_destroy(waylandBuffer.zwpLinuxBufferReleaseV1());
+        waylandBuffer.setBufferRelease(nullptr);
+
+        if (event.fenceFD < 0) {
+            waylandBuffer.setIsInUse(false);
+            break;
+        }
+
+        // The buffer stays in use until the compositor is done reading from it.
+        waylandBuffer.setReleaseFenceFD(event.fenceFD);
+        struct epoll_event fenceEvent = { .events = EPOLLIN, .data = { .u32 = bufferIndex } };
+        epoll_ctl(m_epollFD, EPOLL_CTL_ADD, event.fenceFD, &fenceEvent);
+        break;
+    }
+    case WaylandEvent::Type::FrameDone:
+        renderFrame(static_cast<struct wl_callback*>(event.object));
+        break;
+    case WaylandEvent::Type::Presented:
+        didReceivePresentationFeedback(static_cast<PresentationFeedback*>(event.data), static_cast<struct wp_presentation_feedback*>(event.object),
+                                       event.presentationTime, event.refresh, event.sequence, event.flags);
+        break;
+    case WaylandEvent::Type::Discarded:
+        didDiscardPresentationFeedback(static_cast<PresentationFeedback*>(event.data), static_cast<struct wp_presentation_feedback*>(event.object));
+        break;
+    }
+}
 
-    for (uint32_t i = 0; i < numBuffers; ++i) {
-        if (!m_buffers[i]->isInUse())
-            return m_buffers[i].get();
+WaylandBuffer* WaylandWindow::findTileBuffer(struct wl_buffer* wlBuffer) const
+{
+    for (uint32_t i = 0; i < m_tileSubsurfaces.size(); ++i) {
+        auto& tile = m_tileRenderer->tile(i);
+        for (auto* buffer : { tile.buffer(), tile.backBuffer() }) {
+            if (buffer->wlBuffer() == wlBuffer)
+                return buffer;
+        }
     }
 
     return nullptr;
 }
 
-void WaylandWindow::renderFrame(struct wl_callback* callback)
+void WaylandWindow::didSignalReleaseFence(uint32_t bufferIndex)
+{
+    auto& waylandBuffer = *m_buffers[bufferIndex];
+    assert(waylandBuffer.releaseFenceFD() != -1);
+
+    epoll_ctl(m_epollFD, EPOLL_CTL_DEL, waylandBuffer.releaseFenceFD(), nullptr);
+    close(waylandBuffer.releaseFenceFD());
+    waylandBuffer.setReleaseFenceFD(-1);
+    waylandBuffer.setIsInUse(false);
+}
+
+int WaylandWindow::waitForEvents()
+{
+    if (m_eventThread)
+        return pollEventThread(-1);
+
+    return wl_display_dispatch(m_wayland.display());
+}
+
+int WaylandWindow::dispatchPendingEvents()
+{
+    if (m_eventThread)
+        return pollEventThread(0);
+
+    // Read and dispatch the events that already arrived, without blocking.
+    auto* display = m_wayland.display();
+    while (wl_display_prepare_read(display) != 0)
+        wl_display_dispatch_pending(display);
+
+    wl_display_flush(display);
+
+    struct pollfd pollFD = { wl_display_get_fd(display), POLLIN, 0 };
+    if (poll(&pollFD, 1, 0) > 0)
+        wl_display_read_events(display);
+    else
+        wl_display_cancel_read(display);
+
+    return wl_display_dispatch_pending(display);
+}
+
+std::optional<uint32_t> WaylandWindow::obtainBuffer()
 {
     auto& args = Application::commandLineArguments();
-    auto* dmaBuffer = obtainBuffer();
-    if (!dmaBuffer) {
-        Logger::error(callback ? "All buffers busy at redraw(). Server bug?\n" : "Failed to create the first buffer.\n");
-        abort();
+
+    std::optional<uint32_t> bufferIndex;
+    switch (args.bufferSelectionPolicy) {
+    case BufferSelectionPolicy::FirstFree:
+        for (uint32_t i = 0; i < m_buffers.size(); ++i) {
+            if (!m_buffers[i]->isInUse()) {
+                bufferIndex = i;
+                break;
+            }
+        }
+        break;
+    case BufferSelectionPolicy::FIFO:
+        // Strict ring order, the next buffer has to be released before it can be reused.
+        if (!m_buffers[m_nextFIFOBufferIndex]->isInUse()) {
+            bufferIndex = m_nextFIFOBufferIndex;
+            m_nextFIFOBufferIndex = (m_nextFIFOBufferIndex + 1) % m_buffers.size();
+        }
+        break;
+    case BufferSelectionPolicy::OldestFree:
+    case BufferSelectionPolicy::Mailbox:
+        // The least recently committed buffer, which is the one most likely to be idle on the GPU.
+        for (uint32_t i = 0; i < m_buffers.size(); ++i) {
+            if (m_buffers[i]->isInUse())
+                continue;
+            if (!bufferIndex || m_bufferUsage[i].lastCommit < m_bufferUsage[*bufferIndex].lastCommit)
+                bufferIndex = i;
+        }
+        break;
+    }
+
+    return bufferIndex;
+}
+
+void WaylandWindow::sampleBufferOccupancy()
+{
+    uint32_t busyBuffers = 0;
+    for (uint32_t i = 0; i < m_buffers.size(); ++i) {
+        if (m_buffers[i]->isInUse()) {
+            ++busyBuffers;
+            ++m_bufferUsage[i].busySamples;
+        }
+    }
+
+    ++m_acquisitionCount;
+    ++m_busyBuffersHistogram[busyBuffers];
+}
+
+std::optional<uint32_t> WaylandWindow::waitForBuffer()
+{
+    sampleBufferOccupancy();
+
+    auto bufferIndex = obtainBuffer();
+    if (!bufferIndex) {
+        // Stall: block until the compositor releases a buffer.
+        auto stallStartTime = getCurrentTimeInNanoSeconds();
+        ++m_stallCount;
+
+        while (!bufferIndex) {
+            if (waitForEvents() == -1)
+                return std::nullopt;
+            bufferIndex = obtainBuffer();
+        }
+
+        m_stallTimeInNanoSeconds += getCurrentTimeInNanoSeconds() - stallStartTime;
+    }
+
+    ++m_bufferUsage[*bufferIndex].acquisitions;
+    return bufferIndex;
+}
+
+void WaylandWindow::requestPresentationFeedback(const FrameTiming& timing)
+{
+    auto* presentationFeedback = new PresentationFeedback { *this, timing };
+    if (m_eventThread) {
+        auto* feedback = wp_presentation_feedback(m_wpPresentationWrapper, m_wlSurface);
+        wp_presentation_feedback_add_listener(feedback, &forward_feedback_listener, presentationFeedback);
+        return;
+    }
+
+    auto* feedback = wp_presentation_feedback(m_wayland.wpPresentation(), m_wlSurface);
+    wp_presentation_feedback_add_listener(feedback, &feedback_listener, presentationFeedback);
+}
+
+void WaylandWindow::didPresentFrame(const FrameTiming& timing, int64_t presentationTime, uint32_t refresh, uint64_t sequence, uint32_t flags)
+{
+    m_statistics.recordPresentation(timing.commitTime, presentationTime, refresh, sequence, flags);
+
+    if (m_frameScheduler) {
+        m_frameScheduler->didPresentFrame(presentationTime, refresh);
+
+        // A frame that was presented one (or more) refresh cycles after its target missed the deadline.
+        if (timing.targetPresentationTime)
+            m_statistics.recordScheduledFrame(presentationTime - timing.renderStartTime, presentationTime > timing.targetPresentationTime + refresh / 2);
     }
+}
+
+void WaylandWindow::didDiscardFrame()
+{
+    m_statistics.recordDiscardedPresentation();
+}
+
+void WaylandWindow::paintBuffer(uint32_t bufferIndex)
+{
+    auto& args = Application::commandLineArguments();
 
     /* Start fps measuring on second frame, to remove the time spent
      * compiling shader, etc, from the fps:
@@ -276,48 +890,340 @@ void WaylandWindow::renderFrame(struct wl_callback* callback)
     if (m_statistics.currentFrame() == 1)
         m_statistics.initialize();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, dmaBuffer->glFrameBuffer());
+    if (args.software) {
+        auto& buffer = shmBuffer(bufferIndex);
+        {
+            PerfCounterScope scope(PerfCounters::Scope::RenderTiles);
+            m_tileRenderer->paintTiles();
+            m_tileRenderer->compositeTilesInMemory(buffer.data(), buffer.stride() / sizeof(uint32_t));
+        }
+
+        buffer.setIsInUse(true);
+        m_statistics.advanceFrame();
+        return;
+    }
+
+    auto* gpuTimer = m_wayland.egl().gpuTimer();
+    if (gpuTimer) {
+        recordGPUTimes(*gpuTimer);
+        gpuTimer->beginFrame();
+    }
+
+    auto& buffer = dmaBuffer(bufferIndex);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer.glFrameBuffer());
 
     if (args.depth) {
+        GPUTimerScope clearScope(gpuTimer, GPUTimer::Stage::DepthClear);
         glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         glDepthFunc(GL_LEQUAL);
         glEnable(GL_DEPTH_TEST);
     }
 
-    m_tileRenderer->renderTiles();
+    if (m_sceneRenderer)
+        m_sceneRenderer->renderFrame();
+    else
+        m_tileRenderer->renderTiles();
+
+    if (m_tileRenderer && m_tileRenderer->isRemote()) {
+        auto& timing = m_tileRenderer->remoteUpdateTiming();
+        m_statistics.recordRemoteUpdate(timing.roundTripTime, timing.transferTime, timing.paintTime);
+    }
 
     if (args.depth)
         glDisable(GL_DEPTH_TEST);
 
+    if (gpuTimer)
+        gpuTimer->endFrame();
+
+    // In explicit sync mode the acquire fence is created when the buffer is committed.
+    if (!m_wayland.useExplicitSync())
+        glFlush();
+
+    buffer.setIsInUse(true);
+    m_statistics.advanceFrame();
+}
+
+void WaylandWindow::recordGPUTimes(GPUTimer& gpuTimer)
+{
+    GPUTimer::StageTimes times;
+    while (gpuTimer.takeResult(times))
+        m_statistics.recordGPUTimes(times);
+}
+
+void WaylandWindow::presentBuffer(uint32_t bufferIndex, const FrameTiming& paintTiming)
+{
+    auto& waylandBuffer = *m_buffers[bufferIndex];
+
     if (m_wayland.useExplicitSync()) {
         auto fenceFD = m_wayland.egl().createFenceFD();
         zwp_linux_surface_synchronization_v1_set_acquire_fence(m_zwpLinuxSurfaceSynchronizationV1, fenceFD);
         close(fenceFD);
 
-        dmaBuffer->setBufferRelease(zwp_linux_surface_synchronization_v1_get_release(m_zwpLinuxSurfaceSynchronizationV1));
-        zwp_linux_buffer_release_v1_add_listener(dmaBuffer->zwpLinuxBufferReleaseV1(), &buffer_release_listener, dmaBuffer);
-    } else
+        if (m_eventThread) {
+            waylandBuffer.setBufferRelease(zwp_linux_surface_synchronization_v1_get_release(m_zwpLinuxSurfaceSynchronizationV1Wrapper));
+            zwp_linux_buffer_release_v1_add_listener(waylandBuffer.zwpLinuxBufferReleaseV1(), &forward_buffer_release_listener, this);
+        } else {
+            waylandBuffer.setBufferRelease(zwp_linux_surface_synchronization_v1_get_release(m_zwpLinuxSurfaceSynchronizationV1));
+            zwp_linux_buffer_release_v1_add_listener(waylandBuffer.zwpLinuxBufferReleaseV1(), &buffer_release_listener, &waylandBuffer);
+        }
+    }
+
+    wl_surface_attach(m_wlSurface, waylandBuffer.wlBuffer(), 0, 0);
+    wl_surface_damage(m_wlSurface, 0, 0, width(), height());
+
+    commitFrame(paintTiming);
+    m_bufferUsage[bufferIndex].lastCommit = m_commitCount;
+}
+
+bool WaylandWindow::acquireTileBuffers()
+{
+    // The compositor reads an attached tile buffer until the next commit replaces it: paint into the idle one of the pair.
+    for (uint32_t i = 0; i < m_tileSubsurfaces.size(); ++i) {
+        auto& tile = m_tileRenderer->tile(i);
+        if (!tile.buffer()->isInUse())
+            continue;
+
+        if (tile.backBuffer()->isInUse()) {
+            // Stall: block until the compositor releases one of the tile buffers.
+            auto stallStartTime = getCurrentTimeInNanoSeconds();
+            ++m_subsurfaceStallCount;
+
+            while (tile.buffer()->isInUse() && tile.backBuffer()->isInUse()) {
+                if (waitForEvents() == -1)
+                    return false;
+            }
+
+            m_subsurfaceStallTimeInNanoSeconds += getCurrentTimeInNanoSeconds() - stallStartTime;
+        }
+
+        if (tile.buffer()->isInUse())
+            tile.swapBuffers();
+    }
+
+    return true;
+}
+
+void WaylandWindow::presentSubsurfaces(const FrameTiming& paintTiming)
+{
+    auto& args = Application::commandLineArguments();
+
+    if (m_statistics.currentFrame() == 1)
+        m_statistics.initialize();
+
+    auto* gpuTimer = m_wayland.egl().gpuTimer();
+    if (gpuTimer) {
+        recordGPUTimes(*gpuTimer);
+        gpuTimer->beginFrame();
+    }
+
+    if (!acquireTileBuffers()) {
+        Logger::error("Failed to obtain the tile buffers.\n");
+        abort();
+    }
+
+    {
+        PerfCounterScope scope(PerfCounters::Scope::RenderTiles);
+        GPUTimerScope updateScope(gpuTimer, GPUTimer::Stage::TileUpdate);
+        m_tileRenderer->paintTiles();
+    }
+
+    if (gpuTimer)
+        gpuTimer->endFrame();
+    if (m_tileRenderer->isRemote()) {
+        auto& timing = m_tileRenderer->remoteUpdateTiming();
+        m_statistics.recordRemoteUpdate(timing.roundTripTime, timing.transferTime, timing.paintTime);
+    }
+
+    // No GL composition: only submit the tile uploads, the dma-buf implicit sync orders them before the compositor reads.
+    if (isGLTileUpdateMethod(args.tileUpdateMethod))
         glFlush();
 
+    auto& damage = m_tileRenderer->damage();
+    for (uint32_t i = 0; i < m_tileSubsurfaces.size(); ++i) {
+        auto& tileSubsurface = m_tileSubsurfaces[i];
+        auto& tile = m_tileRenderer->tile(i);
+        auto* wlBuffer = tile.buffer()->wlBuffer();
+        tile.buffer()->setIsInUse(true);
+        wl_surface_attach(tileSubsurface.surface, wlBuffer, 0, 0);
+
+        // The first commit of a buffer presents all of it, afterwards the two buffers only differ within the damage.
+        auto tileDamage = damage[i];
+        auto& presentedBuffers = tileSubsurface.presentedBuffers;
+        if (std::find(presentedBuffers.begin(), presentedBuffers.end(), wlBuffer) == presentedBuffers.end()) {
+            *std::find(presentedBuffers.begin(), presentedBuffers.end(), nullptr) = wlBuffer;
+            tileDamage = { 0, 0, tile.width(), tile.height() };
+        }
+        wl_surface_damage(tileSubsurface.surface, tileDamage.x, tileDamage.y, tileDamage.width, tileDamage.height);
+        wl_surface_commit(tileSubsurface.surface);
+        m_subsurfaceDamagedPixels += uint64_t(tileDamage.width) * tileDamage.height;
+    }
+
     m_statistics.advanceFrame();
+    commitFrame(paintTiming);
+}
 
-    wl_surface_attach(m_wlSurface, dmaBuffer->wlBuffer(), 0, 0);
-    wl_surface_damage(m_wlSurface, 0, 0, width(), height());
+void WaylandWindow::commitFrame(const FrameTiming& paintTiming)
+{
+    auto& args = Application::commandLineArguments();
 
     if (!args.unbounded) {
-        if (callback)
-            wl_callback_destroy(callback);
-
-        m_wlCallback = wl_surface_frame(m_wlSurface);
-        wl_callback_add_listener(m_wlCallback, &frame_listener, this);
+        if (m_eventThread) {
+            m_wlCallback = wl_surface_frame(m_wlSurfaceWrapper);
+            wl_callback_add_listener(m_wlCallback, &forward_frame_listener, this);
+        } else {
+            m_wlCallback = wl_surface_frame(m_wlSurface);
+            wl_callback_add_listener(m_wlCallback, &frame_listener, this);
+        }
+        m_canPresent = false;
     }
 
+    // Sample the commit time right before wl_surface_commit(), in the clock domain of the compositor.
+    auto timing = paintTiming;
+    timing.commitTime = getCurrentTimeInNanoSeconds(m_wayland.presentationClock());
+    if (args.presentationFeedback)
+        requestPresentationFeedback(timing);
+
     wl_surface_commit(m_wlSurface);
+    ++m_commitCount;
+
+    if (m_commitCount == 1)
+        reportStartup();
+
+    if (m_frameScheduler) {
+        m_frameScheduler->didFinishRendering(timing.renderStartTime, getCurrentTimeInNanoSeconds(m_frameScheduler->clock()));
+
+        // Without presentation feedback, a frame misses its deadline if it was not committed within the safety margin.
+        if (timing.targetPresentationTime && !args.presentationFeedback)
+            m_statistics.recordScheduledFrame(timing.targetPresentationTime - timing.renderStartTime, timing.commitTime > timing.targetPresentationTime - m_frameScheduler->margin());
+    }
+}
+
+void WaylandWindow::reportStartup() const
+{
+    auto& args = Application::commandLineArguments();
+
+    StartupProfiler::markPhase("first frame");
+    StartupProfiler::report();
+    if (!args.software)
+        m_wayland.egl().programCache().report();
+}
+
+void WaylandWindow::renderFrame(struct wl_callback* callback)
+{
+    auto& args = Application::commandLineArguments();
+
+    if (callback) {
+        assert(callback == m_wlCallback);
+        wl_callback_destroy(callback);
+        m_wlCallback = nullptr;
+        m_canPresent = true;
+    }
+
+    // Mailbox: the frame callback only commits the newest queued frame, painting happens in the render loop.
+    if (args.bufferSelectionPolicy == BufferSelectionPolicy::Mailbox && callback) {
+        if (m_queuedBufferIndex) {
+            presentBuffer(*m_queuedBufferIndex, m_queuedFrameTiming);
+            m_queuedBufferIndex.reset();
+        }
+        return;
+    }
+
+    FrameTiming timing;
+    if (m_frameScheduler && callback) {
+        m_frameScheduler->didReceiveFrameCallback();
+        timing.targetPresentationTime = m_frameScheduler->waitForRenderStart();
+    }
+    timing.renderStartTime = getCurrentTimeInNanoSeconds(m_wayland.presentationClock());
+
+    if (!m_tileSubsurfaces.empty()) {
+        presentSubsurfaces(timing);
+        m_statistics.reportFrameRate();
+        return;
+    }
+
+    auto bufferIndex = waitForBuffer();
+    if (!bufferIndex) {
+        Logger::error("Failed to obtain a window buffer.\n");
+        abort();
+    }
+
+    paintBuffer(*bufferIndex);
+    presentBuffer(*bufferIndex, timing);
+
+    m_statistics.reportFrameRate();
+}
+
+void WaylandWindow::renderMailboxFrame()
+{
+    auto bufferIndex = obtainBuffer();
+    if (!bufferIndex) {
+        // All buffers are queued or held by the compositor, wait for a release or the frame callback.
+        waitForEvents();
+        return;
+    }
+
+    // Sampled once per acquired buffer, obtainBuffer() does not change the occupancy.
+    sampleBufferOccupancy();
+    ++m_bufferUsage[*bufferIndex].acquisitions;
+
+    FrameTiming timing;
+    timing.renderStartTime = getCurrentTimeInNanoSeconds(m_wayland.presentationClock());
+    paintBuffer(*bufferIndex);
+
+    // The newest frame replaces the one that is still waiting for the frame callback.
+    if (m_queuedBufferIndex) {
+        m_buffers[*m_queuedBufferIndex]->setIsInUse(false);
+        ++m_replacedFrameCount;
+    }
+
+    m_queuedBufferIndex = bufferIndex;
+    m_queuedFrameTiming = timing;
+
+    if (m_canPresent) {
+        presentBuffer(*m_queuedBufferIndex, m_queuedFrameTiming);
+        m_queuedBufferIndex.reset();
+    }
 
-    dmaBuffer->setIsInUse(true);
     m_statistics.reportFrameRate();
 }
 
+void WaylandWindow::reportBufferOccupancy() const
+{
+    auto& args = Application::commandLineArguments();
+    if (!m_acquisitionCount || m_buffers.empty())
+        return;
+
+    // Each dma-buf window buffer also carries a depth/stencil renderbuffer of the same size.
+    auto& firstBuffer = *m_buffers[0];
+    const uint64_t colorBytes = firstBuffer.colorBufferSize();
+    const uint64_t depthStencilBytes = args.software ? 0 : uint64_t(firstBuffer.width()) * firstBuffer.height() * 4;
+    const double bytesPerMiB = 1024.0 * 1024.0;
+
+    Logger::info("Window buffers: %zu x (%.2f MiB color + %.2f MiB depth/stencil) = %.2f MiB\n", m_buffers.size(),
+                 double(colorBytes) / bytesPerMiB, double(depthStencilBytes) / bytesPerMiB,
+                 double(m_buffers.size() * (colorBytes + depthStencilBytes)) / bytesPerMiB);
+
+    for (uint32_t i = 0; i < m_buffers.size(); ++i) {
+        Logger::info("  buffer %u: acquired %llu times, held by the compositor at %.1f%% of the acquisitions\n", i,
+                     static_cast<unsigned long long>(m_bufferUsage[i].acquisitions),
+                     100.0 * double(m_bufferUsage[i].busySamples) / double(m_acquisitionCount));
+    }
+
+    uint32_t peakBusyBuffers = 0;
+    for (uint32_t busyBuffers = 0; busyBuffers < m_busyBuffersHistogram.size(); ++busyBuffers) {
+        if (!m_busyBuffersHistogram[busyBuffers])
+            continue;
+        peakBusyBuffers = busyBuffers;
+        Logger::info("  %u buffers busy at acquisition: %.1f%%\n", busyBuffers, 100.0 * double(m_busyBuffersHistogram[busyBuffers]) / double(m_acquisitionCount));
+    }
+
+    Logger::info("  stalls: %llu (%.3f ms waiting for a release)\n", static_cast<unsigned long long>(m_stallCount), double(m_stallTimeInNanoSeconds) / double(nsPerSecond / msPerSecond));
+    if (args.bufferSelectionPolicy == BufferSelectionPolicy::Mailbox)
+        Logger::info("  replaced frames: %llu\n", static_cast<unsigned long long>(m_replacedFrameCount));
+    if (!m_stallCount && peakBusyBuffers + 1 < m_buffers.size())
+        Logger::info("  no stalls, --buffers %u would have been sufficient\n", std::max(minBuffers, peakBusyBuffers + 1));
+}
+
 void WaylandWindow::executeRenderLoop(Application& app)
 {
     // Issue first frame
@@ -331,11 +1237,50 @@ void WaylandWindow::executeRenderLoop(Application& app)
         ret = wl_display_flush(m_wayland.display());
 
     while (app.isRunning() && m_statistics.currentFrame() <= args.frameCount && ret != -1) {
-        if (!args.unbounded)
-            ret = wl_display_dispatch(m_wayland.display());
-        else
+        if (args.bufferSelectionPolicy == BufferSelectionPolicy::Mailbox) {
+            ret = dispatchPendingEvents();
+            renderMailboxFrame();
+        } else if (!args.unbounded)
+            ret = waitForEvents();
+        else {
+            // Process buffer releases, so that no buffer still held by the compositor is reused.
+            ret = dispatchPendingEvents();
             renderFrame(nullptr);
+        }
     }
 
     m_statistics.reportFrameRate(true);
+    reportBufferOccupancy();
+    if (m_sceneRenderer)
+        m_sceneRenderer->report();
+    else if (m_tileSubsurfaces.empty())
+        m_tileRenderer->reportComposition();
+
+    if (auto* videoPlayer = m_tileRenderer ? m_tileRenderer->videoPlayer() : nullptr)
+        videoPlayer->report();
+    Tile::reportPixelFormat();
+    if (auto* contentSource = ContentSource::singleton())
+        contentSource->report();
+
+    if (auto* gpuTimer = !args.software ? m_wayland.egl().gpuTimer() : nullptr) {
+        if (gpuTimer->droppedFrames() || gpuTimer->disjointFrames()) {
+            Logger::info("GPU timing: %llu frames dropped (results not ready in time), %llu invalidated by disjoint events\n",
+                         static_cast<unsigned long long>(gpuTimer->droppedFrames()), static_cast<unsigned long long>(gpuTimer->disjointFrames()));
+        }
+    }
+
+    if (!m_tileSubsurfaces.empty() && m_statistics.currentFrame() > 1) {
+        Logger::info("Subsurfaces: %zu tiles, %.3f MPixel damage committed per frame\n", m_tileSubsurfaces.size(),
+                     double(m_subsurfaceDamagedPixels) / double(m_statistics.currentFrame()) / 1e6);
+        Logger::info("Subsurfaces: stalled %llu times on both tile buffers held by the compositor, %.3f ms in total\n",
+                     static_cast<unsigned long long>(m_subsurfaceStallCount), double(m_subsurfaceStallTimeInNanoSeconds) / 1e6);
+    }
+
+    if (m_surfaceDMABufFeedback && m_surfaceDMABufFeedback->generation() > 1) {
+        Logger::info("Surface dma-buf feedback changed %u times while running, the window buffers were not reallocated\n", m_surfaceDMABufFeedback->generation() - 1);
+        m_surfaceDMABufFeedback->report("Final surface");
+    }
+
+    if (m_eventThread)
+        Logger::info("Event thread: forwarded %llu events to the render thread\n", static_cast<unsigned long long>(m_forwardedEventCount));
 }
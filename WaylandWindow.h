@@ -22,6 +22,8 @@
 #include <array>
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <wayland-client.h>
 #include <wayland-egl.h>
@@ -29,21 +31,49 @@
 #include "Statistics.h"
 
 class Application;
+class DMABufFeedback;
 class DMABuffer;
+class FrameScheduler;
+class GPUTimer;
+class SceneRenderer;
+class ShmBuffer;
 class TileRenderer;
 class Wayland;
+class WaylandBuffer;
+class WaylandEventThread;
+struct WaylandEvent;
 
 class WaylandWindow {
 public:
-    WaylandWindow(const Wayland&, std::unique_ptr<TileRenderer>&&);
+    WaylandWindow(const Wayland&);
     ~WaylandWindow();
 
-    static constexpr uint32_t numBuffers = 4;
-    static std::unique_ptr<WaylandWindow> create(const Wayland&, std::unique_ptr<TileRenderer>&&);
+    static constexpr uint32_t minBuffers = 2;
+    static constexpr uint32_t maxBuffers = 8;
+
+    // Creates and commits the surface without waiting for the compositor. initialize() waits for the
+    // configure event and creates the window buffers, the caller can allocate the tiles in between.
+    static std::unique_ptr<WaylandWindow> create(const Wayland&);
+    bool initialize(std::unique_ptr<TileRenderer>&&);
+    // --scene: composites the layers of the scene instead of the tile grid.
+    bool initialize(std::unique_ptr<SceneRenderer>&&);
 
     void executeRenderLoop(Application&);
     void renderFrame(struct wl_callback*);
 
+    // Timestamps in the presentation clock domain.
+    struct FrameTiming {
+        int64_t renderStartTime { 0 };
+        int64_t targetPresentationTime { 0 };
+        int64_t commitTime { 0 };
+    };
+
+    void didPresentFrame(const FrameTiming&, int64_t presentationTime, uint32_t refresh, uint64_t sequence, uint32_t flags);
+    void didDiscardFrame();
+
+    // Called from the event thread, in --event-thread mode.
+    void postEvent(const WaylandEvent&);
+
     uint32_t width() const { return m_width; }
     uint32_t height() const { return m_height; }
     void setSize(uint32_t width, uint32_t height);
@@ -52,10 +82,39 @@ public:
     struct wl_surface* surface() const { return m_wlSurface; }
 
 private:
+    bool initializeWindow();
     bool createBuffers();
+    std::unique_ptr<DMABuffer> createWindowBuffer(uint32_t index);
+    std::unique_ptr<ShmBuffer> createShmWindowBuffer();
+    void createWaylandBuffer(DMABuffer&);
+    DMABuffer& dmaBuffer(uint32_t bufferIndex) const;
+    ShmBuffer& shmBuffer(uint32_t bufferIndex) const;
     void createSurface();
-    bool dmaBufferAssignmentFinished() const;
-    DMABuffer* obtainBuffer();
+    void waitForConfigure();
+    bool createSubsurfaces();
+    int dispatchPendingEvents();
+    int waitForEvents();
+
+    void startEventThread();
+    int pollEventThread(int timeout);
+    void processEventThreadEvents();
+    void handleEvent(const WaylandEvent&);
+    void didSignalReleaseFence(uint32_t bufferIndex);
+    WaylandBuffer* findTileBuffer(struct wl_buffer*) const;
+
+    std::optional<uint32_t> obtainBuffer();
+    void sampleBufferOccupancy();
+    std::optional<uint32_t> waitForBuffer();
+    void paintBuffer(uint32_t bufferIndex);
+    void recordGPUTimes(GPUTimer&);
+    void presentBuffer(uint32_t bufferIndex, const FrameTiming&);
+    bool acquireTileBuffers();
+    void presentSubsurfaces(const FrameTiming&);
+    void commitFrame(const FrameTiming&);
+    void renderMailboxFrame();
+    void requestPresentationFeedback(const FrameTiming&);
+    void reportBufferOccupancy() const;
+    void reportStartup() const;
 
     const Wayland& m_wayland;
     struct wl_surface* m_wlSurface { nullptr };
@@ -70,6 +129,51 @@ private:
 
     alignas(8) Statistics m_statistics;
 
+    std::unique_ptr<FrameScheduler> m_frameScheduler;
+    std::unique_ptr<DMABufFeedback> m_surfaceDMABufFeedback;
+
+    // --event-thread: proxy wrappers create their objects on the private event queue.
+    std::unique_ptr<WaylandEventThread> m_eventThread;
+    struct wl_surface* m_wlSurfaceWrapper { nullptr };
+    struct zwp_linux_surface_synchronization_v1* m_zwpLinuxSurfaceSynchronizationV1Wrapper { nullptr };
+    struct wp_presentation* m_wpPresentationWrapper { nullptr };
+    int m_epollFD { -1 };
+    uint64_t m_forwardedEventCount { 0 };
+
     std::unique_ptr<TileRenderer> m_tileRenderer;
-    std::array<std::unique_ptr<DMABuffer>, numBuffers> m_buffers;
+    std::unique_ptr<SceneRenderer> m_sceneRenderer;
+    std::vector<std::unique_ptr<WaylandBuffer>> m_buffers; // ShmBuffers in --software mode, DMABuffers otherwise
+    std::vector<struct zwp_linux_buffer_params_v1*> m_bufferParams;
+
+    struct BufferUsage {
+        uint64_t lastCommit { 0 }; // 0: never committed
+        uint64_t acquisitions { 0 };
+        uint64_t busySamples { 0 };
+    };
+
+    std::vector<BufferUsage> m_bufferUsage;
+    std::vector<uint64_t> m_busyBuffersHistogram;
+    uint64_t m_commitCount { 0 };
+    uint64_t m_acquisitionCount { 0 };
+    uint64_t m_stallCount { 0 };
+    int64_t m_stallTimeInNanoSeconds { 0 };
+    uint32_t m_nextFIFOBufferIndex { 0 };
+
+    // --subsurfaces: one synchronized subsurface per tile, the window buffer only provides the background.
+    struct TileSubsurface {
+        struct wl_surface* surface { nullptr };
+        struct wl_subsurface* subsurface { nullptr };
+        std::array<struct wl_buffer*, 2> presentedBuffers { };
+    };
+
+    std::vector<TileSubsurface> m_tileSubsurfaces;
+    uint64_t m_subsurfaceDamagedPixels { 0 };
+    uint64_t m_subsurfaceStallCount { 0 };
+    int64_t m_subsurfaceStallTimeInNanoSeconds { 0 };
+
+    // Mailbox: the newest painted, not yet committed buffer replaces an older queued one.
+    std::optional<uint32_t> m_queuedBufferIndex;
+    FrameTiming m_queuedFrameTiming;
+    uint64_t m_replacedFrameCount { 0 };
+    bool m_canPresent { true };
 };
@@ -18,73 +18,183 @@
  */
 
 #include "Application.h"
+#include "BandwidthCounters.h"
+#include "ContentSource.h"
 #include "DRM.h"
 #include "EGL.h"
 #include "GBM.h"
+#include "IPC.h"
 #include "Logger.h"
+#include "PainterProcess.h"
+#include "PerfCounters.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "StartupProfiler.h"
 #include "TileRenderer.h"
+#include "VideoPlayer.h"
 #include "Wayland.h"
 #include "WaylandWindow.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 int main(int argc, char** argv)
 {
     auto& app = Application::create(argc, argv);
     auto& args = app.commandLineArguments();
 
-    auto drmIPU = DRM::createForNode(args.drmNodeIPU);
-    if (!drmIPU) {
-        Logger::error("Failed to initialize DRM (IPU)\n");
-        return -1;
+    // Fork before any DRM/EGL/Wayland state exists, each process initializes its own.
+    std::unique_ptr<IPC::Channel> painterChannel;
+    pid_t painterPID = -1;
+    if (args.multiProcess) {
+        auto channels = IPC::Channel::createPair();
+        if (!channels.first) {
+            Logger::error("Failed to initialize IPC\n");
+            return -1;
+        }
+
+        painterPID = fork();
+        if (painterPID == -1) {
+            Logger::error("Failed to fork the painter process\n");
+            return -1;
+        }
+
+        if (!painterPID) {
+            channels.first.reset();
+            auto painterProcess = PainterProcess::create(std::move(channels.second));
+            if (!painterProcess) {
+                Logger::error("Failed to initialize the painter process\n");
+                return -1;
+            }
+
+            return painterProcess->run();
+        }
+
+        channels.second.reset();
+        painterChannel = std::move(channels.first);
     }
 
-    auto gbmIPU = GBM::create(drmIPU->fd());
-    if (!gbmIPU) {
-        Logger::error("Failed to initialize GBM (IPU)\n");
+    PerfCounters::initialize();
+    BandwidthCounters::initialize();
+    if (!ContentSource::initialize()) {
+        Logger::error("Failed to initialize the content file\n");
         return -1;
     }
 
+    // --software: no GPU at all, the tiles are composited on the CPU into wl_shm buffers.
+    std::unique_ptr<DRM> drmIPU;
+    std::unique_ptr<GBM> gbmIPU;
     std::unique_ptr<DRM> drmGPU;
     std::unique_ptr<GBM> gbmGPU;
-    if (args.drmNodeIPU != args.drmNodeGPU) {
-        drmGPU = DRM::createForNode(args.drmNodeGPU);
-
-        if (!drmGPU) {
-            Logger::error("Failed to initialize DRM (GPU)\n");
+    std::unique_ptr<EGL> egl;
+    if (!args.software) {
+        drmIPU = DRM::createForNode(args.drmNodeIPU);
+        if (!drmIPU) {
+            Logger::error("Failed to initialize DRM (IPU)\n");
             return -1;
         }
 
-        gbmGPU = GBM::create(drmGPU->fd());
-        if (!gbmGPU) {
-            Logger::error("Failed to initialize GBM (GPU)\n");
+        gbmIPU = GBM::create(drmIPU->fd());
+        if (!gbmIPU) {
+            Logger::error("Failed to initialize GBM (IPU)\n");
             return -1;
         }
-    }
 
-    auto egl = EGL::create(*gbmIPU);
-    if (!egl) {
-        Logger::error("Failed to initialize EGL\n");
-        return -1;
+        if (args.drmNodeIPU != args.drmNodeGPU) {
+            drmGPU = DRM::createForNode(args.drmNodeGPU);
+
+            if (!drmGPU) {
+                Logger::error("Failed to initialize DRM (GPU)\n");
+                return -1;
+            }
+
+            gbmGPU = GBM::create(drmGPU->fd());
+            if (!gbmGPU) {
+                Logger::error("Failed to initialize GBM (GPU)\n");
+                return -1;
+            }
+        }
+
+        StartupProfiler::markPhase("DRM / GBM");
+
+        egl = EGL::create(*gbmIPU);
+        if (!egl) {
+            Logger::error("Failed to initialize EGL\n");
+            return -1;
+        }
+        StartupProfiler::markPhase("EGL");
     }
 
-    auto wayland = Wayland::create(*drmIPU, *gbmIPU, *egl);
+    auto wayland = Wayland::create(drmIPU.get(), gbmIPU.get(), egl.get());
     if (!wayland) {
         Logger::error("Failed to initialize Wayland\n");
         return -1;
     }
+    StartupProfiler::markPhase("Wayland registry");
 
-    auto tileRenderer = TileRenderer::create(args.tileCount, args.tileWidth, args.tileHeight, *egl);
-    if (!tileRenderer) {
-        Logger::error("Failed to initialize tile rendering\n");
+    // The surface is committed right away, the tile setup overlaps with the compositor roundtrips
+    // (bound globals, dma-buf feedback, configure).
+    auto waylandWindow = WaylandWindow::create(*wayland.get());
+    if (!waylandWindow) {
+        Logger::error("Failed to initialize Wayland window\n");
         return -1;
     }
+    StartupProfiler::markPhase("window surface");
+
+    // --scene: every layer of the scene has its own tiles, instead of the tile grid.
+    std::unique_ptr<SceneRenderer> sceneRenderer;
+    std::unique_ptr<TileRenderer> tileRenderer;
+    if (!args.scenePath.empty()) {
+        auto scene = Scene::load(args.scenePath, args.tileWidth, args.tileHeight);
+        if (!scene) {
+            Logger::error("Failed to load the scene\n");
+            return -1;
+        }
+
+        sceneRenderer = SceneRenderer::create(std::move(scene), *egl);
+    } else {
+        tileRenderer = TileRenderer::create(args.tileCount, args.tileWidth, args.tileHeight, egl.get());
+        if (!tileRenderer) {
+            Logger::error("Failed to initialize tile rendering\n");
+            return -1;
+        }
+    }
+    StartupProfiler::markPhase("tile programs");
 
-    if (args.dmabufTiles)
+    if (sceneRenderer) {
+        if (args.dmabufTiles)
+            sceneRenderer->allocateDMABufTiles(drmGPU ? *drmGPU : *drmIPU, gbmGPU ? *gbmGPU : *gbmIPU);
+        else
+            sceneRenderer->allocateGLTiles();
+    } else if (painterChannel) {
+        if (!tileRenderer->importTiles(std::move(painterChannel))) {
+            Logger::error("Failed to import the tiles of the painter process\n");
+            return -1;
+        }
+    } else if (args.software)
+        tileRenderer->allocateMemoryTiles();
+    else if (args.dmabufTiles)
         tileRenderer->allocateDMABufTiles(drmGPU ? *drmGPU : *drmIPU, gbmGPU ? *gbmGPU : *gbmIPU);
     else
         tileRenderer->allocateGLTiles();
+    StartupProfiler::markPhase("tile allocation");
 
-    auto waylandWindow = WaylandWindow::create(*wayland.get(), std::move(tileRenderer));
-    if (!waylandWindow) {
+    if (args.videoWidth) {
+        auto videoPlayer = VideoPlayer::create(drmGPU ? *drmGPU : *drmIPU, gbmGPU ? *gbmGPU : *gbmIPU, *egl);
+        if (!videoPlayer) {
+            Logger::error("Failed to initialize video playback\n");
+            return -1;
+        }
+
+        tileRenderer->setVideoPlayer(std::move(videoPlayer));
+        StartupProfiler::markPhase("video frames");
+    }
+
+    wayland->finishInitialization();
+    StartupProfiler::markPhase("Wayland globals");
+
+    bool initialized = sceneRenderer ? waylandWindow->initialize(std::move(sceneRenderer)) : waylandWindow->initialize(std::move(tileRenderer));
+    if (!initialized) {
         Logger::error("Failed to initialize Wayland window\n");
         return -1;
     }
@@ -94,6 +204,8 @@ int main(int argc, char** argv)
 
     Logger::info("Exiting. Cleaning up resources...\n");
     waylandWindow.reset();
+    if (painterPID > 0)
+        waitpid(painterPID, nullptr, 0);
     egl.reset();
     gbmGPU.reset();
     gbmIPU.reset();
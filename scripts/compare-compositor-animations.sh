@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 480 --tile-height 270 --tiles 16 --opaque --rbo --frames 1000 --unbounded --gpu-timing"
+
+set -x
+
+# Script to compare the compositor-only animations (--compositor-animation) on a 1920x1080 window.
+# Purpose: Find out the composition throughput ceiling for transform and opacity animations, without any
+# tile repaint or upload. Compare against the regular mode, which repaints every tile in every frame.
+
+for animation in none translate rotate scale fade all; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --compositor-animation ${animation}
+done
+
+for animation in fade all; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --compositor-animation ${animation} --linear-filter
+done
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 480 --tile-height 270 --tiles 16 --dmabuf-tiles --frames 1000 --unbounded --bandwidth"
+
+set -x
+
+# Script to compare BGRA content (--content-format bgra), converted within the store kernels or in a separate pass.
+# Purpose: Find out the real cost of the BGRA (Cairo / Skia) vs RGBA (tiles) pixel format mismatch, per update
+# method and tile layout. The RGBA runs are the baseline without any conversion.
+
+for method in mmap gbm; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method}
+    for conversion in fused separate; do
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method} --content-format bgra --content-conversion ${conversion}
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method} --content-format bgra --content-conversion ${conversion} --premultiply
+    done
+done
+
+for modifier in vivante-tiled vivante-super-tiled; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method mmap --tile-buffer-modifier ${modifier} --neon
+    for conversion in fused separate; do
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method mmap --tile-buffer-modifier ${modifier} --neon --content-format bgra --content-conversion ${conversion} --premultiply
+    done
+done
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 480 --tile-height 270 --tiles 16 --dmabuf-tiles --frames 1000 --unbounded --bandwidth --perf-counters"
+CONTENT_FILE=${1:?Usage: $0 <content file, see create-content-file.sh>}
+
+set -x
+
+# Script to compare the synthetic checkerboard with captured pages (--content-file) on a 1920x1080 tile grid.
+# Purpose: Find out how much the checkerboard flatters the cache- and compression-sensitive update paths. Real
+# content misses the caches more often, and every tile update also reads the file mapping.
+
+for method in gl mmap gbm; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method}
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method} --content-file ${CONTENT_FILE}
+done
+
+for modifier in vivante-tiled vivante-super-tiled; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method mmap --tile-buffer-modifier ${modifier} --neon
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method mmap --tile-buffer-modifier ${modifier} --neon --content-file ${CONTENT_FILE}
+done
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 512 --tile-height 512 --tiles 6 --opaque --rbo --frames 1000 --unbounded"
+
+set -x
+
+# Script to compare CPU painting + upload against GPU painting (render-to-tile through an FBO), on the same tile geometry.
+# Purpose: Find out if rasterizing the tiles on the GPU beats painting them on the CPU and uploading / mapping them.
+
+for updateType in full half third; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-type ${updateType} --tile-update-method gl
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-type ${updateType} --tile-update-method pbo --gles3
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-type ${updateType} --tile-update-method mmap --dmabuf-tiles --neon
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-type ${updateType} --tile-update-method gpu
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-type ${updateType} --tile-update-method gpu --dmabuf-tiles
+done
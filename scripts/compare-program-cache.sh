@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 512 --tile-height 512 --tiles 6 --opaque --rbo --frames 100"
+CACHE_DIR=$(mktemp -d)
+
+set -x
+
+# Script to compare the startup time with a cold and a warm program binary cache.
+# Purpose: Find out how much of the time to the first frame is spent compiling the GLSL programs.
+
+for updateMethod in gl gpu; do
+    rm -rf ${CACHE_DIR}/*
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${updateMethod} --program-cache-dir ${CACHE_DIR}
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${updateMethod} --program-cache-dir ${CACHE_DIR}
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${updateMethod} --no-program-cache
+done
+
+rm -rf ${CACHE_DIR}
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 512 --tile-height 512 --tiles 6 --opaque --rbo --frames 1000 --unbounded --dmabuf-tiles --bandwidth"
+
+set -x
+
+# Script to compare the cached store kernels with the non-temporal streaming ones (--store-kernel).
+# Purpose: Find out how much the write-combined dma-buf mappings gain from full 64 byte bursts that bypass the
+# caches, compared with the cached stores and destination prefetches. See the 'mapped store' GB/s at exit.
+
+for modifier in linear vivante-tiled vivante-super-tiled; do
+    for storeKernel in cached streaming; do
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --neon --tile-update-method mmap --tile-buffer-modifier ${modifier} --store-kernel ${storeKernel}
+    done
+done
+
+for storeKernel in cached streaming; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --neon --tile-update-method gbm --store-kernel ${storeKernel}
+done
@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 512 --tile-height 512 --tiles 6 --opaque --fences --rbo --frames 1000 --presentation-feedback"
+
+set -x
+
+# Script to find the smallest swapchain that avoids stalls, for the three buffer selection policies.
+# Every run reports the per-buffer occupancy, the number of busy buffers at acquisition time,
+# the stalls and the memory used by the window buffers.
+
+for buffers in 2 3 4; do
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --buffers ${buffers} --buffer-policy fifo
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --buffers ${buffers} --buffer-policy oldest-free
+    sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --buffers ${buffers} --buffer-policy mailbox
+done
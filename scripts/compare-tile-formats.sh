@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 480 --tile-height 270 --tiles 16 --dmabuf-tiles --frames 1000 --unbounded --bandwidth --gpu-timing"
+
+set -x
+
+# Script to compare the tile formats (--tile-format) on a 1920x1080 tile grid.
+# Purpose: Find out how much frame rate the reduced-bandwidth formats gain per update method, to weigh it against
+# the quantization error reported at exit (PSNR), and decide which layer types can be downgraded.
+
+for method in gl mmap gbm gpu; do
+    for format in abgr8888 xbgr8888 rgb565; do
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method ${method} --tile-format ${format}
+    done
+done
+
+for modifier in vivante-tiled vivante-super-tiled; do
+    for format in abgr8888 rgb565; do
+        sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --tile-update-method mmap --tile-buffer-modifier ${modifier} --tile-format ${format} --neon
+    done
+done
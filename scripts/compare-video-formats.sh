@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+OPTIONS="--tile-width 480 --tile-height 270 --tiles 16 --opaque --rbo --frames 1000 --bandwidth"
+
+set -x
+
+# Script to compare the NV12 / YUV420 video paths (--video-width / --video-height) above a 1920x1080 tile grid.
+# Purpose: Find out the decode and composition cost of a CPU decoded video, sampled as an external EGLImage,
+# at 30 and 60 fps. Watch the skipped frames: a video frame rate close to the window frame rate skips frames
+# whenever decoding stalls a window frame.
+
+sleep 4; wpe-testbed-wayland ${OPTIONS[@]}
+
+for format in nv12 yuv420; do
+    for size in "1920 1080" "3840 2160"; do
+        set -- ${size}
+        for rate in 30 60; do
+            sleep 4; wpe-testbed-wayland ${OPTIONS[@]} --video-format ${format} --video-width $1 --video-height $2 --video-frame-rate ${rate}
+        done
+    done
+done
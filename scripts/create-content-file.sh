@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+
+set -e
+
+# Script to convert captured screenshots (or anything else ffmpeg reads: an image sequence, a screen recording)
+# into a --content-file for wpe-testbed-wayland: a 16 byte header (width, height, frame count and stride as
+# little endian uint32) followed by the raw RGBA frames.
+# Usage: create-content-file.sh <input, e.g. 'screenshots/%04d.png'> <width> <height> <output> [rgba|bgra]
+
+if [ $# -lt 4 ]; then
+    echo "Usage: $0 <input> <width> <height> <output> [rgba|bgra]"
+    exit 1
+fi
+
+INPUT=$1
+WIDTH=$2
+HEIGHT=$3
+OUTPUT=$4
+FORMAT=${5:-rgba} # bgra for --content-format bgra
+
+STRIDE=$((WIDTH * 4))
+FRAMES_FILE=$(mktemp)
+trap 'rm -f "${FRAMES_FILE}"' EXIT
+
+ffmpeg -loglevel error -y -i "${INPUT}" -vf scale=${WIDTH}:${HEIGHT} -pix_fmt ${FORMAT} -f rawvideo "${FRAMES_FILE}"
+FRAME_COUNT=$(($(stat -c %s "${FRAMES_FILE}") / (STRIDE * HEIGHT)))
+
+le32() {
+    printf '\\x%02x\\x%02x\\x%02x\\x%02x' $(($1 & 255)) $((($1 >> 8) & 255)) $((($1 >> 16) & 255)) $((($1 >> 24) & 255))
+}
+
+{ printf "$(le32 ${WIDTH})$(le32 ${HEIGHT})$(le32 ${FRAME_COUNT})$(le32 ${STRIDE})"; cat "${FRAMES_FILE}"; } > "${OUTPUT}"
+echo "${OUTPUT}: ${WIDTH}x${HEIGHT}, ${FRAME_COUNT} frames"